@@ -4,9 +4,24 @@
       "target_name": "grandiose",
       "sources": [
         "src/grandiose_util.cc",
+        "src/grandiose_audio.cc",
+        "src/grandiose_video.cc",
         "src/grandiose_find.cc",
         "src/grandiose_send.cc",
+        "src/grandiose_submit.cc",
         "src/grandiose_receive.cc",
+        "src/grandiose_stream.cc",
+        "src/grandiose_frames.cc",
+        "src/grandiose_framesync.cc",
+        "src/grandiose_poll.cc",
+        "src/grandiose_stats.cc",
+        "src/grandiose_connect.cc",
+        "src/grandiose_routing.cc",
+        "src/grandiose_record.cc",
+        "src/grandiose_share.cc",
+        "src/grandiose_subscribe.cc",
+        "src/grandiose_pool.cc",
+        "src/grandiose_batch.cc",
         "src/grandiose.cc"
       ],
       "include_dirs": [ "include", "<!(node -p \"require('node-addon-api').include_dir\")" ],
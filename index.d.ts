@@ -1,3 +1,5 @@
+import { EventEmitter } from 'events'
+
 export interface AudioFrame {
   type: 'audio'
   audioFormat: AudioFormat
@@ -23,6 +25,8 @@ export interface VideoFrame {
   frameFormatType: FrameType
   timecode: [ number, number ] // Measured in nanoseconds
   lineStrideBytes: number
+  /** Set when the receiver converts video, the format of data */
+  outputFormat?: OutputFormat
   data: Buffer
 }
 
@@ -32,23 +36,318 @@ export interface Receiver {
   audio: (params: {
     audioFormat: AudioFormat
     referenceLevel: number
+    /** Convert samples directly into this buffer when it is large enough */
+    buffer?: Buffer
   }, timeout?: number) => Promise<AudioFrame>
   metadata: any
   data: any
-  source: Source
+  /** Capture a waiting video frame on the calling thread, without blocking */
+  tryVideo: () => VideoFrame | undefined
+  tryAudio: (params?: {
+    audioFormat?: AudioFormat
+    referenceLevel?: number
+    buffer?: Buffer
+  }) => AudioFrame | undefined
+  tryData: (params?: {
+    audioFormat?: AudioFormat
+    referenceLevel?: number
+    buffer?: Buffer
+  }) => VideoFrame | AudioFrame | MetadataFrame | StatusChange | undefined
+  /**
+   * Capture continuously on a dedicated native thread, calling back for each frame.
+   * Keeps the process alive until stopStream is called.
+   */
+  startStream: (options: StreamOptions | undefined,
+    callback: (err: Error | undefined, frame?: VideoFrame | AudioFrame | MetadataFrame | StatusChange) => void) => void
+  stopStream: () => void
+  /**
+   * Write frames to disk on native threads, calling back with progress only.
+   * Keeps the process alive until stopRecording is called.
+   */
+  record: (options: RecordOptions, callback: (err: Error | undefined, event: RecordEvent) => void) => void
+  /** Stop capturing and close the files once queued frames are written. An 'end' event follows. */
+  stopRecording: () => void
+  /**
+   * Capture into a ring of slots in a SharedArrayBuffer, for worker threads to read
+   * in place with FrameReader. Keeps the process alive until stopSharing is called.
+   */
+  share: (options?: ShareOptions) => SharedFrames
+  /** Stop capturing. Readers get the frames already captured, then null. */
+  stopSharing: () => void
+  /**
+   * Add a consumer with its own queue and callback. All of a receiver's subscribers see the
+   * same frames, captured once on a native thread that runs until the last one unsubscribes.
+   */
+  subscribe: (options: SubscribeOptions | undefined,
+    callback: (err: Error | undefined, frame?: VideoFrame | AudioFrame | MetadataFrame | StatusChange) => void) => Subscription
+  /**
+   * Iterate over frames as they arrive, with native capture running ahead of the consumer.
+   */
+  frames: (options?: FramesOptions) => AsyncIterableIterator<VideoFrame | AudioFrame | MetadataFrame | StatusChange>
+  /**
+   * Create a frame sync for non-blocking captures timed by the caller's clock.
+   * The receiver should then only be captured through the frame sync.
+   */
+  frameSync: () => FrameSync
+  /** Frame counts and queue depths from NDI, with grandiose's capture counters */
+  stats: () => ReceiverStats
+  /** Percentiles of time spent in each stage of capture */
+  latency: (percentiles?: number[]) => ReceiverLatency
+  /**
+   * Switch to another source without recreating the receiver. Pools, statistics
+   * and any stream or frame sync carry on. Resolves once NDI has been told.
+   */
+  connect: (source: Source) => Promise<void>
+  /** Stop receiving from the current source, keeping the receiver for a later connect */
+  disconnect: () => Promise<void>
+  /** The source last connected to, or undefined once disconnected */
+  source?: Source
   colorFormat: ColorFormat
   bandwidth: Bandwidth
   allowVideoFields: boolean
+  zeroCopy: boolean
+  outputFormat: OutputFormat
+}
+
+export interface FrameCounts {
+  video: number
+  audio: number
+  metadata: number
+}
+
+export interface ReceiverStats {
+  total: FrameCounts
+  dropped: FrameCounts
+  queue: FrameCounts
+  captures: number
+  timeouts: number
+  copyBytes: number
+  conversions: number
+  conversionMicros: number
+  streamDropped: number
+}
+
+/** Latency percentiles of one stage, in microseconds */
+export interface LatencySummary {
+  count: number
+  mean: number
+  max: number
+  p50: number
+  p90: number
+  p99: number
+  p999: number
+  /** Values for the extra percentiles asked for, if any */
+  percentiles?: number[]
+}
+
+export interface ReceiverLatency {
+  capture: LatencySummary
+  queue: LatencySummary
+  conversion: LatencySummary
+  complete: LatencySummary
+  delivery: LatencySummary
+}
+
+export interface SenderLatency {
+  queue: LatencySummary
+  send: LatencySummary
+}
+
+export interface FrameSync {
+  embedded: unknown
+  receiver: Receiver
+  /** Latest video frame, or undefined if none has been received yet */
+  captureVideo: (frameFormatType?: FrameType) => VideoFrame | undefined
+  /** Audio resampled to the local clock, padded with silence as required */
+  captureAudio: (sampleRate: number, channels: number, samples: number, params?: {
+    audioFormat?: AudioFormat
+    referenceLevel?: number
+  }) => AudioFrame
+  audioQueueDepth: () => number
+}
+
+export type FrameTypeName = 'video' | 'audio' | 'metadata'
+
+export interface MetadataFrame {
+  type: 'metadata'
+  length: number
+  timecode: [number, number]
+  data: string
+}
+
+export interface StatusChange {
+  type: 'statusChange'
+}
+
+export interface StreamOptions {
+  /** Frame types to capture, defaults to all */
+  types?: FrameTypeName[]
+  /** Number of frames queued natively before dropping, default 4 */
+  depth?: number
+  /** Which frame to drop when the queue is full, default 'oldest' */
+  dropPolicy?: 'oldest' | 'newest'
+  audioFormat?: AudioFormat
+  referenceLevel?: number
+}
+
+export interface RecordOptions {
+  /** Prefix of the files written, each segment adding -NNNNN.video, .audio and .index */
+  path: string
+  /** Only 'raw', the default: media as received, with an index of JSON lines */
+  container?: 'raw'
+  /** Seconds of media in each segment, or 0, the default, for a single segment */
+  segmentSeconds?: number
+  /** Frame types to record, defaults to video and audio. Metadata is not recorded. */
+  types?: FrameTypeName[]
+  /** Number of frames queued for the writer before dropping, default 16 */
+  depth?: number
+}
+
+export interface ShareOptions {
+  /** Number of frames the ring holds, default 4 */
+  slots?: number
+  /** Bytes of data each slot holds, default 8294400, enough for HD at 4 bytes per pixel */
+  slotSize?: number
+  /** Number of FrameReaders that each read every frame, default 1 */
+  readers?: number
+  /** 'video', 'audio' or both, defaults to video */
+  types?: FrameTypeName[]
+}
+
+export interface SubscribeOptions {
+  /** Frame types for this subscriber, defaults to all */
+  types?: FrameTypeName[]
+  /** Number of frames queued for this subscriber before dropping, default 4 */
+  depth?: number
+  /** Which frame to drop when the queue is full, default 'oldest' */
+  dropPolicy?: 'oldest' | 'newest'
+}
+
+export interface Subscription {
+  /** Stop calling back, dropping any frames still queued */
+  unsubscribe: () => void
+  stats: () => {
+    delivered: number
+    dropped: number
+    queued: number
+    subscribed: boolean
+  }
+}
+
+export interface SharedFrames {
+  /** Post to worker threads, without copying, to read with FrameReader */
+  buffer: SharedArrayBuffer
+  slots: number
+  slotSize: number
+  readers: number
+}
+
+interface SharedFrame {
+  timestamp: [ number, number ] // PTP timestamp
+  timecode: [ number, number ] // Measured in nanoseconds
+  /** A view of the frame's slot, valid until release is called */
+  data: Uint8Array
+  /** Hand the slot back, once every reader has done so it is written again */
+  release: () => void
+}
+
+export interface SharedVideoFrame extends SharedFrame {
+  type: 'video'
+  xres: number
+  yres: number
+  frameRateN: number
+  frameRateD: number
+  pictureAspectRatio: number
+  fourCC: FourCC
+  frameFormatType: FrameType
+  lineStrideBytes: number
+  outputFormat: OutputFormat
+}
+
+export interface SharedAudioFrame extends SharedFrame {
+  type: 'audio'
+  /** Always planar 32-bit float */
+  audioFormat: AudioFormat
+  sampleRate: number
+  channels: number
+  samples: number
+  channelStrideInBytes: number
+}
+
+/** Reads frames from a receiver's share, also available without the addon from 'grandiose/reader' */
+export class FrameReader {
+  constructor(buffer: SharedArrayBuffer)
+  readonly slots: number
+  readonly slotSize: number
+  readonly readers: number
+  /** Frames not captured as there was no free slot, or they did not fit */
+  readonly dropped: number
+  /** Whether a frame is waiting to be read */
+  readonly ready: boolean
+  /** Block for the next frame, giving undefined on timeout and null once sharing stops */
+  read(timeout?: number): SharedVideoFrame | SharedAudioFrame | undefined | null
+  /** As read, without blocking the thread */
+  next(timeout?: number): Promise<SharedVideoFrame | SharedAudioFrame | undefined | null>
+}
+
+export interface RecordEvent {
+  type: 'segment' | 'progress' | 'end' | 'error'
+  segment: number
+  /** Prefix of a new segment's files, or the file that failed */
+  path?: string
+  videoFrames: number
+  audioFrames: number
+  bytes: number
+  dropped: number
+}
+
+export interface FramesOptions {
+  /** Frame types to capture, defaults to all */
+  types?: FrameTypeName[]
+  /** Number of frames to capture ahead of the consumer, default 2 */
+  prefetch?: number
+  audioFormat?: AudioFormat
+  referenceLevel?: number
+}
+
+export interface AudioSendFrame {
+  /** Defaults to AUDIO_FORMAT_FLOAT_32_SEPARATE */
+  audioFormat?: AudioFormat
+  /** Headroom in dB of 16-bit samples, default 0 */
+  referenceLevel?: number
+  sampleRate: number // Hz
+  channels: number
+  samples: number
+  /** Bytes between channels of separate float audio, default samples * 4 */
+  channelStrideInBytes?: number
+  timecode?: [number, number]
+  data: Buffer
 }
 
 export interface Sender {
   embedded: unknown
-  video: (frame: VideoFrame) => Promise<void>
-  audio: (frame: AudioFrame) => Promise<void>
+  /** With an async sender, resolves once the frame is scheduled. Pass null to flush. */
+  video: (frame: VideoFrame | null) => Promise<void>
+  audio: (frame: AudioSendFrame) => Promise<void>
+  /**
+   * Video frame with data from the sender's pool of frame memory, reused once the frame
+   * has been sent. Data is emptied by sending, so the frame can only be sent once.
+   */
+  allocateFrame: (format: { xres: number, yres: number, fourCC: FourCC }) => VideoFrame
+  /**
+   * Queue video for the sender's thread, present when created with a queueDepth. Returns
+   * false if the queue is full. A Buffer alone is sent in the format of the last frame.
+   */
+  submit?: (frame: VideoFrame | Buffer) => boolean
+  /** Send an XML string, or an object with the XML as its data */
+  metadata: (xml: string | { data: string, timecode?: [number, number] }) => Promise<void>
+  /** Percentiles of time spent queued and sending */
+  latency: (percentiles?: number[]) => SenderLatency
   name: string
   groups?: string | string[]
   clockVideo: boolean
   clockAudio: boolean
+  async: boolean
 }
 
 export interface Source {
@@ -83,6 +382,23 @@ export const COLOR_FORMAT_RGBX_RGBA: ColorFormat
 export const COLOR_FORMAT_UYVY_RGBA: ColorFormat
 export const COLOR_FORMAT_BGRX_BGRA_FLIPPED: ColorFormat
 export const COLOR_FORMAT_FASTEST: ColorFormat
+export const COLOR_FORMAT_BEST: ColorFormat
+
+export const enum OutputFormat {
+  Native = 0,
+  RGBA = 1,
+  BGRA = 2,
+  NV12 = 3,
+  I420 = 4,
+  YUV422P10 = 5
+}
+
+export const OUTPUT_FORMAT_NATIVE: OutputFormat
+export const OUTPUT_FORMAT_RGBA: OutputFormat
+export const OUTPUT_FORMAT_BGRA: OutputFormat
+export const OUTPUT_FORMAT_NV12: OutputFormat
+export const OUTPUT_FORMAT_I420: OutputFormat
+export const OUTPUT_FORMAT_YUV422P10: OutputFormat
 
 export const enum FourCC {
   UYVY = 1498831189,
@@ -125,6 +441,10 @@ export function receive(params: {
   colorFormat?: ColorFormat
   bandwidth?: Bandwidth
   allowVideoFields?: boolean
+  /** Deliver video data without copying, holding the NDI frame until the Buffer is collected */
+  zeroCopy?: boolean
+  /** Convert UYVY, UYVA, P216 and PA16 video to this format on receipt */
+  outputFormat?: OutputFormat
   name?: string
 }): Promise<Receiver>
 
@@ -133,8 +453,72 @@ export function send(params: {
   groups?: string | string[]
   clockVideo?: boolean
   clockAudio?: boolean
+  /** Send video with NDIlib_send_send_video_async_v2 */
+  async?: boolean
+  /** Start a native thread sending video submitted to a queue of this depth */
+  queueDepth?: number
 }): Sender
 
+/**
+ * A virtual NDI source that sends its receivers straight to another source,
+ * without any media passing through this process.
+ */
+export interface Routing {
+  embedded: unknown
+  /** Point receivers at the given source, returning whether NDI accepted the change */
+  change: (source: Source) => boolean
+  /** Route receivers nowhere, returning whether NDI accepted the change */
+  clear: () => boolean
+  /** Number of receivers currently connected */
+  connections: () => number
+  name: string
+  groups?: string
+  /** The source being routed to, set by change and cleared by clear */
+  source?: Source
+}
+
+export function routing(params: {
+  name: string
+  groups?: string | string[]
+}): Promise<Routing>
+
+export function captureMany(receivers: Receiver[], options?: {
+  /** Milliseconds to wait for receivers that have no frame ready, default 0 */
+  wait?: number
+  /** Frame types to capture, defaults to all */
+  types?: FrameTypeName[]
+  audioFormat?: AudioFormat
+  referenceLevel?: number
+}): Promise<Array<VideoFrame | AudioFrame | MetadataFrame | StatusChange | undefined>>
+
+export interface ThreadConfiguration {
+  /** Threads in grandiose's pool for blocking work, 0 to use the libuv thread pool */
+  threads: number
+  /** Cores that grandiose's threads run on, empty for any */
+  affinity: number[]
+  /** Scheduling of media threads, null for normal */
+  realtime: (RealtimeOptions & {
+    /** Whether the process is permitted real-time scheduling */
+    granted: boolean
+  }) | null
+  /** Whether media thread stacks and frame pools are locked in memory */
+  lockMemory: boolean
+}
+
+export interface RealtimeOptions {
+  /** Default 'fifo' */
+  policy?: 'fifo' | 'rr'
+  /** 1 to 99, default 10 */
+  priority?: number
+}
+
+export function configure(options?: {
+  threads?: number
+  affinity?: number[] | null
+  realtime?: RealtimeOptions | null
+  lockMemory?: boolean
+}): ThreadConfiguration
+
 /** @deprecated use GrandioseFinder instead */
 export function find(params: GrandioseFinderOptions, waitMs?: number): Promise<Array<Source>>
 
@@ -152,7 +536,9 @@ export interface GrandioseFinderOptions {
  * An instance of the NDI source finder.
  * This will monitor for sources in the background, and you can poll it for the current list at useful times.
  */
-export class GrandioseFinder{
+export type SourceEvent = 'sourceAdded' | 'sourceRemoved' | 'sourceChanged'
+
+export class GrandioseFinder extends EventEmitter {
   constructor(options?: GrandioseFinderOptions)
 
   /** 
@@ -165,4 +551,22 @@ export class GrandioseFinder{
    * Get the list of currently known Sources
    */
   getCurrentSources(): Array<Source>
+
+  /**
+   * Counter that changes whenever the list of sources changes. Check it before
+   * calling getCurrentSources to skip fetching an unchanged list.
+   */
+  readonly generation: number
+
+  /**
+   * Emit an event for each source added, removed or changed, as found by a native thread.
+   * Starts with a sourceAdded event for each source already known. Keeps the application
+   * alive until unwatch or dispose is called.
+   */
+  watch(): this
+  unwatch(): this
+
+  on(event: SourceEvent, listener: (source: Source) => void): this
+  once(event: SourceEvent, listener: (source: Source) => void): this
+  off(event: SourceEvent, listener: (source: Source) => void): this
 }
\ No newline at end of file
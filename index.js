@@ -17,8 +17,8 @@ const addon = require("pkg-prebuilds")(
   __dirname,
   require("./binding-options")
 );
-const { promisify } = require('util')
-const setTimeoutPromise = promisify(setTimeout)
+const { EventEmitter } = require('events')
+const { FrameReader } = require('./reader')
 
 // TODO: reenable segfault-handler when the NDI lib is fixed
 // const SegfaultHandler = require('segfault-handler');
@@ -36,6 +36,8 @@ const COLOR_FORMAT_UYVY_RGBA = 3; // No alpha channel: UYVY, Alpha channel: RGBA
 const COLOR_FORMAT_BGRX_BGRA_FLIPPED = 200;
 
 const COLOR_FORMAT_FASTEST = 100;
+// Closest to native for the incoming codec, including 16bpp P216 and PA16
+const COLOR_FORMAT_BEST = 101;
 
 const BANDWIDTH_METADATA_ONLY = -10; // Receive metadata.
 const BANDWIDTH_AUDIO_ONLY    =  10; // Receive metadata, audio.
@@ -57,10 +59,21 @@ const AUDIO_FORMAT_FLOAT_32_INTERLEAVED = 1;
 // Channels stored as channel-interleaved 16-bit integer values
 const AUDIO_FORMAT_INT_16_INTERLEAVED = 2;
 
-class GrandioseFinder{
+// Video as delivered by NDI, according to the receiver's colour format
+const OUTPUT_FORMAT_NATIVE = 0;
+// Formats that UYVY, UYVA, P216 and PA16 video can be converted to on receipt
+const OUTPUT_FORMAT_RGBA = 1; // 8-bit RGBA, 4 bytes per pixel
+const OUTPUT_FORMAT_BGRA = 2; // 8-bit BGRA, 4 bytes per pixel
+const OUTPUT_FORMAT_NV12 = 3; // 8-bit 4:2:0, luminance plane then interleaved Cb, Cr
+const OUTPUT_FORMAT_I420 = 4; // 8-bit 4:2:0, luminance, Cb and Cr planes
+const OUTPUT_FORMAT_YUV422P10 = 5; // 10-bit 4:2:2, planes of 16-bit samples
+
+class GrandioseFinder extends EventEmitter {
   #addon
+  #watching = false
 
   constructor(options) {
+    super()
     const newOptions = options ? {
       showLocalSources: options.showLocalSources,
       groups: Array.isArray(options.groups) ? options.groups.join(','):options.groups,
@@ -70,12 +83,44 @@ class GrandioseFinder{
   }
 
   dispose(...args) {
+    this.#watching = false
     return this.#addon.dispose(...args)
   }
 
   getCurrentSources(...args) { 
     return this.#addon.getCurrentSources(...args)
   }
+
+  // Changes whenever the list of sources does, so is cheap to check before
+  // calling getCurrentSources
+  get generation() {
+    return this.#addon.generation
+  }
+
+  // Emit sourceAdded, sourceRemoved and sourceChanged events as the list of
+  // sources changes, starting with an event for each source already known
+  watch() {
+    if (!this.#watching) {
+      this.#addon.startWatching((event, source) => this.emit(event, source))
+      this.#watching = true
+    }
+    return this
+  }
+
+  unwatch() {
+    if (this.#watching) {
+      this.#addon.stopWatching()
+      this.#watching = false
+    }
+    return this
+  }
+}
+
+// Create a routing source, with groups given as a string or an array
+function routing(options) {
+  const newOptions = options && Array.isArray(options.groups) ?
+    Object.assign({}, options, { groups: options.groups.join(',') }) : options
+  return addon.routing(newOptions)
 }
 
 // API compataibility in a find implemenation
@@ -84,23 +129,18 @@ async function findCompat(options = {}, waitMs = 0) {
   const finder = new GrandioseFinder(options)
 
   if (!waitMs || typeof waitMs !== 'number') waitMs = 10000
-  const maxTime = Date.now() + waitMs
 
   try {
-    // Until the timeout has been reached
-    while(Date.now() < maxTime) {
-      // Sleep for a short period
-      await setTimeoutPromise(50)
-
-      // Check if any have been found
-      const sources = finder.getCurrentSources()
-      if (sources.length > 0) {
-        return sources
-      }
-    }
-
-    throw new Error('No sources were found')
-
+    // Wait for the first source to be announced, then let any others that
+    // arrived with it be reported too
+    return await new Promise((resolve, reject) => {
+      const timer = setTimeout(() => reject(new Error('No sources were found')), waitMs)
+      finder.once('sourceAdded', () => setImmediate(() => {
+        clearTimeout(timer)
+        resolve(finder.getCurrentSources())
+      }))
+      finder.watch()
+    })
   } finally {
     finder.dispose()
   }
@@ -113,13 +153,20 @@ module.exports = {
   isSupportedCPU: addon.isSupportedCPU,
   receive: addon.receive,
   send: addon.send,
+  routing: routing,
+  captureMany: addon.captureMany,
+  configure: addon.configure,
+  FrameReader,
   COLOR_FORMAT_BGRX_BGRA, COLOR_FORMAT_UYVY_BGRA,
   COLOR_FORMAT_RGBX_RGBA, COLOR_FORMAT_UYVY_RGBA,
   COLOR_FORMAT_BGRX_BGRA_FLIPPED, COLOR_FORMAT_FASTEST,
+  COLOR_FORMAT_BEST,
   BANDWIDTH_METADATA_ONLY, BANDWIDTH_AUDIO_ONLY,
   BANDWIDTH_LOWEST, BANDWIDTH_HIGHEST,
   FORMAT_TYPE_PROGRESSIVE, FORMAT_TYPE_INTERLACED,
   FORMAT_TYPE_FIELD_0, FORMAT_TYPE_FIELD_1,
   AUDIO_FORMAT_FLOAT_32_SEPARATE, AUDIO_FORMAT_FLOAT_32_INTERLEAVED,
-  AUDIO_FORMAT_INT_16_INTERLEAVED
+  AUDIO_FORMAT_INT_16_INTERLEAVED,
+  OUTPUT_FORMAT_NATIVE, OUTPUT_FORMAT_RGBA, OUTPUT_FORMAT_BGRA,
+  OUTPUT_FORMAT_NV12, OUTPUT_FORMAT_I420, OUTPUT_FORMAT_YUV422P10
 };
@@ -0,0 +1 @@
+export { FrameReader, SharedVideoFrame, SharedAudioFrame } from './index'
@@ -0,0 +1,180 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Reads frames captured by receiver.share() in place, from the
+// SharedArrayBuffer it returns. Needs no native code, so can be required in
+// worker_threads without loading the addon. The layout is defined in
+// src/grandiose_share.h.
+
+const SHARE_MAGIC = 0x47524e44
+const SHARE_HEADER_SIZE = 64
+const SHARE_SLOT_HEADER_SIZE = 128
+
+const SHARE_FIELD_MAGIC = 0
+const SHARE_FIELD_SLOTS = 1
+const SHARE_FIELD_SLOT_SIZE = 2
+const SHARE_FIELD_SLOT_STRIDE = 3
+const SHARE_FIELD_READERS = 4
+const SHARE_FIELD_SEQUENCE = 5
+const SHARE_FIELD_STATE = 6
+const SHARE_FIELD_DROPPED = 7
+
+const SLOT_FIELD_REFS = 0
+const SLOT_FIELD_TYPE = 2
+const SLOT_FIELD_SIZE = 3
+const SLOT_FIELD_TIMESTAMP = 4
+const SLOT_FIELD_TIMECODE = 6
+const SLOT_FIELD_XRES = 8
+const SLOT_FIELD_YRES = 9
+const SLOT_FIELD_FOURCC = 10
+const SLOT_FIELD_LINE_STRIDE = 11
+const SLOT_FIELD_FRAME_RATE_N = 12
+const SLOT_FIELD_FRAME_RATE_D = 13
+const SLOT_FIELD_FRAME_FORMAT_TYPE = 14
+const SLOT_FIELD_PICTURE_ASPECT_RATIO = 15
+const SLOT_FIELD_OUTPUT_FORMAT = 16
+const SLOT_FIELD_SAMPLE_RATE = 8
+const SLOT_FIELD_CHANNELS = 9
+const SLOT_FIELD_SAMPLES = 10
+const SLOT_FIELD_CHANNEL_STRIDE = 11
+
+const SLOT_TYPE_VIDEO = 1
+
+// Waits are woken by the JS thread of the receiver, so are also cut into
+// slices in case it is too busy to do so promptly
+const WAIT_SLICE = 5
+
+class FrameReader {
+  #buffer
+  #header
+  #slots = []
+  #sequence = 0 // Of the next frame to read
+
+  // Every one of a share's readers must read, and release, every frame
+  constructor(buffer) {
+    if (!(buffer instanceof SharedArrayBuffer) || buffer.byteLength < SHARE_HEADER_SIZE)
+      throw new TypeError('Frame reader requires the buffer of a receiver share.')
+    this.#buffer = buffer
+    this.#header = new Int32Array(buffer, 0, SHARE_HEADER_SIZE / 4)
+    if (this.#header[SHARE_FIELD_MAGIC] !== SHARE_MAGIC)
+      throw new TypeError('Frame reader requires the buffer of a receiver share.')
+    const stride = this.#header[SHARE_FIELD_SLOT_STRIDE]
+    for (let i = 0; i < this.#header[SHARE_FIELD_SLOTS]; i++) {
+      const offset = SHARE_HEADER_SIZE + i * stride
+      this.#slots.push({
+        offset,
+        fields: new Int32Array(buffer, offset, SHARE_SLOT_HEADER_SIZE / 4),
+        floats: new Float32Array(buffer, offset, SHARE_SLOT_HEADER_SIZE / 4)
+      })
+    }
+  }
+
+  get slots() { return this.#slots.length }
+  get slotSize() { return this.#header[SHARE_FIELD_SLOT_SIZE] }
+  get readers() { return this.#header[SHARE_FIELD_READERS] }
+  // Frames not captured as there was no free slot, or they did not fit
+  get dropped() { return Atomics.load(this.#header, SHARE_FIELD_DROPPED) }
+  // Whether the frame after the last one read has been published
+  get ready() { return this.#published() > 0 }
+
+  // Block for up to timeout milliseconds for the next frame. Returns
+  // undefined on timeout and null once sharing has stopped.
+  read(timeout = 1000) {
+    const deadline = Date.now() + timeout
+    while (this.#published() <= 0) {
+      const remaining = this.#remaining(deadline)
+      if (remaining === null) return null
+      if (remaining <= 0) return undefined
+      Atomics.wait(this.#header, SHARE_FIELD_SEQUENCE, this.#sequence, Math.min(remaining, WAIT_SLICE))
+    }
+    return this.#take()
+  }
+
+  // As for read, without blocking the thread
+  async next(timeout = 1000) {
+    const deadline = Date.now() + timeout
+    while (this.#published() <= 0) {
+      const remaining = this.#remaining(deadline)
+      if (remaining === null) return null
+      if (remaining <= 0) return undefined
+      // A pending waitAsync does not keep the event loop alive, so a timer
+      // covers each slice as well
+      const wait = Math.min(remaining, WAIT_SLICE)
+      let timer
+      const slice = new Promise(resolve => { timer = setTimeout(resolve, wait) })
+      const result = Atomics.waitAsync ?
+        Atomics.waitAsync(this.#header, SHARE_FIELD_SEQUENCE, this.#sequence, wait) : { async: false }
+      if (result.async) await Promise.race([ result.value, slice ])
+      else if (Atomics.load(this.#header, SHARE_FIELD_SEQUENCE) === this.#sequence) await slice
+      clearTimeout(timer)
+    }
+    return this.#take()
+  }
+
+  // Frames published but not yet read, allowing for the sequence wrapping
+  #published() {
+    return (Atomics.load(this.#header, SHARE_FIELD_SEQUENCE) - this.#sequence) | 0
+  }
+
+  #remaining(deadline) {
+    if (Atomics.load(this.#header, SHARE_FIELD_STATE) !== 0 && this.#published() <= 0)
+      return null
+    return deadline - Date.now()
+  }
+
+  #take() {
+    const slot = this.#slots[(this.#sequence >>> 0) % this.#slots.length]
+    this.#sequence = (this.#sequence + 1) | 0
+    const f = slot.fields
+    let released = false
+    const frame = {
+      type: f[SLOT_FIELD_TYPE] === SLOT_TYPE_VIDEO ? 'video' : 'audio',
+      timestamp: [ f[SLOT_FIELD_TIMESTAMP], f[SLOT_FIELD_TIMESTAMP + 1] ],
+      timecode: [ f[SLOT_FIELD_TIMECODE], f[SLOT_FIELD_TIMECODE + 1] ],
+      data: new Uint8Array(this.#buffer, slot.offset + SHARE_SLOT_HEADER_SIZE, f[SLOT_FIELD_SIZE]),
+      // The slot is only written again once every reader has released it
+      release: () => {
+        if (!released) {
+          released = true
+          Atomics.sub(f, SLOT_FIELD_REFS, 1)
+        }
+      }
+    }
+    if (frame.type === 'video') {
+      Object.assign(frame, {
+        xres: f[SLOT_FIELD_XRES],
+        yres: f[SLOT_FIELD_YRES],
+        frameRateN: f[SLOT_FIELD_FRAME_RATE_N],
+        frameRateD: f[SLOT_FIELD_FRAME_RATE_D],
+        pictureAspectRatio: slot.floats[SLOT_FIELD_PICTURE_ASPECT_RATIO],
+        fourCC: f[SLOT_FIELD_FOURCC],
+        frameFormatType: f[SLOT_FIELD_FRAME_FORMAT_TYPE],
+        lineStrideBytes: f[SLOT_FIELD_LINE_STRIDE],
+        outputFormat: f[SLOT_FIELD_OUTPUT_FORMAT]
+      })
+    } else {
+      Object.assign(frame, {
+        audioFormat: 0, // AUDIO_FORMAT_FLOAT_32_SEPARATE
+        sampleRate: f[SLOT_FIELD_SAMPLE_RATE],
+        channels: f[SLOT_FIELD_CHANNELS],
+        samples: f[SLOT_FIELD_SAMPLES],
+        channelStrideInBytes: f[SLOT_FIELD_CHANNEL_STRIDE]
+      })
+    }
+    return frame
+  }
+}
+
+module.exports = { FrameReader }
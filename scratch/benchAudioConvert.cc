@@ -0,0 +1,152 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/* Compares grandiose's audio conversion kernels with the NDI utility
+   functions, converting one second of 48kHz audio as 30 frames of 1600
+   samples. Build from the repository root with, for example:
+
+   g++ -std=c++14 -O2 -Iinclude -Isrc scratch/benchAudioConvert.cc src/grandiose_audio.cc \
+     lib/linux_x64/libndi.so.5 -Wl,-rpath,lib/linux_x64 -o benchAudioConvert
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "grandiose_audio.h"
+
+#define BENCH_SAMPLES 1600
+#define BENCH_FRAMES 30 // One second at 48kHz
+#define BENCH_ROUNDS 20
+#define BENCH_REFERENCE_LEVEL 20
+
+struct benchFrames {
+  std::vector<float> planar;
+  std::vector<NDIlib_audio_frame_v2_t> frames;
+};
+
+static void makeFrames(int32_t channels, benchFrames *bench)
+{
+  size_t frameSize = (size_t)channels * BENCH_SAMPLES;
+  bench->planar.resize(frameSize * BENCH_FRAMES);
+  for (size_t i = 0; i < bench->planar.size(); i++)
+    bench->planar[i] = sinf(i * 0.001f) * 1.5f;
+  for (int32_t f = 0; f < BENCH_FRAMES; f++)
+  {
+    NDIlib_audio_frame_v2_t frame;
+    frame.sample_rate = 48000;
+    frame.no_channels = channels;
+    frame.no_samples = BENCH_SAMPLES;
+    frame.channel_stride_in_bytes = BENCH_SAMPLES * sizeof(float);
+    frame.p_data = bench->planar.data() + frameSize * f;
+    bench->frames.push_back(frame);
+  }
+}
+
+// Best of several rounds, in microseconds for one second of audio
+template <typename F>
+static double timeRounds(F convert)
+{
+  double best = 1e30;
+  for (int32_t r = 0; r < BENCH_ROUNDS; r++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (int32_t f = 0; f < BENCH_FRAMES; f++)
+      convert(f);
+    std::chrono::duration<double, std::micro> taken = std::chrono::steady_clock::now() - start;
+    if (taken.count() < best)
+      best = taken.count();
+  }
+  return best;
+}
+
+static void benchChannels(int32_t channels)
+{
+  benchFrames bench;
+  makeFrames(channels, &bench);
+  size_t frameSize = (size_t)channels * BENCH_SAMPLES;
+  std::vector<float> out32f(frameSize);
+  std::vector<int16_t> out16s(frameSize);
+  std::vector<int16_t> ndi16s(frameSize);
+  std::vector<float> planar(frameSize);
+
+  printf("%d channels\n", channels);
+
+  NDIlib_audio_frame_interleaved_32f_t ndi32fFrame;
+  ndi32fFrame.p_data = out32f.data();
+  double ndiTo32f = timeRounds([&](int32_t f) {
+    NDIlib_util_audio_to_interleaved_32f_v2(&bench.frames[f], &ndi32fFrame);
+  });
+  NDIlib_audio_frame_interleaved_16s_t ndi16sFrame;
+  ndi16sFrame.reference_level = BENCH_REFERENCE_LEVEL;
+  ndi16sFrame.p_data = ndi16s.data();
+  double ndiTo16s = timeRounds([&](int32_t f) {
+    NDIlib_util_audio_to_interleaved_16s_v2(&bench.frames[f], &ndi16sFrame);
+  });
+  NDIlib_audio_frame_v2_t ndiPlanar = bench.frames[0];
+  ndiPlanar.p_data = planar.data();
+  ndi16sFrame.no_channels = channels;
+  ndi16sFrame.no_samples = BENCH_SAMPLES;
+  double ndiFrom16s = timeRounds([&](int32_t) {
+    NDIlib_util_audio_from_interleaved_16s_v2(&ndi16sFrame, &ndiPlanar);
+  });
+  printf("  %-8s to32f %9.1fus  to16s %9.1fus  from16s %9.1fus\n",
+         "ndi", ndiTo32f, ndiTo16s, ndiFrom16s);
+
+  const char *names[] = { "scalar", "sse4.1", "avx2", "neon" };
+  float scale = audioScale16s(BENCH_REFERENCE_LEVEL);
+  for (const char *name : names)
+  {
+    const audioKernels *kernels = findAudioKernels(name);
+    if (kernels == nullptr)
+      continue;
+    double to32f = timeRounds([&](int32_t f) {
+      kernels->planarToInterleaved32f(bench.frames[f].p_data, bench.frames[f].channel_stride_in_bytes,
+                                      channels, BENCH_SAMPLES, out32f.data());
+    });
+    double to16s = timeRounds([&](int32_t f) {
+      kernels->planarToInterleaved16s(bench.frames[f].p_data, bench.frames[f].channel_stride_in_bytes,
+                                      channels, BENCH_SAMPLES, scale, out16s.data());
+    });
+    double from16s = timeRounds([&](int32_t) {
+      kernels->interleaved16sToPlanar(out16s.data(), channels, BENCH_SAMPLES, scale,
+                                      planar.data(), BENCH_SAMPLES * sizeof(float));
+    });
+    // The last frame converted by the NDI library is still in ndi16s
+    int32_t maxDiff = 0;
+    for (size_t i = 0; i < frameSize; i++)
+      maxDiff = std::max(maxDiff, std::abs(out16s[i] - ndi16s[i]));
+    printf("  %-8s to32f %9.1fus  to16s %9.1fus  from16s %9.1fus  (max 16-bit difference from ndi %d)\n",
+           name, to32f, to16s, from16s, maxDiff);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (!NDIlib_initialize())
+  {
+    printf("Failed to initialize NDI.\n");
+    return 1;
+  }
+  printf("Selected kernels: %s\n", getAudioKernels()->name);
+  int32_t channels[] = { 2, 16, 64 };
+  for (int32_t c : channels)
+    benchChannels(c);
+  NDIlib_destroy();
+  return 0;
+}
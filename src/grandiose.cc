@@ -30,6 +30,9 @@
 #include "grandiose_find.h"
 #include "grandiose_send.h"
 #include "grandiose_receive.h"
+#include "grandiose_routing.h"
+#include "grandiose_batch.h"
+#include "grandiose_pool.h"
 #include "napi.h"
 
 Napi::Value version(const Napi::CallbackInfo &info)
@@ -58,8 +61,11 @@ Napi::Object Init(Napi::Env env, Napi::Object exports)
   napi_status status;
   napi_property_descriptor desc[] = {
       DECLARE_NAPI_METHOD("send", send),
-      DECLARE_NAPI_METHOD("receive", receive)};
-  status = napi_define_properties(env, exports, 2, desc);
+      DECLARE_NAPI_METHOD("receive", receive),
+      DECLARE_NAPI_METHOD("routing", routing),
+      DECLARE_NAPI_METHOD("captureMany", captureMany),
+      DECLARE_NAPI_METHOD("configure", configure)};
+  status = napi_define_properties(env, exports, 5, desc);
 
   exports.Set("version", Napi::Function::New(env, version));
   exports.Set("isSupportedCPU", Napi::Function::New(env, isSupportedCPU));
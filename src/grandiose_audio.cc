@@ -0,0 +1,1067 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cmath>
+#include <cstring>
+#include "grandiose_audio.h"
+#include "grandiose_simd.h"
+
+#define INT16_LOW -32768.0f
+#define INT16_HIGH 32767.0f
+
+static inline const float *planarChannel(const float *src, int32_t stride, int32_t channel)
+{
+  return (const float *)((const char *)src + (size_t)stride * channel);
+}
+
+static inline float *planarChannel(float *dst, int32_t stride, int32_t channel)
+{
+  return (float *)((char *)dst + (size_t)stride * channel);
+}
+
+// Written so that NaN clamps low, as the vector kernels do
+static inline int16_t toInt16(float value)
+{
+  if (!(value >= INT16_LOW))
+    value = INT16_LOW;
+  else if (value > INT16_HIGH)
+    value = INT16_HIGH;
+  return (int16_t)lrintf(value);
+}
+
+/* Plain C++ kernels. Each converts channels from first onwards, so that the
+   vector kernels can hand them any channels left over after whole blocks. */
+
+static void scalarPlanarToInterleaved32f(const float *src, int32_t stride, int32_t first,
+                                         int32_t channels, int32_t samples, float *dst)
+{
+  for (int32_t c = first; c < channels; c++)
+  {
+    const float *in = planarChannel(src, stride, c);
+    float *out = dst + c;
+    for (int32_t s = 0; s < samples; s++)
+      out[(size_t)s * channels] = in[s];
+  }
+}
+
+static void scalarPlanarToInterleaved16s(const float *src, int32_t stride, int32_t first,
+                                         int32_t channels, int32_t samples, float scale, int16_t *dst)
+{
+  for (int32_t c = first; c < channels; c++)
+  {
+    const float *in = planarChannel(src, stride, c);
+    int16_t *out = dst + c;
+    for (int32_t s = 0; s < samples; s++)
+      out[(size_t)s * channels] = toInt16(in[s] * scale);
+  }
+}
+
+static void scalarInterleaved32fToPlanar(const float *src, int32_t first, int32_t channels,
+                                         int32_t samples, float *dst, int32_t stride)
+{
+  for (int32_t c = first; c < channels; c++)
+  {
+    const float *in = src + c;
+    float *out = planarChannel(dst, stride, c);
+    for (int32_t s = 0; s < samples; s++)
+      out[s] = in[(size_t)s * channels];
+  }
+}
+
+static void scalarInterleaved16sToPlanar(const int16_t *src, int32_t first, int32_t channels,
+                                         int32_t samples, float scale, float *dst, int32_t stride)
+{
+  float inverse = 1.0f / scale;
+  for (int32_t c = first; c < channels; c++)
+  {
+    const int16_t *in = src + c;
+    float *out = planarChannel(dst, stride, c);
+    for (int32_t s = 0; s < samples; s++)
+      out[s] = in[(size_t)s * channels] * inverse;
+  }
+}
+
+static void scalarP2I32f(const float *src, int32_t stride, int32_t channels, int32_t samples, float *dst)
+{
+  scalarPlanarToInterleaved32f(src, stride, 0, channels, samples, dst);
+}
+
+static void scalarP2I16s(const float *src, int32_t stride, int32_t channels, int32_t samples,
+                         float scale, int16_t *dst)
+{
+  scalarPlanarToInterleaved16s(src, stride, 0, channels, samples, scale, dst);
+}
+
+static void scalarI2P32f(const float *src, int32_t channels, int32_t samples, float *dst, int32_t stride)
+{
+  scalarInterleaved32fToPlanar(src, 0, channels, samples, dst, stride);
+}
+
+static void scalarI2P16s(const int16_t *src, int32_t channels, int32_t samples, float scale,
+                         float *dst, int32_t stride)
+{
+  scalarInterleaved16sToPlanar(src, 0, channels, samples, scale, dst, stride);
+}
+
+static const audioKernels scalarKernels = {
+  "scalar", scalarP2I32f, scalarP2I16s, scalarI2P32f, scalarI2P16s
+};
+
+#ifdef GRANDIOSE_SIMD_X86
+
+/* SSE4.1 kernels, working on blocks of four channels by four samples that are
+   transposed in registers. Stereo and mono have their own loops. */
+
+TARGET_SSE41 static inline __m128 sse41Clamp(__m128 value)
+{
+  // _mm_max_ps returns its second operand when either is NaN
+  return _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(INT16_LOW)), _mm_set1_ps(INT16_HIGH));
+}
+
+TARGET_SSE41 static inline __m128 sse41LoadInt16(const int16_t *src, __m128 inverse)
+{
+  __m128i packed = _mm_loadl_epi64((const __m128i *)src);
+  return _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(packed)), inverse);
+}
+
+TARGET_SSE41 static void sse41PlanarToInterleaved32f(const float *src, int32_t stride, int32_t first,
+                                                     int32_t channels, int32_t samples, float *dst)
+{
+  int32_t c = first;
+  for (; c + 4 <= channels; c += 4)
+  {
+    const float *in0 = planarChannel(src, stride, c);
+    const float *in1 = planarChannel(src, stride, c + 1);
+    const float *in2 = planarChannel(src, stride, c + 2);
+    const float *in3 = planarChannel(src, stride, c + 3);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128 r0 = _mm_loadu_ps(in0 + s);
+      __m128 r1 = _mm_loadu_ps(in1 + s);
+      __m128 r2 = _mm_loadu_ps(in2 + s);
+      __m128 r3 = _mm_loadu_ps(in3 + s);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      float *out = dst + (size_t)s * channels + c;
+      _mm_storeu_ps(out, r0);
+      _mm_storeu_ps(out + channels, r1);
+      _mm_storeu_ps(out + 2 * channels, r2);
+      _mm_storeu_ps(out + 3 * channels, r3);
+    }
+    for (; s < samples; s++)
+    {
+      float *out = dst + (size_t)s * channels + c;
+      out[0] = in0[s];
+      out[1] = in1[s];
+      out[2] = in2[s];
+      out[3] = in3[s];
+    }
+  }
+  scalarPlanarToInterleaved32f(src, stride, c, channels, samples, dst);
+}
+
+TARGET_SSE41 static void sse41PlanarToInterleaved16s(const float *src, int32_t stride, int32_t first,
+                                                     int32_t channels, int32_t samples, float scale, int16_t *dst)
+{
+  __m128 factor = _mm_set1_ps(scale);
+  int32_t c = first;
+  for (; c + 4 <= channels; c += 4)
+  {
+    const float *in0 = planarChannel(src, stride, c);
+    const float *in1 = planarChannel(src, stride, c + 1);
+    const float *in2 = planarChannel(src, stride, c + 2);
+    const float *in3 = planarChannel(src, stride, c + 3);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128 r0 = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(in0 + s), factor));
+      __m128 r1 = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(in1 + s), factor));
+      __m128 r2 = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(in2 + s), factor));
+      __m128 r3 = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(in3 + s), factor));
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      __m128i s01 = _mm_packs_epi32(_mm_cvtps_epi32(r0), _mm_cvtps_epi32(r1));
+      __m128i s23 = _mm_packs_epi32(_mm_cvtps_epi32(r2), _mm_cvtps_epi32(r3));
+      int16_t *out = dst + (size_t)s * channels + c;
+      _mm_storel_epi64((__m128i *)out, s01);
+      _mm_storel_epi64((__m128i *)(out + channels), _mm_unpackhi_epi64(s01, s01));
+      _mm_storel_epi64((__m128i *)(out + 2 * channels), s23);
+      _mm_storel_epi64((__m128i *)(out + 3 * channels), _mm_unpackhi_epi64(s23, s23));
+    }
+    for (; s < samples; s++)
+    {
+      int16_t *out = dst + (size_t)s * channels + c;
+      out[0] = toInt16(in0[s] * scale);
+      out[1] = toInt16(in1[s] * scale);
+      out[2] = toInt16(in2[s] * scale);
+      out[3] = toInt16(in3[s] * scale);
+    }
+  }
+  scalarPlanarToInterleaved16s(src, stride, c, channels, samples, scale, dst);
+}
+
+TARGET_SSE41 static void sse41Interleaved32fToPlanar(const float *src, int32_t first, int32_t channels,
+                                                     int32_t samples, float *dst, int32_t stride)
+{
+  int32_t c = first;
+  for (; c + 4 <= channels; c += 4)
+  {
+    float *out0 = planarChannel(dst, stride, c);
+    float *out1 = planarChannel(dst, stride, c + 1);
+    float *out2 = planarChannel(dst, stride, c + 2);
+    float *out3 = planarChannel(dst, stride, c + 3);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      __m128 r0 = _mm_loadu_ps(in);
+      __m128 r1 = _mm_loadu_ps(in + channels);
+      __m128 r2 = _mm_loadu_ps(in + 2 * channels);
+      __m128 r3 = _mm_loadu_ps(in + 3 * channels);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(out0 + s, r0);
+      _mm_storeu_ps(out1 + s, r1);
+      _mm_storeu_ps(out2 + s, r2);
+      _mm_storeu_ps(out3 + s, r3);
+    }
+    for (; s < samples; s++)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      out0[s] = in[0];
+      out1[s] = in[1];
+      out2[s] = in[2];
+      out3[s] = in[3];
+    }
+  }
+  scalarInterleaved32fToPlanar(src, c, channels, samples, dst, stride);
+}
+
+TARGET_SSE41 static void sse41Interleaved16sToPlanar(const int16_t *src, int32_t first, int32_t channels,
+                                                     int32_t samples, float scale, float *dst, int32_t stride)
+{
+  __m128 inverse = _mm_set1_ps(1.0f / scale);
+  int32_t c = first;
+  for (; c + 4 <= channels; c += 4)
+  {
+    float *out0 = planarChannel(dst, stride, c);
+    float *out1 = planarChannel(dst, stride, c + 1);
+    float *out2 = planarChannel(dst, stride, c + 2);
+    float *out3 = planarChannel(dst, stride, c + 3);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      __m128 r0 = sse41LoadInt16(in, inverse);
+      __m128 r1 = sse41LoadInt16(in + channels, inverse);
+      __m128 r2 = sse41LoadInt16(in + 2 * channels, inverse);
+      __m128 r3 = sse41LoadInt16(in + 3 * channels, inverse);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(out0 + s, r0);
+      _mm_storeu_ps(out1 + s, r1);
+      _mm_storeu_ps(out2 + s, r2);
+      _mm_storeu_ps(out3 + s, r3);
+    }
+    for (; s < samples; s++)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      out0[s] = in[0] * (1.0f / scale);
+      out1[s] = in[1] * (1.0f / scale);
+      out2[s] = in[2] * (1.0f / scale);
+      out3[s] = in[3] * (1.0f / scale);
+    }
+  }
+  scalarInterleaved16sToPlanar(src, c, channels, samples, scale, dst, stride);
+}
+
+TARGET_SSE41 static void sse41P2I32f(const float *src, int32_t stride, int32_t channels, int32_t samples, float *dst)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128 l = _mm_loadu_ps(left + s);
+      __m128 r = _mm_loadu_ps(right + s);
+      _mm_storeu_ps(dst + 2 * s, _mm_unpacklo_ps(l, r));
+      _mm_storeu_ps(dst + 2 * s + 4, _mm_unpackhi_ps(l, r));
+    }
+    for (; s < samples; s++)
+    {
+      dst[2 * s] = left[s];
+      dst[2 * s + 1] = right[s];
+    }
+    return;
+  }
+  sse41PlanarToInterleaved32f(src, stride, 0, channels, samples, dst);
+}
+
+TARGET_SSE41 static void sse41P2I16s(const float *src, int32_t stride, int32_t channels, int32_t samples,
+                                     float scale, int16_t *dst)
+{
+  __m128 factor = _mm_set1_ps(scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 8 <= samples; s += 8)
+    {
+      __m128 a = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(src + s), factor));
+      __m128 b = sse41Clamp(_mm_mul_ps(_mm_loadu_ps(src + s + 4), factor));
+      _mm_storeu_si128((__m128i *)(dst + s), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    for (; s < samples; s++)
+      dst[s] = toInt16(src[s] * scale);
+    return;
+  }
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128i l = _mm_cvtps_epi32(sse41Clamp(_mm_mul_ps(_mm_loadu_ps(left + s), factor)));
+      __m128i r = _mm_cvtps_epi32(sse41Clamp(_mm_mul_ps(_mm_loadu_ps(right + s), factor)));
+      __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+      _mm_storeu_si128((__m128i *)(dst + 2 * s), packed);
+    }
+    for (; s < samples; s++)
+    {
+      dst[2 * s] = toInt16(left[s] * scale);
+      dst[2 * s + 1] = toInt16(right[s] * scale);
+    }
+    return;
+  }
+  sse41PlanarToInterleaved16s(src, stride, 0, channels, samples, scale, dst);
+}
+
+TARGET_SSE41 static void sse41I2P32f(const float *src, int32_t channels, int32_t samples, float *dst, int32_t stride)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    int32_t s = 0;
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128 a = _mm_loadu_ps(src + 2 * s);
+      __m128 b = _mm_loadu_ps(src + 2 * s + 4);
+      _mm_storeu_ps(left + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(right + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    for (; s < samples; s++)
+    {
+      left[s] = src[2 * s];
+      right[s] = src[2 * s + 1];
+    }
+    return;
+  }
+  sse41Interleaved32fToPlanar(src, 0, channels, samples, dst, stride);
+}
+
+TARGET_SSE41 static void sse41I2P16s(const int16_t *src, int32_t channels, int32_t samples, float scale,
+                                     float *dst, int32_t stride)
+{
+  __m128 inverse = _mm_set1_ps(1.0f / scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 4 <= samples; s += 4)
+      _mm_storeu_ps(dst + s, sse41LoadInt16(src + s, inverse));
+    scalarInterleaved16sToPlanar(src + s, 0, 1, samples - s, scale, dst + s, stride);
+    return;
+  }
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      __m128 a = sse41LoadInt16(src + 2 * s, inverse);
+      __m128 b = sse41LoadInt16(src + 2 * s + 4, inverse);
+      _mm_storeu_ps(left + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(right + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    scalarInterleaved16sToPlanar(src + 2 * s, 0, 2, samples - s, scale, dst + s, stride);
+    return;
+  }
+  sse41Interleaved16sToPlanar(src, 0, channels, samples, scale, dst, stride);
+}
+
+static const audioKernels sse41Kernels = {
+  "sse4.1", sse41P2I32f, sse41P2I16s, sse41I2P32f, sse41I2P16s
+};
+
+/* AVX2 kernels, working on blocks of eight channels by eight samples and
+   leaving any remaining channels to the SSE4.1 code. */
+
+TARGET_AVX2 static inline void avx2Transpose8(__m256 &r0, __m256 &r1, __m256 &r2, __m256 &r3,
+                                              __m256 &r4, __m256 &r5, __m256 &r6, __m256 &r7)
+{
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  r0 = _mm256_permute2f128_ps(u0, u4, 0x20);
+  r1 = _mm256_permute2f128_ps(u1, u5, 0x20);
+  r2 = _mm256_permute2f128_ps(u2, u6, 0x20);
+  r3 = _mm256_permute2f128_ps(u3, u7, 0x20);
+  r4 = _mm256_permute2f128_ps(u0, u4, 0x31);
+  r5 = _mm256_permute2f128_ps(u1, u5, 0x31);
+  r6 = _mm256_permute2f128_ps(u2, u6, 0x31);
+  r7 = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+TARGET_AVX2 static inline __m256 avx2Scale(const float *src, __m256 factor)
+{
+  __m256 value = _mm256_mul_ps(_mm256_loadu_ps(src), factor);
+  return _mm256_min_ps(_mm256_max_ps(value, _mm256_set1_ps(INT16_LOW)), _mm256_set1_ps(INT16_HIGH));
+}
+
+TARGET_AVX2 static inline void avx2StoreInt16(int16_t *dst, __m256 value)
+{
+  __m256i words = _mm256_cvtps_epi32(value);
+  __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+  _mm_storeu_si128((__m128i *)dst, packed);
+}
+
+TARGET_AVX2 static inline __m256 avx2LoadInt16(const int16_t *src, __m256 inverse)
+{
+  __m256i words = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)src));
+  return _mm256_mul_ps(_mm256_cvtepi32_ps(words), inverse);
+}
+
+// Separate a vector of interleaved stereo pairs from a and b into left and right
+TARGET_AVX2 static inline void avx2Deinterleave(__m256 a, __m256 b, __m256 *left, __m256 *right)
+{
+  __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+  *left = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+  *right = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+TARGET_AVX2 static void avx2P2I32f(const float *src, int32_t stride, int32_t channels, int32_t samples, float *dst)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  int32_t s = 0;
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    for (; s + 8 <= samples; s += 8)
+    {
+      __m256 l = _mm256_loadu_ps(left + s);
+      __m256 r = _mm256_loadu_ps(right + s);
+      __m256 lo = _mm256_unpacklo_ps(l, r);
+      __m256 hi = _mm256_unpackhi_ps(l, r);
+      _mm256_storeu_ps(dst + 2 * s, _mm256_permute2f128_ps(lo, hi, 0x20));
+      _mm256_storeu_ps(dst + 2 * s + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    for (; s < samples; s++)
+    {
+      dst[2 * s] = left[s];
+      dst[2 * s + 1] = right[s];
+    }
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 8 <= channels; c += 8)
+  {
+    const float *in[8];
+    for (int32_t i = 0; i < 8; i++)
+      in[i] = planarChannel(src, stride, c + i);
+    for (s = 0; s + 8 <= samples; s += 8)
+    {
+      __m256 r0 = _mm256_loadu_ps(in[0] + s);
+      __m256 r1 = _mm256_loadu_ps(in[1] + s);
+      __m256 r2 = _mm256_loadu_ps(in[2] + s);
+      __m256 r3 = _mm256_loadu_ps(in[3] + s);
+      __m256 r4 = _mm256_loadu_ps(in[4] + s);
+      __m256 r5 = _mm256_loadu_ps(in[5] + s);
+      __m256 r6 = _mm256_loadu_ps(in[6] + s);
+      __m256 r7 = _mm256_loadu_ps(in[7] + s);
+      avx2Transpose8(r0, r1, r2, r3, r4, r5, r6, r7);
+      float *out = dst + (size_t)s * channels + c;
+      _mm256_storeu_ps(out, r0);
+      _mm256_storeu_ps(out + channels, r1);
+      _mm256_storeu_ps(out + 2 * channels, r2);
+      _mm256_storeu_ps(out + 3 * channels, r3);
+      _mm256_storeu_ps(out + 4 * channels, r4);
+      _mm256_storeu_ps(out + 5 * channels, r5);
+      _mm256_storeu_ps(out + 6 * channels, r6);
+      _mm256_storeu_ps(out + 7 * channels, r7);
+    }
+    for (; s < samples; s++)
+    {
+      float *out = dst + (size_t)s * channels + c;
+      for (int32_t i = 0; i < 8; i++)
+        out[i] = in[i][s];
+    }
+  }
+  sse41PlanarToInterleaved32f(src, stride, c, channels, samples, dst);
+}
+
+TARGET_AVX2 static void avx2P2I16s(const float *src, int32_t stride, int32_t channels, int32_t samples,
+                                   float scale, int16_t *dst)
+{
+  __m256 factor = _mm256_set1_ps(scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 16 <= samples; s += 16)
+    {
+      __m256i a = _mm256_cvtps_epi32(avx2Scale(src + s, factor));
+      __m256i b = _mm256_cvtps_epi32(avx2Scale(src + s + 8, factor));
+      // Packing works within each 128-bit lane, so put the halves back in order
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm256_storeu_si256((__m256i *)(dst + s), packed);
+    }
+    for (; s < samples; s++)
+      dst[s] = toInt16(src[s] * scale);
+    return;
+  }
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    for (; s + 8 <= samples; s += 8)
+    {
+      __m256i l = _mm256_cvtps_epi32(avx2Scale(left + s, factor));
+      __m256i r = _mm256_cvtps_epi32(avx2Scale(right + s, factor));
+      __m256i packed = _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r));
+      _mm256_storeu_si256((__m256i *)(dst + 2 * s), packed);
+    }
+    for (; s < samples; s++)
+    {
+      dst[2 * s] = toInt16(left[s] * scale);
+      dst[2 * s + 1] = toInt16(right[s] * scale);
+    }
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 8 <= channels; c += 8)
+  {
+    const float *in[8];
+    for (int32_t i = 0; i < 8; i++)
+      in[i] = planarChannel(src, stride, c + i);
+    for (s = 0; s + 8 <= samples; s += 8)
+    {
+      __m256 r0 = avx2Scale(in[0] + s, factor);
+      __m256 r1 = avx2Scale(in[1] + s, factor);
+      __m256 r2 = avx2Scale(in[2] + s, factor);
+      __m256 r3 = avx2Scale(in[3] + s, factor);
+      __m256 r4 = avx2Scale(in[4] + s, factor);
+      __m256 r5 = avx2Scale(in[5] + s, factor);
+      __m256 r6 = avx2Scale(in[6] + s, factor);
+      __m256 r7 = avx2Scale(in[7] + s, factor);
+      avx2Transpose8(r0, r1, r2, r3, r4, r5, r6, r7);
+      int16_t *out = dst + (size_t)s * channels + c;
+      avx2StoreInt16(out, r0);
+      avx2StoreInt16(out + channels, r1);
+      avx2StoreInt16(out + 2 * channels, r2);
+      avx2StoreInt16(out + 3 * channels, r3);
+      avx2StoreInt16(out + 4 * channels, r4);
+      avx2StoreInt16(out + 5 * channels, r5);
+      avx2StoreInt16(out + 6 * channels, r6);
+      avx2StoreInt16(out + 7 * channels, r7);
+    }
+    for (; s < samples; s++)
+    {
+      int16_t *out = dst + (size_t)s * channels + c;
+      for (int32_t i = 0; i < 8; i++)
+        out[i] = toInt16(in[i][s] * scale);
+    }
+  }
+  sse41PlanarToInterleaved16s(src, stride, c, channels, samples, scale, dst);
+}
+
+TARGET_AVX2 static void avx2I2P32f(const float *src, int32_t channels, int32_t samples, float *dst, int32_t stride)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  int32_t s = 0;
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    for (; s + 8 <= samples; s += 8)
+    {
+      __m256 l, r;
+      avx2Deinterleave(_mm256_loadu_ps(src + 2 * s), _mm256_loadu_ps(src + 2 * s + 8), &l, &r);
+      _mm256_storeu_ps(left + s, l);
+      _mm256_storeu_ps(right + s, r);
+    }
+    for (; s < samples; s++)
+    {
+      left[s] = src[2 * s];
+      right[s] = src[2 * s + 1];
+    }
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 8 <= channels; c += 8)
+  {
+    float *out[8];
+    for (int32_t i = 0; i < 8; i++)
+      out[i] = planarChannel(dst, stride, c + i);
+    for (s = 0; s + 8 <= samples; s += 8)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      __m256 r0 = _mm256_loadu_ps(in);
+      __m256 r1 = _mm256_loadu_ps(in + channels);
+      __m256 r2 = _mm256_loadu_ps(in + 2 * channels);
+      __m256 r3 = _mm256_loadu_ps(in + 3 * channels);
+      __m256 r4 = _mm256_loadu_ps(in + 4 * channels);
+      __m256 r5 = _mm256_loadu_ps(in + 5 * channels);
+      __m256 r6 = _mm256_loadu_ps(in + 6 * channels);
+      __m256 r7 = _mm256_loadu_ps(in + 7 * channels);
+      avx2Transpose8(r0, r1, r2, r3, r4, r5, r6, r7);
+      _mm256_storeu_ps(out[0] + s, r0);
+      _mm256_storeu_ps(out[1] + s, r1);
+      _mm256_storeu_ps(out[2] + s, r2);
+      _mm256_storeu_ps(out[3] + s, r3);
+      _mm256_storeu_ps(out[4] + s, r4);
+      _mm256_storeu_ps(out[5] + s, r5);
+      _mm256_storeu_ps(out[6] + s, r6);
+      _mm256_storeu_ps(out[7] + s, r7);
+    }
+    for (; s < samples; s++)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      for (int32_t i = 0; i < 8; i++)
+        out[i][s] = in[i];
+    }
+  }
+  sse41Interleaved32fToPlanar(src, c, channels, samples, dst, stride);
+}
+
+TARGET_AVX2 static void avx2I2P16s(const int16_t *src, int32_t channels, int32_t samples, float scale,
+                                   float *dst, int32_t stride)
+{
+  __m256 inverse = _mm256_set1_ps(1.0f / scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 8 <= samples; s += 8)
+      _mm256_storeu_ps(dst + s, avx2LoadInt16(src + s, inverse));
+    scalarInterleaved16sToPlanar(src + s, 0, 1, samples - s, scale, dst + s, stride);
+    return;
+  }
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    for (; s + 8 <= samples; s += 8)
+    {
+      __m256 l, r;
+      avx2Deinterleave(avx2LoadInt16(src + 2 * s, inverse), avx2LoadInt16(src + 2 * s + 8, inverse), &l, &r);
+      _mm256_storeu_ps(left + s, l);
+      _mm256_storeu_ps(right + s, r);
+    }
+    scalarInterleaved16sToPlanar(src + 2 * s, 0, 2, samples - s, scale, dst + s, stride);
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 8 <= channels; c += 8)
+  {
+    float *out[8];
+    for (int32_t i = 0; i < 8; i++)
+      out[i] = planarChannel(dst, stride, c + i);
+    for (s = 0; s + 8 <= samples; s += 8)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      __m256 r0 = avx2LoadInt16(in, inverse);
+      __m256 r1 = avx2LoadInt16(in + channels, inverse);
+      __m256 r2 = avx2LoadInt16(in + 2 * channels, inverse);
+      __m256 r3 = avx2LoadInt16(in + 3 * channels, inverse);
+      __m256 r4 = avx2LoadInt16(in + 4 * channels, inverse);
+      __m256 r5 = avx2LoadInt16(in + 5 * channels, inverse);
+      __m256 r6 = avx2LoadInt16(in + 6 * channels, inverse);
+      __m256 r7 = avx2LoadInt16(in + 7 * channels, inverse);
+      avx2Transpose8(r0, r1, r2, r3, r4, r5, r6, r7);
+      _mm256_storeu_ps(out[0] + s, r0);
+      _mm256_storeu_ps(out[1] + s, r1);
+      _mm256_storeu_ps(out[2] + s, r2);
+      _mm256_storeu_ps(out[3] + s, r3);
+      _mm256_storeu_ps(out[4] + s, r4);
+      _mm256_storeu_ps(out[5] + s, r5);
+      _mm256_storeu_ps(out[6] + s, r6);
+      _mm256_storeu_ps(out[7] + s, r7);
+    }
+    for (; s < samples; s++)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      for (int32_t i = 0; i < 8; i++)
+        out[i][s] = in[i] * (1.0f / scale);
+    }
+  }
+  sse41Interleaved16sToPlanar(src, c, channels, samples, scale, dst, stride);
+}
+
+static const audioKernels avx2Kernels = {
+  "avx2", avx2P2I32f, avx2P2I16s, avx2I2P32f, avx2I2P16s
+};
+
+#endif /* GRANDIOSE_SIMD_X86 */
+
+#ifdef GRANDIOSE_SIMD_NEON
+
+/* NEON kernels for ARM64, where NEON is always present. Blocks of four
+   channels by four samples are transposed in registers. */
+
+static inline void neonTranspose4(float32x4_t &r0, float32x4_t &r1, float32x4_t &r2, float32x4_t &r3)
+{
+  float32x4x2_t t01 = vtrnq_f32(r0, r1);
+  float32x4x2_t t23 = vtrnq_f32(r2, r3);
+  r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+  r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+  r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+  r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+// vmaxnmq_f32 returns the number when one operand is NaN
+static inline int16x4_t neonToInt16(float32x4_t value, float32x4_t factor)
+{
+  value = vmulq_f32(value, factor);
+  value = vminnmq_f32(vmaxnmq_f32(value, vdupq_n_f32(INT16_LOW)), vdupq_n_f32(INT16_HIGH));
+  return vqmovn_s32(vcvtnq_s32_f32(value));
+}
+
+static inline float32x4_t neonFromInt16(int16x4_t value, float32x4_t inverse)
+{
+  return vmulq_f32(vcvtq_f32_s32(vmovl_s16(value)), inverse);
+}
+
+static void neonP2I32f(const float *src, int32_t stride, int32_t channels, int32_t samples, float *dst)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  int32_t s = 0;
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      float32x4x2_t pair = { { vld1q_f32(left + s), vld1q_f32(right + s) } };
+      vst2q_f32(dst + 2 * s, pair);
+    }
+    scalarPlanarToInterleaved32f(src + s, stride, 0, 2, samples - s, dst + 2 * s);
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 4 <= channels; c += 4)
+  {
+    const float *in0 = planarChannel(src, stride, c);
+    const float *in1 = planarChannel(src, stride, c + 1);
+    const float *in2 = planarChannel(src, stride, c + 2);
+    const float *in3 = planarChannel(src, stride, c + 3);
+    for (s = 0; s + 4 <= samples; s += 4)
+    {
+      float32x4_t r0 = vld1q_f32(in0 + s);
+      float32x4_t r1 = vld1q_f32(in1 + s);
+      float32x4_t r2 = vld1q_f32(in2 + s);
+      float32x4_t r3 = vld1q_f32(in3 + s);
+      neonTranspose4(r0, r1, r2, r3);
+      float *out = dst + (size_t)s * channels + c;
+      vst1q_f32(out, r0);
+      vst1q_f32(out + channels, r1);
+      vst1q_f32(out + 2 * channels, r2);
+      vst1q_f32(out + 3 * channels, r3);
+    }
+    for (; s < samples; s++)
+    {
+      float *out = dst + (size_t)s * channels + c;
+      out[0] = in0[s];
+      out[1] = in1[s];
+      out[2] = in2[s];
+      out[3] = in3[s];
+    }
+  }
+  scalarPlanarToInterleaved32f(src, stride, c, channels, samples, dst);
+}
+
+static void neonP2I16s(const float *src, int32_t stride, int32_t channels, int32_t samples,
+                       float scale, int16_t *dst)
+{
+  float32x4_t factor = vdupq_n_f32(scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 4 <= samples; s += 4)
+      vst1_s16(dst + s, neonToInt16(vld1q_f32(src + s), factor));
+    scalarPlanarToInterleaved16s(src + s, stride, 0, 1, samples - s, scale, dst + s);
+    return;
+  }
+  if (channels == 2)
+  {
+    const float *left = src;
+    const float *right = planarChannel(src, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      int16x4x2_t pair = { { neonToInt16(vld1q_f32(left + s), factor),
+                             neonToInt16(vld1q_f32(right + s), factor) } };
+      vst2_s16(dst + 2 * s, pair);
+    }
+    scalarPlanarToInterleaved16s(src + s, stride, 0, 2, samples - s, scale, dst + 2 * s);
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 4 <= channels; c += 4)
+  {
+    const float *in0 = planarChannel(src, stride, c);
+    const float *in1 = planarChannel(src, stride, c + 1);
+    const float *in2 = planarChannel(src, stride, c + 2);
+    const float *in3 = planarChannel(src, stride, c + 3);
+    for (s = 0; s + 4 <= samples; s += 4)
+    {
+      float32x4_t r0 = vld1q_f32(in0 + s);
+      float32x4_t r1 = vld1q_f32(in1 + s);
+      float32x4_t r2 = vld1q_f32(in2 + s);
+      float32x4_t r3 = vld1q_f32(in3 + s);
+      neonTranspose4(r0, r1, r2, r3);
+      int16_t *out = dst + (size_t)s * channels + c;
+      vst1_s16(out, neonToInt16(r0, factor));
+      vst1_s16(out + channels, neonToInt16(r1, factor));
+      vst1_s16(out + 2 * channels, neonToInt16(r2, factor));
+      vst1_s16(out + 3 * channels, neonToInt16(r3, factor));
+    }
+    for (; s < samples; s++)
+    {
+      int16_t *out = dst + (size_t)s * channels + c;
+      out[0] = toInt16(in0[s] * scale);
+      out[1] = toInt16(in1[s] * scale);
+      out[2] = toInt16(in2[s] * scale);
+      out[3] = toInt16(in3[s] * scale);
+    }
+  }
+  scalarPlanarToInterleaved16s(src, stride, c, channels, samples, scale, dst);
+}
+
+static void neonI2P32f(const float *src, int32_t channels, int32_t samples, float *dst, int32_t stride)
+{
+  if (channels == 1)
+  {
+    memcpy(dst, src, (size_t)samples * sizeof(float));
+    return;
+  }
+  int32_t s = 0;
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      float32x4x2_t pair = vld2q_f32(src + 2 * s);
+      vst1q_f32(left + s, pair.val[0]);
+      vst1q_f32(right + s, pair.val[1]);
+    }
+    scalarInterleaved32fToPlanar(src + 2 * s, 0, 2, samples - s, dst + s, stride);
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 4 <= channels; c += 4)
+  {
+    float *out0 = planarChannel(dst, stride, c);
+    float *out1 = planarChannel(dst, stride, c + 1);
+    float *out2 = planarChannel(dst, stride, c + 2);
+    float *out3 = planarChannel(dst, stride, c + 3);
+    for (s = 0; s + 4 <= samples; s += 4)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      float32x4_t r0 = vld1q_f32(in);
+      float32x4_t r1 = vld1q_f32(in + channels);
+      float32x4_t r2 = vld1q_f32(in + 2 * channels);
+      float32x4_t r3 = vld1q_f32(in + 3 * channels);
+      neonTranspose4(r0, r1, r2, r3);
+      vst1q_f32(out0 + s, r0);
+      vst1q_f32(out1 + s, r1);
+      vst1q_f32(out2 + s, r2);
+      vst1q_f32(out3 + s, r3);
+    }
+    for (; s < samples; s++)
+    {
+      const float *in = src + (size_t)s * channels + c;
+      out0[s] = in[0];
+      out1[s] = in[1];
+      out2[s] = in[2];
+      out3[s] = in[3];
+    }
+  }
+  scalarInterleaved32fToPlanar(src, c, channels, samples, dst, stride);
+}
+
+static void neonI2P16s(const int16_t *src, int32_t channels, int32_t samples, float scale,
+                       float *dst, int32_t stride)
+{
+  float32x4_t inverse = vdupq_n_f32(1.0f / scale);
+  int32_t s = 0;
+  if (channels == 1)
+  {
+    for (; s + 4 <= samples; s += 4)
+      vst1q_f32(dst + s, neonFromInt16(vld1_s16(src + s), inverse));
+    scalarInterleaved16sToPlanar(src + s, 0, 1, samples - s, scale, dst + s, stride);
+    return;
+  }
+  if (channels == 2)
+  {
+    float *left = dst;
+    float *right = planarChannel(dst, stride, 1);
+    for (; s + 4 <= samples; s += 4)
+    {
+      int16x4x2_t pair = vld2_s16(src + 2 * s);
+      vst1q_f32(left + s, neonFromInt16(pair.val[0], inverse));
+      vst1q_f32(right + s, neonFromInt16(pair.val[1], inverse));
+    }
+    scalarInterleaved16sToPlanar(src + 2 * s, 0, 2, samples - s, scale, dst + s, stride);
+    return;
+  }
+  int32_t c = 0;
+  for (; c + 4 <= channels; c += 4)
+  {
+    float *out0 = planarChannel(dst, stride, c);
+    float *out1 = planarChannel(dst, stride, c + 1);
+    float *out2 = planarChannel(dst, stride, c + 2);
+    float *out3 = planarChannel(dst, stride, c + 3);
+    for (s = 0; s + 4 <= samples; s += 4)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      float32x4_t r0 = neonFromInt16(vld1_s16(in), inverse);
+      float32x4_t r1 = neonFromInt16(vld1_s16(in + channels), inverse);
+      float32x4_t r2 = neonFromInt16(vld1_s16(in + 2 * channels), inverse);
+      float32x4_t r3 = neonFromInt16(vld1_s16(in + 3 * channels), inverse);
+      neonTranspose4(r0, r1, r2, r3);
+      vst1q_f32(out0 + s, r0);
+      vst1q_f32(out1 + s, r1);
+      vst1q_f32(out2 + s, r2);
+      vst1q_f32(out3 + s, r3);
+    }
+    for (; s < samples; s++)
+    {
+      const int16_t *in = src + (size_t)s * channels + c;
+      out0[s] = in[0] * (1.0f / scale);
+      out1[s] = in[1] * (1.0f / scale);
+      out2[s] = in[2] * (1.0f / scale);
+      out3[s] = in[3] * (1.0f / scale);
+    }
+  }
+  scalarInterleaved16sToPlanar(src, c, channels, samples, scale, dst, stride);
+}
+
+static const audioKernels neonKernels = {
+  "neon", neonP2I32f, neonP2I16s, neonI2P32f, neonI2P16s
+};
+
+#endif /* GRANDIOSE_SIMD_NEON */
+
+const audioKernels *findAudioKernels(const char *name)
+{
+  if (strcmp(name, scalarKernels.name) == 0)
+    return &scalarKernels;
+#ifdef GRANDIOSE_SIMD_X86
+  bool sse41, avx2;
+  detectX86(&sse41, &avx2);
+  if (avx2 && strcmp(name, avx2Kernels.name) == 0)
+    return &avx2Kernels;
+  if (sse41 && strcmp(name, sse41Kernels.name) == 0)
+    return &sse41Kernels;
+#endif
+#ifdef GRANDIOSE_SIMD_NEON
+  if (strcmp(name, neonKernels.name) == 0)
+    return &neonKernels;
+#endif
+  return nullptr;
+}
+
+static const audioKernels *selectAudioKernels()
+{
+  // Fastest first
+  static const char *preferred[] = { "avx2", "sse4.1", "neon" };
+  for (const char *name : preferred)
+  {
+    const audioKernels *kernels = findAudioKernels(name);
+    if (kernels != nullptr)
+      return kernels;
+  }
+  return &scalarKernels;
+}
+
+const audioKernels *getAudioKernels()
+{
+  static const audioKernels *kernels = selectAudioKernels();
+  return kernels;
+}
+
+float audioScale16s(int32_t referenceLevel)
+{
+  return INT16_HIGH * powf(10.0f, -referenceLevel / 20.0f);
+}
+
+void audioToInterleaved32f(const NDIlib_audio_frame_v2_t *frame, float *dst)
+{
+  getAudioKernels()->planarToInterleaved32f(frame->p_data, frame->channel_stride_in_bytes,
+                                            frame->no_channels, frame->no_samples, dst);
+}
+
+void audioToInterleaved16s(const NDIlib_audio_frame_v2_t *frame, int32_t referenceLevel, int16_t *dst)
+{
+  getAudioKernels()->planarToInterleaved16s(frame->p_data, frame->channel_stride_in_bytes,
+                                            frame->no_channels, frame->no_samples,
+                                            audioScale16s(referenceLevel), dst);
+}
+
+void audioFromInterleaved32f(const float *src, NDIlib_audio_frame_v2_t *frame)
+{
+  getAudioKernels()->interleaved32fToPlanar(src, frame->no_channels, frame->no_samples,
+                                            frame->p_data, frame->channel_stride_in_bytes);
+}
+
+void audioFromInterleaved16s(const int16_t *src, int32_t referenceLevel, NDIlib_audio_frame_v2_t *frame)
+{
+  getAudioKernels()->interleaved16sToPlanar(src, frame->no_channels, frame->no_samples,
+                                            audioScale16s(referenceLevel), frame->p_data,
+                                            frame->channel_stride_in_bytes);
+}
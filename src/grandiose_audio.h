@@ -0,0 +1,57 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_AUDIO_H
+#define GRANDIOSE_AUDIO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <Processing.NDI.Lib.h>
+
+// Audio sample conversion between the planar float layout used by NDI and the
+// interleaved layouts offered to JS. A set of kernels is picked once, on first
+// use, to suit the CPU in use: AVX2 or SSE4.1 on x86, NEON on ARM64, with a
+// plain C++ fallback. Strides are in bytes between the start of each channel
+// of a planar buffer. Conversions to and from 16-bit audio are scaled so that
+// the full 16-bit range sits referenceLevel dB above the NDI float reference
+// level, matching the NDI utility functions.
+struct audioKernels {
+  const char *name;
+  void (*planarToInterleaved32f)(const float *src, int32_t stride, int32_t channels,
+                                 int32_t samples, float *dst);
+  void (*planarToInterleaved16s)(const float *src, int32_t stride, int32_t channels,
+                                 int32_t samples, float scale, int16_t *dst);
+  void (*interleaved32fToPlanar)(const float *src, int32_t channels, int32_t samples,
+                                 float *dst, int32_t stride);
+  void (*interleaved16sToPlanar)(const int16_t *src, int32_t channels, int32_t samples,
+                                 float scale, float *dst, int32_t stride);
+};
+
+const audioKernels *getAudioKernels();
+// Kernels by name, or nullptr if they cannot run on this CPU. Names are
+// "scalar", "sse4.1", "avx2" and "neon".
+const audioKernels *findAudioKernels(const char *name);
+
+// Factor to multiply float samples by to give 16-bit samples
+float audioScale16s(int32_t referenceLevel);
+
+void audioToInterleaved32f(const NDIlib_audio_frame_v2_t *frame, float *dst);
+void audioToInterleaved16s(const NDIlib_audio_frame_v2_t *frame, int32_t referenceLevel, int16_t *dst);
+// Fill the planar p_data of frame, laid out by its no_channels, no_samples
+// and channel_stride_in_bytes, from interleaved samples
+void audioFromInterleaved32f(const float *src, NDIlib_audio_frame_v2_t *frame);
+void audioFromInterleaved16s(const int16_t *src, int32_t referenceLevel, NDIlib_audio_frame_v2_t *frame);
+
+#endif /* GRANDIOSE_AUDIO_H */
@@ -0,0 +1,262 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_batch.h"
+#include "grandiose_pool.h"
+#include "grandiose_receive.h"
+#include "grandiose_util.h"
+
+// Receivers still without a frame are polled this often until the wait is up
+#define BATCH_POLL_INTERVAL 1
+
+// Take whatever the receiver has waiting, converting it as a stream would
+void batchCapture(batchCarrier *c, size_t i)
+{
+  receiverInstance *instance = c->instances[i];
+  capturedFrame *frame = &c->frames[i];
+  frame->type = captureFrame(instance,
+                             c->captureVideo ? &frame->video : nullptr,
+                             c->captureAudio ? &frame->audio : nullptr,
+                             c->captureMetadata ? &frame->metadata : nullptr,
+                             0);
+  switch (frame->type)
+  {
+  case NDIlib_frame_type_video:
+    convertVideo(instance, &frame->video, &frame->videoData);
+    break;
+  case NDIlib_frame_type_audio:
+    convertAudio(instance, &frame->audio, c->audioFormat, c->referenceLevel, &frame->audioData);
+    break;
+  case NDIlib_frame_type_metadata:
+    break;
+  case NDIlib_frame_type_status_change:
+    // Only reported when every type is requested, as for data()
+    if (!(c->captureVideo && c->captureAudio && c->captureMetadata))
+      frame->type = NDIlib_frame_type_none;
+    break;
+  default:
+    frame->type = NDIlib_frame_type_none;
+    break;
+  }
+}
+
+// Rather than tie up a thread per receiver for the whole wait, every
+// receiver is polled across the pool, then those without a frame are
+// polled again until they all have one or the wait is over
+void batchExecute(napi_env env, void *data)
+{
+  batchCarrier *c = (batchCarrier *)data;
+  for (receiverInstance *instance : c->instances)
+    instance->stats.queue.recordSince(c->created);
+
+  HR_TIME_POINT deadline = NOW + std::chrono::milliseconds(c->wait);
+  std::vector<size_t> pending(c->instances.size());
+  for (size_t i = 0; i < pending.size(); i++)
+    pending[i] = i;
+
+  while (true)
+  {
+    workerPool::shared().parallelFor(pending.size(), [c, &pending](size_t i) {
+      batchCapture(c, pending[i]);
+    });
+
+    size_t remaining = 0;
+    for (size_t i : pending)
+      if (c->frames[i].type == NDIlib_frame_type_none)
+        pending[remaining++] = i;
+    pending.resize(remaining);
+    if (pending.empty() || NOW >= deadline)
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(BATCH_POLL_INTERVAL));
+  }
+}
+
+void batchComplete(napi_env env, napi_status asyncStatus, void *data)
+{
+  batchCarrier *c = (batchCarrier *)data;
+
+  if (asyncStatus != napi_ok)
+  {
+    c->status = asyncStatus;
+    c->errorMsg = "Async batch capture failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result, undefined, param;
+  c->status = napi_create_array_with_length(env, c->instances.size(), &result);
+  REJECT_STATUS;
+  c->status = napi_get_undefined(env, &undefined);
+  REJECT_STATUS;
+
+  for (size_t i = 0; i < c->instances.size(); i++)
+  {
+    receiverInstance *instance = c->instances[i];
+    capturedFrame *frame = &c->frames[i];
+    napi_value value = undefined;
+    switch (frame->type)
+    {
+    case NDIlib_frame_type_video:
+      c->status = makeVideoFrame(env, instance, &frame->video, &frame->videoData, &value);
+      frame->type = NDIlib_frame_type_none;
+      break;
+    case NDIlib_frame_type_audio:
+      c->status = makeAudioFrame(env, instance, &frame->audio, c->audioFormat,
+                                 c->referenceLevel, &frame->audioData, &value);
+      releaseAudioOutput(instance, &frame->audioData);
+      frame->type = NDIlib_frame_type_none;
+      break;
+    case NDIlib_frame_type_metadata:
+      c->status = makeMetadataFrame(env, instance, &frame->metadata, &value);
+      frame->type = NDIlib_frame_type_none;
+      break;
+    case NDIlib_frame_type_status_change:
+      c->status = napi_create_object(env, &value);
+      if (c->status == napi_ok)
+        c->status = napi_create_string_utf8(env, "statusChange", NAPI_AUTO_LENGTH, &param);
+      if (c->status == napi_ok)
+        c->status = napi_set_named_property(env, value, "type", param);
+      break;
+    default:
+      break;
+    }
+    REJECT_STATUS;
+    c->status = napi_set_element(env, result, (uint32_t)i, value);
+    REJECT_STATUS;
+  }
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value captureMany(napi_env env, napi_callback_info info)
+{
+  napi_valuetype type;
+  batchCarrier *c = new batchCarrier;
+
+  napi_value promise;
+  c->status = napi_create_promise(env, &c->_deferred, &promise);
+  REJECT_RETURN;
+
+  size_t argc = 2;
+  napi_value args[2];
+  c->status = napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+  REJECT_RETURN;
+
+  bool isArray = false;
+  if (argc >= 1)
+  {
+    c->status = napi_is_array(env, args[0], &isArray);
+    REJECT_RETURN;
+  }
+  if (!isArray)
+    REJECT_ERROR_RETURN("First argument must be an array of receivers.",
+                        GRANDIOSE_INVALID_ARGS);
+
+  if (argc >= 2)
+  {
+    c->status = napi_typeof(env, args[1], &type);
+    REJECT_RETURN;
+    if (type != napi_object && type != napi_undefined)
+      REJECT_ERROR_RETURN("Capture options must be an object.", GRANDIOSE_INVALID_ARGS);
+  }
+  if (argc >= 2 && type == napi_object)
+  {
+    napi_value options = args[1], param;
+    c->status = napi_get_named_property(env, options, "wait", &param);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, param, &type);
+    REJECT_RETURN;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        REJECT_ERROR_RETURN("Wait must be a number of milliseconds.", GRANDIOSE_INVALID_ARGS);
+      c->status = napi_get_value_uint32(env, param, &c->wait);
+      REJECT_RETURN;
+    }
+
+    c->status = napi_get_named_property(env, options, "types", &param);
+    REJECT_RETURN;
+    if (parseFrameTypes(env, param, &c->captureVideo, &c->captureAudio, &c->captureMetadata) != napi_ok)
+      REJECT_ERROR_RETURN("Capture types must be an array containing 'video', 'audio' or 'metadata'.",
+                          GRANDIOSE_INVALID_ARGS);
+
+    c->status = napi_get_named_property(env, options, "audioFormat", &param);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, param, &type);
+    REJECT_RETURN;
+    if (type != napi_undefined)
+    {
+      uint32_t audioFormatN;
+      if (type != napi_number)
+        REJECT_ERROR_RETURN("Audio format value must be a number if present.", GRANDIOSE_INVALID_ARGS);
+      c->status = napi_get_value_uint32(env, param, &audioFormatN);
+      REJECT_RETURN;
+      if (!validAudioFormat((Grandiose_audio_format_e)audioFormatN))
+        REJECT_ERROR_RETURN("Invalid audio format specified.", GRANDIOSE_INVALID_ARGS);
+      c->audioFormat = (Grandiose_audio_format_e)audioFormatN;
+    }
+
+    c->status = napi_get_named_property(env, options, "referenceLevel", &param);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, param, &type);
+    REJECT_RETURN;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        REJECT_ERROR_RETURN("Audio reference level must be a number if present.", GRANDIOSE_INVALID_ARGS);
+      c->status = napi_get_value_int32(env, param, &c->referenceLevel);
+      REJECT_RETURN;
+    }
+  }
+
+  uint32_t length;
+  c->status = napi_get_array_length(env, args[0], &length);
+  REJECT_RETURN;
+  c->instances.reserve(length);
+  c->frames.resize(length); // Before any receiver is taken, for the destructor
+  for (uint32_t i = 0; i < length; i++)
+  {
+    napi_value receiver;
+    receiverInstance *instance;
+    c->status = napi_get_element(env, args[0], i, &receiver);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, receiver, &type);
+    REJECT_RETURN;
+    if (type != napi_object || getReceiver(env, receiver, &instance) != napi_ok)
+      REJECT_ERROR_RETURN("Every item to capture from must be a receiver.", GRANDIOSE_INVALID_ARGS);
+    c->instances.push_back(instance);
+  }
+
+  c->status = queueWork(env, "CaptureMany", batchExecute, batchComplete, c);
+  REJECT_RETURN;
+
+  return promise;
+}
@@ -0,0 +1,46 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_BATCH_H
+#define GRANDIOSE_BATCH_H
+
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+#include "grandiose_stream.h"
+
+// Capture from many receivers in one async job, spread over the worker pool,
+// resolving to an array with a frame or undefined for each receiver
+napi_value captureMany(napi_env env, napi_callback_info info);
+
+struct batchCarrier : carrier {
+  uint32_t wait = 0;
+  bool captureVideo = true;
+  bool captureAudio = true;
+  bool captureMetadata = true;
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+  std::vector<receiverInstance*> instances;
+  std::vector<capturedFrame> frames; // One per receiver
+  ~batchCarrier() {
+    for (size_t i = 0; i < instances.size(); i++) {
+      releaseCapturedFrame(instances[i], &frames[i]);
+      releaseReceiver(instances[i]);
+    }
+  }
+};
+
+#endif /* GRANDIOSE_BATCH_H */
@@ -0,0 +1,143 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_connect.h"
+#include "grandiose_pool.h"
+#include "grandiose_receive.h"
+#include "grandiose_util.h"
+
+void connectExecute(napi_env env, void *data)
+{
+  connectCarrier *c = (connectCarrier *)data;
+  receiverInstance *instance = c->instance;
+
+  std::lock_guard<std::mutex> lock(instance->connectLock);
+  if (c->request < instance->connected)
+    return; // A later request has already been applied
+  NDIlib_recv_connect(instance->recv, c->source);
+  instance->connected = c->request;
+}
+
+void connectComplete(napi_env env, napi_status asyncStatus, void *data)
+{
+  connectCarrier *c = (connectCarrier *)data;
+
+  if (asyncStatus != napi_ok)
+  {
+    c->status = asyncStatus;
+    c->errorMsg = "Async receiver connection failed to complete.";
+  }
+  REJECT_STATUS;
+
+  // The receiver's source follows the latest connection made, and is
+  // undefined once disconnected
+  if (c->request == c->instance->connects)
+  {
+    napi_value receiver, source;
+    c->status = napi_get_reference_value(env, c->passthru, &receiver);
+    REJECT_STATUS;
+    if (c->source != nullptr)
+      c->status = makeSourceObject(env, c->source, &source);
+    else
+      c->status = napi_get_undefined(env, &source);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, receiver, "source", source);
+    REJECT_STATUS;
+  }
+
+  napi_value result;
+  c->status = napi_get_undefined(env, &result);
+  REJECT_STATUS;
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value connectReceiver(napi_env env, napi_callback_info info, bool disconnect)
+{
+  napi_valuetype type;
+  connectCarrier *c = new connectCarrier;
+
+  napi_value promise;
+  c->status = napi_create_promise(env, &c->_deferred, &promise);
+  REJECT_RETURN;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  REJECT_RETURN;
+
+  if (!disconnect)
+  {
+    if (argc < 1)
+      REJECT_ERROR_RETURN("Connect requires a source object.", GRANDIOSE_INVALID_ARGS);
+    bool isArray;
+    c->status = napi_typeof(env, args[0], &type);
+    REJECT_RETURN;
+    c->status = napi_is_array(env, args[0], &isArray);
+    REJECT_RETURN;
+    if ((type != napi_object) || isArray)
+      REJECT_ERROR_RETURN(
+          "Source must be an object and not an array.",
+          GRANDIOSE_INVALID_ARGS);
+
+    const char *sourceError;
+    c->status = checkSource(env, args[0], &sourceError);
+    REJECT_RETURN;
+    if (sourceError != nullptr)
+      REJECT_ERROR_RETURN(sourceError, GRANDIOSE_INVALID_ARGS);
+
+    c->source = new NDIlib_source_t();
+    c->status = makeNativeSource(env, args[0], c->source);
+    REJECT_RETURN;
+  }
+
+  c->status = getReceiver(env, thisValue, &c->instance);
+  REJECT_RETURN;
+  c->request = ++c->instance->connects;
+  c->status = napi_create_reference(env, thisValue, 1, &c->passthru);
+  REJECT_RETURN;
+
+  c->status = queueWork(env, disconnect ? "ReceiverDisconnect" : "ReceiverConnect",
+                       connectExecute, connectComplete, c);
+  REJECT_RETURN;
+
+  return promise;
+}
+
+napi_value receiverConnect(napi_env env, napi_callback_info info)
+{
+  return connectReceiver(env, info, false);
+}
+
+napi_value receiverDisconnect(napi_env env, napi_callback_info info)
+{
+  return connectReceiver(env, info, true);
+}
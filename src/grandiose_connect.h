@@ -0,0 +1,43 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_CONNECT_H
+#define GRANDIOSE_CONNECT_H
+
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+
+// Switch an existing receiver to another source, or away from any source,
+// keeping its pools, statistics and any stream or frame sync in place
+napi_value receiverConnect(napi_env env, napi_callback_info info);
+napi_value receiverDisconnect(napi_env env, napi_callback_info info);
+
+struct connectCarrier : carrier {
+  receiverInstance* instance = nullptr;
+  NDIlib_source_t* source = nullptr; // nullptr to disconnect
+  uint32_t request = 0;
+  ~connectCarrier() {
+    if (source != nullptr) {
+      free((char*)source->p_ndi_name);
+      free((char*)source->p_url_address);
+      delete source;
+    }
+    if (instance != nullptr)
+      releaseReceiver(instance);
+  }
+};
+
+#endif /* GRANDIOSE_CONNECT_H */
@@ -28,6 +28,8 @@
 #include "grandiose_find.h"
 #include "util.h"
 
+#define FINDER_WATCH_WAIT 200 // Milliseconds between checks to stop watching
+
 std::unique_ptr<Napi::FunctionReference> GrandioseFinder::Initialize(const Napi::Env &env, Napi::Object exports)
 {
   Napi::HandleScope scope(env);
@@ -37,6 +39,12 @@ std::unique_ptr<Napi::FunctionReference> GrandioseFinder::Initialize(const Napi:
 
                                                                 InstanceMethod<&GrandioseFinder::GetSources>("getCurrentSources", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
 
+                                                                InstanceMethod<&GrandioseFinder::StartWatching>("startWatching", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+
+                                                                InstanceMethod<&GrandioseFinder::StopWatching>("stopWatching", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+
+                                                                InstanceAccessor<&GrandioseFinder::GetGeneration>("generation", napi_enumerable),
+
                                                             });
 
   // Create a persistent reference to the class constructor
@@ -112,6 +120,8 @@ GrandioseFinder::~GrandioseFinder()
 
 void GrandioseFinder::cleanup()
 {
+  stopWatching();
+  sourceCache.clear();
   if (handle != nullptr)
   {
     NDIlib_find_destroy(handle);
@@ -136,18 +146,193 @@ Napi::Value GrandioseFinder::GetSources(const Napi::CallbackInfo &info)
     return env.Null();
   }
 
+  std::lock_guard<std::mutex> lock(sourcesLock);
   uint32_t count = 0;
   const NDIlib_source_t *sources = NDIlib_find_get_current_sources(handle, &count);
 
   if (!sources || count == 0)
+  {
+    sourceCache.clear();
     return Napi::Array::New(env, 0);
+  }
 
+  // Sources found last time are reused, frozen as they are shared between
+  // calls. Any that have gone are dropped from the cache.
+  std::unordered_map<std::string, Napi::ObjectReference> cache;
   Napi::Array result = Napi::Array::New(env, count);
   for (size_t i = 0; i < count; i++)
   {
     const NDIlib_source_t &source = sources[i];
-    result[i] = convertSourceToNapi(env, source);
+    std::string key = source.p_ndi_name ? source.p_ndi_name : "";
+    key.push_back('\n');
+    key.append(source.p_url_address ? source.p_url_address : "");
+
+    auto cached = cache.find(key);
+    if (cached == cache.end())
+    {
+      Napi::ObjectReference ref;
+      auto previous = sourceCache.find(key);
+      if (previous != sourceCache.end())
+        ref = std::move(previous->second);
+      else
+      {
+        Napi::Object object = convertSourceToNapi(env, source);
+        object.Freeze();
+        ref = Napi::Persistent(object);
+      }
+      cached = cache.emplace(key, std::move(ref)).first;
+    }
+    result[i] = cached->second.Value();
   }
+  sourceCache.swap(cache);
 
   return result;
 }
+
+Napi::Value GrandioseFinder::GetGeneration(const Napi::CallbackInfo &info)
+{
+  // While watching, the watch thread is the one waiting for changes
+  if (handle && !watch && NDIlib_find_wait_for_sources(handle, 0))
+    generation.fetch_add(1);
+
+  return Napi::Number::New(info.Env(), generation.load());
+}
+
+Napi::Value GrandioseFinder::StartWatching(const Napi::CallbackInfo &info)
+{
+  Napi::Env env = info.Env();
+
+  if (!handle)
+  {
+    Napi::Error::New(env, "GrandioseFinder has been disposed").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (watch)
+  {
+    Napi::Error::New(env, "GrandioseFinder is already watching").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (info.Length() < 1 || !info[0].IsFunction())
+  {
+    Napi::Error::New(env, "Expected a callback function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<GrandioseFinderWatch> state = std::make_shared<GrandioseFinderWatch>();
+  state->tsfn = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "GrandioseFinderWatch", 0, 1);
+  watch = state;
+  watchEnv = env;
+  state->thread = std::thread(&GrandioseFinder::watchSources, this, state);
+  napi_add_env_cleanup_hook(env, haltWatching, this);
+
+  return env.Null();
+}
+
+Napi::Value GrandioseFinder::StopWatching(const Napi::CallbackInfo &info)
+{
+  stopWatching();
+
+  return info.Env().Null();
+}
+
+// Hand the events gathered since the last call to JS. Calls are coalesced,
+// so one call may deliver the changes from several updates.
+void deliverSourceEvents(Napi::Env env, Napi::Function callback, std::shared_ptr<GrandioseFinderWatch> state)
+{
+  std::vector<GrandioseSourceEvent> events;
+  state->signalled.store(false);
+  {
+    std::lock_guard<std::mutex> lock(state->eventsLock);
+    events.swap(state->events);
+  }
+
+  for (const GrandioseSourceEvent &event : events)
+  {
+    Napi::Object source = Napi::Object::New(env);
+    source.Set("name", event.source.name);
+    source.Set("urlAddress", event.source.urlAddress);
+    source.Set("ipAddress", event.source.ipAddress);
+    callback.Call({Napi::String::New(env, event.type), source});
+  }
+}
+
+void GrandioseFinder::watchSources(std::shared_ptr<GrandioseFinderWatch> state)
+{
+  std::unordered_map<std::string, GrandioseSourceEntry> known;
+  bool first = true;
+  while (state->running.load())
+  {
+    // Report whatever is already known before waiting for changes
+    if (!first && !NDIlib_find_wait_for_sources(handle, FINDER_WATCH_WAIT))
+      continue;
+    first = false;
+
+    std::unordered_map<std::string, GrandioseSourceEntry> current;
+    {
+      std::lock_guard<std::mutex> lock(sourcesLock);
+      uint32_t count = 0;
+      const NDIlib_source_t *sources = NDIlib_find_get_current_sources(handle, &count);
+      for (uint32_t i = 0; sources != nullptr && i < count; i++)
+      {
+        GrandioseSourceEntry entry;
+        entry.name = sources[i].p_ndi_name ? sources[i].p_ndi_name : "";
+        entry.urlAddress = sources[i].p_url_address ? sources[i].p_url_address : "";
+        entry.ipAddress = sources[i].p_ip_address ? sources[i].p_ip_address : "";
+        current[entry.name] = entry;
+      }
+    }
+
+    std::vector<GrandioseSourceEvent> changes;
+    for (const auto &item : current)
+    {
+      auto previous = known.find(item.first);
+      if (previous == known.end())
+        changes.push_back({"sourceAdded", item.second});
+      else if (previous->second.urlAddress != item.second.urlAddress ||
+               previous->second.ipAddress != item.second.ipAddress)
+        changes.push_back({"sourceChanged", item.second});
+    }
+    for (const auto &item : known)
+    {
+      if (current.find(item.first) == current.end())
+        changes.push_back({"sourceRemoved", item.second});
+    }
+    known.swap(current);
+    if (changes.empty())
+      continue;
+    generation.fetch_add(1);
+
+    {
+      std::lock_guard<std::mutex> lock(state->eventsLock);
+      state->events.insert(state->events.end(), changes.begin(), changes.end());
+    }
+    if (!state->signalled.exchange(true))
+      state->tsfn.NonBlockingCall([state](Napi::Env env, Napi::Function callback)
+                                  { deliverSourceEvents(env, callback, state); });
+  }
+}
+
+void GrandioseFinder::haltWatch()
+{
+  if (!watch)
+    return;
+  watch->running.store(false);
+  if (watch->thread.joinable())
+    watch->thread.join();
+  // Events not yet delivered are dropped along with the watch
+  watch->tsfn.Abort();
+  watch.reset();
+}
+
+void GrandioseFinder::haltWatching(void *arg)
+{
+  ((GrandioseFinder *)arg)->haltWatch();
+}
+
+void GrandioseFinder::stopWatching()
+{
+  if (!watch)
+    return;
+  napi_remove_env_cleanup_hook(watchEnv, haltWatching, this);
+  haltWatch();
+}
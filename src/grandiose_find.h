@@ -17,7 +17,14 @@
 
 #include "napi.h"
 #include "grandiose_util.h"
+#include <atomic>
 #include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <Processing.NDI.Lib.h>
 
 struct GrandioseFinderOptions
@@ -27,6 +34,32 @@ struct GrandioseFinderOptions
   std::string extraIPs;
 };
 
+struct GrandioseSourceEntry
+{
+  std::string name;
+  std::string urlAddress;
+  std::string ipAddress;
+};
+
+struct GrandioseSourceEvent
+{
+  const char *type; // sourceAdded, sourceRemoved or sourceChanged
+  GrandioseSourceEntry source;
+};
+
+// Native thread waiting on the finder for changes to the list of sources,
+// handing the differences to JS through a threadsafe function. Shared with
+// the calls queued on the threadsafe function, which may outlive the finder.
+struct GrandioseFinderWatch
+{
+  std::thread thread;
+  std::atomic<bool> running{true};
+  std::atomic<bool> signalled{false};
+  Napi::ThreadSafeFunction tsfn;
+  std::mutex eventsLock;
+  std::vector<GrandioseSourceEvent> events;
+};
+
 class GrandioseFinder : public Napi::ObjectWrap<GrandioseFinder>
 {
 public:
@@ -40,9 +73,26 @@ private:
   Napi::Value Dispose(const Napi::CallbackInfo &info);
 
   Napi::Value GetSources(const Napi::CallbackInfo &info);
+  Napi::Value GetGeneration(const Napi::CallbackInfo &info);
+  Napi::Value StartWatching(const Napi::CallbackInfo &info);
+  Napi::Value StopWatching(const Napi::CallbackInfo &info);
 
   void cleanup();
+  void watchSources(std::shared_ptr<GrandioseFinderWatch> state);
+  void stopWatching();
+  void haltWatch();
+  static void haltWatching(void *arg);
 
   NDIlib_find_instance_t handle = nullptr;
   GrandioseFinderOptions options;
+  // The SDK's list of current sources is only valid until the next call
+  // for it, so calls from JS and the watch thread take turns
+  std::mutex sourcesLock;
+  std::shared_ptr<GrandioseFinderWatch> watch;
+  // Source objects from the last call for the list, by name and URL, so
+  // that unchanged sources are handed out again rather than remade
+  std::unordered_map<std::string, Napi::ObjectReference> sourceCache;
+  // Moves on whenever the list of sources is seen to change
+  std::atomic<uint32_t> generation{0};
+  napi_env watchEnv = nullptr; // For removing the cleanup hook
 };
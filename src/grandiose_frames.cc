@@ -0,0 +1,403 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_frames.h"
+#include "grandiose_pool.h"
+#include "grandiose_receive.h"
+#include "grandiose_util.h"
+
+// Time to block in each prefetch capture before trying again
+#define PREFETCH_CAPTURE_WAIT 1000
+#define PREFETCH_MAX 64
+
+void prefetchComplete(napi_env env, napi_status asyncStatus, void *data);
+
+void releasePrefetch(napi_env env, prefetchState *s)
+{
+  if (--s->refs > 0)
+    return;
+  napi_status status;
+  for (auto &result : s->ready)
+  {
+    status = napi_delete_reference(env, result.value);
+    FLOATING_STATUS;
+  }
+  releaseReceiver(s->instance);
+  delete s;
+}
+
+void finalizeFrames(napi_env env, void *data, void *hint)
+{
+  releasePrefetch(env, (prefetchState *)data);
+}
+
+napi_status makeIterResult(napi_env env, napi_value value, bool done, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  if (value == nullptr)
+  {
+    status = napi_get_undefined(env, &value);
+    PASS_STATUS;
+  }
+  status = napi_set_named_property(env, *result, "value", value);
+  PASS_STATUS;
+  status = napi_get_boolean(env, done, &param);
+  PASS_STATUS;
+  return napi_set_named_property(env, *result, "done", param);
+}
+
+napi_status settle(napi_env env, napi_deferred deferred, napi_value value, bool error)
+{
+  if (error)
+    return napi_reject_deferred(env, deferred, value);
+  napi_status status;
+  napi_value result;
+  status = makeIterResult(env, value, value == nullptr, &result);
+  PASS_STATUS;
+  return napi_resolve_deferred(env, deferred, result);
+}
+
+// End iteration, resolving anyone still waiting with done
+void finishPrefetch(napi_env env, prefetchState *s)
+{
+  napi_status status;
+  s->done = true;
+  while (!s->waiting.empty())
+  {
+    status = settle(env, s->waiting.front(), nullptr, false);
+    FLOATING_STATUS;
+    s->waiting.pop_front();
+  }
+}
+
+// Queue the next capture, unless one is running or enough are buffered
+napi_status pumpPrefetch(napi_env env, prefetchState *s)
+{
+  if (s->inFlight || s->done || s->ready.size() >= s->prefetch)
+    return napi_ok;
+
+  napi_status status;
+  prefetchCarrier *c = new prefetchCarrier;
+  c->state = s;
+  c->instance = s->instance;
+  retainReceiver(s->instance);
+  c->recv = s->instance->recv;
+  c->wait = PREFETCH_CAPTURE_WAIT;
+  c->captureVideo = s->captureVideo;
+  c->captureAudio = s->captureAudio;
+  c->captureMetadata = s->captureMetadata;
+  c->audioFormat = s->audioFormat;
+  c->referenceLevel = s->referenceLevel;
+
+  status = queueWork(env, "FramesReceive", dataReceiveExecute, prefetchComplete, c);
+  if (status != napi_ok)
+  {
+    tidyCarrier(env, c);
+    return status;
+  }
+
+  s->inFlight = true;
+  s->refs++;
+  return napi_ok;
+}
+
+void prefetchComplete(napi_env env, napi_status asyncStatus, void *data)
+{
+  prefetchCarrier *c = (prefetchCarrier *)data;
+  prefetchState *s = c->state;
+  napi_status status = napi_ok;
+  napi_value value = nullptr;
+  bool error = false;
+  s->inFlight = false;
+
+  switch (asyncStatus == napi_ok ? c->frameType : NDIlib_frame_type_none)
+  {
+  case NDIlib_frame_type_video:
+    status = makeVideoFrame(env, s->instance, &c->videoFrame, &c->videoData, &value);
+    break;
+  case NDIlib_frame_type_audio:
+    status = makeAudioFrame(env, s->instance, &c->audioFrame, c->audioFormat,
+                            c->referenceLevel, &c->audioData, &value);
+    break;
+  case NDIlib_frame_type_metadata:
+    status = makeMetadataFrame(env, s->instance, &c->metadataFrame, &value);
+    break;
+  case NDIlib_frame_type_error:
+    error = true;
+    status = makeError(env, GRANDIOSE_CONNECTION_LOST,
+                       "Received error response from NDI data request. Connection lost.", &value);
+    break;
+  case NDIlib_frame_type_status_change:
+    napi_value param;
+    status = napi_create_object(env, &value);
+    if (status == napi_ok)
+      status = napi_create_string_utf8(env, "statusChange", NAPI_AUTO_LENGTH, &param);
+    if (status == napi_ok)
+      status = napi_set_named_property(env, value, "type", param);
+    break;
+  default: // Nothing arrived in time - try again
+    break;
+  }
+  if (asyncStatus != napi_ok || status != napi_ok)
+  {
+    error = true;
+    status = makeError(env, GRANDIOSE_ASYNC_FAILURE, "Failed to capture prefetched frame.", &value);
+    FLOATING_STATUS;
+  }
+
+  if (value != nullptr && !s->done)
+  {
+    if (!s->waiting.empty())
+    {
+      status = settle(env, s->waiting.front(), value, error);
+      FLOATING_STATUS;
+      s->waiting.pop_front();
+    }
+    else
+    {
+      prefetchResult result = {nullptr, error};
+      status = napi_create_reference(env, value, 1, &result.value);
+      FLOATING_STATUS;
+      s->ready.push_back(result);
+    }
+  }
+  if (error)
+    finishPrefetch(env, s);
+
+  tidyCarrier(env, c);
+  status = pumpPrefetch(env, s);
+  FLOATING_STATUS;
+  releasePrefetch(env, s);
+}
+
+napi_status getPrefetch(napi_env env, napi_callback_info info, prefetchState **result)
+{
+  napi_status status;
+  napi_value thisValue, embedded;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  PASS_STATUS;
+  status = napi_get_named_property(env, thisValue, "embedded", &embedded);
+  PASS_STATUS;
+  return napi_get_value_external(env, embedded, (void **)result);
+}
+
+napi_value framesNext(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  prefetchState *s;
+  status = getPrefetch(env, info, &s);
+  CHECK_STATUS;
+
+  napi_value promise;
+  napi_deferred deferred;
+  status = napi_create_promise(env, &deferred, &promise);
+  CHECK_STATUS;
+
+  if (!s->ready.empty())
+  {
+    prefetchResult result = s->ready.front();
+    s->ready.pop_front();
+    napi_value value;
+    status = napi_get_reference_value(env, result.value, &value);
+    CHECK_STATUS;
+    status = napi_delete_reference(env, result.value);
+    CHECK_STATUS;
+    status = settle(env, deferred, value, result.error);
+    CHECK_STATUS;
+  }
+  else if (s->done)
+  {
+    status = settle(env, deferred, nullptr, false);
+    CHECK_STATUS;
+  }
+  else
+    s->waiting.push_back(deferred);
+
+  status = pumpPrefetch(env, s);
+  CHECK_STATUS;
+  return promise;
+}
+
+napi_value framesReturn(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  prefetchState *s;
+  status = getPrefetch(env, info, &s);
+  CHECK_STATUS;
+
+  finishPrefetch(env, s);
+  for (auto &result : s->ready)
+  {
+    status = napi_delete_reference(env, result.value);
+    CHECK_STATUS;
+  }
+  s->ready.clear();
+
+  napi_value promise;
+  napi_deferred deferred;
+  status = napi_create_promise(env, &deferred, &promise);
+  CHECK_STATUS;
+  status = settle(env, deferred, nullptr, false);
+  CHECK_STATUS;
+  return promise;
+}
+
+napi_value returnThis(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+  return thisValue;
+}
+
+napi_value framesReceive(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  uint32_t prefetch = 2;
+  bool captureVideo = true, captureAudio = true, captureMetadata = true;
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+
+  type = napi_undefined;
+  if (argc >= 1)
+  {
+    status = napi_typeof(env, args[0], &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Frames options must be an object.");
+  }
+  if (type == napi_object)
+  {
+    napi_value param;
+    status = napi_get_named_property(env, args[0], "prefetch", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Prefetch must be a number.");
+      status = napi_get_value_uint32(env, param, &prefetch);
+      CHECK_STATUS;
+      if (prefetch < 1 || prefetch > PREFETCH_MAX)
+        NAPI_THROW_ERROR("Prefetch must be between 1 and 64.");
+    }
+
+    status = napi_get_named_property(env, args[0], "types", &param);
+    CHECK_STATUS;
+    if (parseFrameTypes(env, param, &captureVideo, &captureAudio, &captureMetadata) != napi_ok)
+      NAPI_THROW_ERROR("Frame types must be an array containing 'video', 'audio' or 'metadata'.");
+
+    status = napi_get_named_property(env, args[0], "audioFormat", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      uint32_t audioFormatN;
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio format value must be a number if present.");
+      status = napi_get_value_uint32(env, param, &audioFormatN);
+      CHECK_STATUS;
+      if (!validAudioFormat((Grandiose_audio_format_e)audioFormatN))
+        NAPI_THROW_ERROR("Invalid audio format specified.");
+      audioFormat = (Grandiose_audio_format_e)audioFormatN;
+    }
+
+    status = napi_get_named_property(env, args[0], "referenceLevel", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio reference level must be a number if present.");
+      status = napi_get_value_int32(env, param, &referenceLevel);
+      CHECK_STATUS;
+    }
+  }
+
+  prefetchState *s = new prefetchState;
+  status = getReceiver(env, thisValue, &s->instance);
+  if (status != napi_ok)
+    delete s;
+  CHECK_STATUS;
+  s->prefetch = prefetch;
+  s->captureVideo = captureVideo;
+  s->captureAudio = captureAudio;
+  s->captureMetadata = captureMetadata;
+  s->audioFormat = audioFormat;
+  s->referenceLevel = referenceLevel;
+
+  napi_value result, embedded, fn;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+  status = napi_create_external(env, s, finalizeFrames, nullptr, &embedded);
+  if (status != napi_ok)
+    releasePrefetch(env, s);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "embedded", embedded);
+  CHECK_STATUS;
+
+  status = napi_create_function(env, "next", NAPI_AUTO_LENGTH, framesNext, nullptr, &fn);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "next", fn);
+  CHECK_STATUS;
+  status = napi_create_function(env, "return", NAPI_AUTO_LENGTH, framesReturn, nullptr, &fn);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "return", fn);
+  CHECK_STATUS;
+
+  napi_value global, symbol, asyncIterator;
+  status = napi_get_global(env, &global);
+  CHECK_STATUS;
+  status = napi_get_named_property(env, global, "Symbol", &symbol);
+  CHECK_STATUS;
+  status = napi_get_named_property(env, symbol, "asyncIterator", &asyncIterator);
+  CHECK_STATUS;
+  status = napi_create_function(env, "[Symbol.asyncIterator]", NAPI_AUTO_LENGTH, returnThis,
+                                nullptr, &fn);
+  CHECK_STATUS;
+  status = napi_set_property(env, result, asyncIterator, fn);
+  CHECK_STATUS;
+
+  // Start capturing straight away, ahead of the first call to next()
+  status = pumpPrefetch(env, s);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,54 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_FRAMES_H
+#define GRANDIOSE_FRAMES_H
+
+#include <deque>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+
+napi_value framesReceive(napi_env env, napi_callback_info info);
+
+struct prefetchResult {
+  napi_ref value;
+  bool error;
+};
+
+// State behind an async iterator returned by receiver.frames(). Captures are
+// chained one after another on the thread pool so that frames stay in order,
+// running up to `prefetch` frames ahead of the consumer. Only accessed on the
+// JS thread.
+struct prefetchState {
+  receiverInstance* instance = nullptr;
+  uint32_t prefetch = 2;
+  bool captureVideo = true;
+  bool captureAudio = true;
+  bool captureMetadata = true;
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+  std::deque<prefetchResult> ready;
+  std::deque<napi_deferred> waiting;
+  bool inFlight = false;
+  bool done = false;
+  int32_t refs = 1; // The iterator object plus any capture in flight
+};
+
+struct prefetchCarrier : dataCarrier {
+  prefetchState* state = nullptr;
+};
+
+#endif /* GRANDIOSE_FRAMES_H */
@@ -0,0 +1,311 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_framesync.h"
+#include "grandiose_receive.h"
+#include "grandiose_video.h"
+#include "grandiose_util.h"
+
+napi_value captureSyncVideo(napi_env env, napi_callback_info info);
+napi_value captureSyncAudio(napi_env env, napi_callback_info info);
+napi_value syncAudioQueueDepth(napi_env env, napi_callback_info info);
+
+void finalizeFrameSync(napi_env env, void *data, void *hint)
+{
+  frameSyncInstance *fs = (frameSyncInstance *)data;
+  NDIlib_framesync_destroy(fs->sync);
+  fs->instance->synced = false;
+  releaseReceiver(fs->instance);
+  delete fs;
+}
+
+napi_status getFrameSync(napi_env env, napi_value value, frameSyncInstance **result)
+{
+  napi_status status;
+  napi_value syncValue;
+  status = napi_get_named_property(env, value, "embedded", &syncValue);
+  PASS_STATUS;
+  void *syncData;
+  status = napi_get_value_external(env, syncValue, &syncData);
+  PASS_STATUS;
+  *result = (frameSyncInstance *)syncData;
+  return napi_ok;
+}
+
+// Put a frame sync in front of the receiver. Frames are then only captured
+// through the returned object, which keeps the receiver alive.
+napi_value frameSync(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  if (receiverBusy(instance, false))
+  {
+    releaseReceiver(instance);
+    NAPI_THROW_ERROR(GRANDIOSE_RECEIVER_BUSY);
+  }
+
+  frameSyncInstance *fs = new frameSyncInstance;
+  fs->instance = instance; // Takes the reference from getReceiver
+  fs->sync = NDIlib_framesync_create(instance->recv);
+  if (fs->sync == nullptr)
+  {
+    releaseReceiver(instance);
+    delete fs;
+    NAPI_THROW_ERROR("Failed to create NDI frame sync.");
+  }
+
+  napi_value result, embedded;
+  status = napi_create_object(env, &result);
+  if (status == napi_ok)
+    status = napi_create_external(env, fs, finalizeFrameSync, nullptr, &embedded);
+  if (status != napi_ok)
+  {
+    NDIlib_framesync_destroy(fs->sync);
+    releaseReceiver(instance);
+    delete fs;
+  }
+  CHECK_STATUS;
+  instance->synced = true;
+  status = napi_set_named_property(env, result, "embedded", embedded);
+  CHECK_STATUS;
+
+  napi_property_descriptor desc[] = {
+      DECLARE_NAPI_METHOD("captureVideo", captureSyncVideo),
+      DECLARE_NAPI_METHOD("captureAudio", captureSyncAudio),
+      DECLARE_NAPI_METHOD("audioQueueDepth", syncAudioQueueDepth)};
+  status = napi_define_properties(env, result, 3, desc);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "receiver", thisValue);
+  CHECK_STATUS;
+
+  return result;
+}
+
+// Take the latest video frame, or undefined if none has been received yet.
+// The same frame may be returned more than once.
+napi_value captureSyncVideo(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  NDIlib_frame_format_type_e fieldType = NDIlib_frame_format_type_progressive;
+  if (argc >= 1)
+  {
+    status = napi_typeof(env, args[0], &type);
+    CHECK_STATUS;
+    if (type == napi_number)
+    {
+      int32_t fieldTypeN;
+      status = napi_get_value_int32(env, args[0], &fieldTypeN);
+      CHECK_STATUS;
+      if (!validFrameFormat((NDIlib_frame_format_type_e)fieldTypeN))
+        NAPI_THROW_ERROR("Invalid frame format type specified.");
+      fieldType = (NDIlib_frame_format_type_e)fieldTypeN;
+    }
+    else if (type != napi_undefined)
+      NAPI_THROW_ERROR("Frame format type must be a number if present.");
+  }
+
+  frameSyncInstance *fs;
+  status = getFrameSync(env, thisValue, &fs);
+  CHECK_STATUS;
+  receiverInstance *instance = fs->instance;
+
+  napi_value result;
+  NDIlib_video_frame_v2_t frame;
+  NDIlib_framesync_capture_video(fs->sync, &frame, fieldType);
+  if (frame.p_data == nullptr)
+  {
+    NDIlib_framesync_free_video(fs->sync, &frame);
+    status = napi_get_undefined(env, &result);
+    CHECK_STATUS;
+    return result;
+  }
+
+  // Frames stay with the frame sync, so are converted or copied out into a
+  // block from the receiver's pool, in place of the SDK's own frame
+  videoOutput output;
+  size_t size = 0;
+  if (instance->outputFormat != Grandiose_video_format_native)
+    size = videoOutputSize(&frame, instance->outputFormat, &output.lineStride);
+  if (size > 0)
+  {
+    HR_TIME_POINT start = NOW;
+    output.data = instance->video.acquire(size);
+    output.size = size;
+    convertVideoFrame(&frame, instance->outputFormat, (uint8_t *)output.data);
+    instance->stats.conversion.recordSince(start);
+  }
+  else
+  {
+    output.size = (size_t)frame.line_stride_in_bytes * frame.yres;
+    output.lineStride = frame.line_stride_in_bytes;
+    output.data = instance->video.acquire(output.size);
+    output.copy = true;
+    memcpy(output.data, frame.p_data, output.size);
+    instance->stats.addCopy(output.size);
+  }
+  if (frame.p_metadata != nullptr)
+    output.metadata = strdup(frame.p_metadata);
+  NDIlib_framesync_free_video(fs->sync, &frame);
+  frame.p_data = nullptr;
+  frame.p_metadata = output.metadata;
+
+  status = makeVideoFrame(env, instance, &frame, &output, &result);
+  releaseVideoOutput(instance, &output);
+  CHECK_STATUS;
+  return result;
+}
+
+// Take audio resampled to the given rate, channels and samples, which is
+// always available, padded with silence as required. An optional final
+// argument gives the audioFormat and referenceLevel of the result.
+napi_value captureSyncAudio(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 4;
+  napi_value args[4];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+  if (argc < 3)
+    NAPI_THROW_ERROR("Audio capture requires sample rate, channels and samples.");
+
+  int32_t params[3];
+  for (int x = 0; x < 3; x++)
+  {
+    status = napi_typeof(env, args[x], &type);
+    CHECK_STATUS;
+    if (type != napi_number)
+      NAPI_THROW_ERROR("Sample rate, channels and samples must be numbers.");
+    status = napi_get_value_int32(env, args[x], &params[x]);
+    CHECK_STATUS;
+    if (params[x] < 0)
+      NAPI_THROW_ERROR("Sample rate, channels and samples must not be negative.");
+  }
+
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+  if (argc >= 4)
+  {
+    status = napi_typeof(env, args[3], &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Audio options must be an object.");
+  }
+  if (argc >= 4 && type == napi_object)
+  {
+    napi_value param;
+    status = napi_get_named_property(env, args[3], "audioFormat", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      uint32_t audioFormatN;
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio format value must be a number if present.");
+      status = napi_get_value_uint32(env, param, &audioFormatN);
+      CHECK_STATUS;
+      if (!validAudioFormat((Grandiose_audio_format_e)audioFormatN))
+        NAPI_THROW_ERROR("Invalid audio format specified.");
+      audioFormat = (Grandiose_audio_format_e)audioFormatN;
+    }
+
+    status = napi_get_named_property(env, args[3], "referenceLevel", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio reference level must be a number if present.");
+      status = napi_get_value_int32(env, param, &referenceLevel);
+      CHECK_STATUS;
+    }
+  }
+
+  frameSyncInstance *fs;
+  status = getFrameSync(env, thisValue, &fs);
+  CHECK_STATUS;
+  receiverInstance *instance = fs->instance;
+
+  NDIlib_audio_frame_v2_t frame;
+  NDIlib_framesync_capture_audio(fs->sync, &frame, params[0], params[1], params[2]);
+
+  // Always take the samples out of the SDK frame, converting if required
+  audioOutput output;
+  convertAudio(instance, &frame, audioFormat, referenceLevel, &output);
+  if (output.data == nullptr && output.size > 0)
+  {
+    output.data = instance->audio.acquire(output.size);
+    output.pooled = true;
+    memcpy(output.data, frame.p_data, output.size);
+    instance->stats.addCopy(output.size);
+  }
+  NDIlib_framesync_free_audio(fs->sync, &frame);
+  frame.p_data = nullptr;
+  frame.p_metadata = nullptr;
+
+  napi_value result;
+  status = makeAudioFrame(env, instance, &frame, audioFormat, referenceLevel, &output, &result);
+  releaseAudioOutput(instance, &output);
+  CHECK_STATUS;
+  return result;
+}
+
+// Approximate number of samples waiting in the frame sync's audio queue
+napi_value syncAudioQueueDepth(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  frameSyncInstance *fs;
+  status = getFrameSync(env, thisValue, &fs);
+  CHECK_STATUS;
+
+  napi_value result;
+  status = napi_create_int32(env, NDIlib_framesync_audio_queue_depth(fs->sync), &result);
+  CHECK_STATUS;
+  return result;
+}
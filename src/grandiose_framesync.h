@@ -0,0 +1,33 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_FRAMESYNC_H
+#define GRANDIOSE_FRAMESYNC_H
+
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+
+napi_value frameSync(napi_env env, napi_callback_info info);
+
+// An NDI frame synchronizer in front of a receiver. Captures are made on the
+// JS thread and always return immediately, time-base corrected to the rate
+// at which they are called.
+struct frameSyncInstance {
+  NDIlib_framesync_instance_t sync = nullptr;
+  receiverInstance* instance = nullptr; // Referenced for the life of the sync
+};
+
+#endif /* GRANDIOSE_FRAMESYNC_H */
@@ -0,0 +1,215 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_poll.h"
+#include "grandiose_receive.h"
+#include "grandiose_util.h"
+
+// Read the audio options of a poll, as for receiver.audio(). Throws and
+// returns false when an option is invalid.
+bool readPollAudioOptions(napi_env env, napi_value config, Grandiose_audio_format_e *audioFormat,
+                          int32_t *referenceLevel, audioOutput *output)
+{
+  napi_status status;
+  napi_valuetype type;
+  napi_value param;
+
+  status = napi_typeof(env, config, &type);
+  if (status == napi_ok && type == napi_undefined)
+    return true;
+  bool isArray = false;
+  if (status == napi_ok && type == napi_object)
+    status = napi_is_array(env, config, &isArray);
+  if (status != napi_ok)
+    return checkStatus(env, status, __FILE__, __LINE__) == napi_ok;
+  if (type != napi_object || isArray)
+  {
+    napi_throw_error(env, nullptr, "Audio options must be an object if present.");
+    return false;
+  }
+
+  status = napi_get_named_property(env, config, "audioFormat", &param);
+  if (status == napi_ok)
+    status = napi_typeof(env, param, &type);
+  if (status == napi_ok && type == napi_number)
+  {
+    uint32_t audioFormatN;
+    status = napi_get_value_uint32(env, param, &audioFormatN);
+    if (status == napi_ok && !validAudioFormat((Grandiose_audio_format_e)audioFormatN))
+    {
+      napi_throw_error(env, nullptr, "Invalid audio format specified.");
+      return false;
+    }
+    *audioFormat = (Grandiose_audio_format_e)audioFormatN;
+  }
+  else if (status == napi_ok && type != napi_undefined)
+  {
+    napi_throw_error(env, nullptr, "Audio format value must be a number if present.");
+    return false;
+  }
+
+  if (status == napi_ok)
+    status = napi_get_named_property(env, config, "referenceLevel", &param);
+  if (status == napi_ok)
+    status = napi_typeof(env, param, &type);
+  if (status == napi_ok && type == napi_number)
+    status = napi_get_value_int32(env, param, referenceLevel);
+  else if (status == napi_ok && type != napi_undefined)
+  {
+    napi_throw_error(env, nullptr, "Audio reference level must be a number if present.");
+    return false;
+  }
+
+  // Optional Buffer to convert samples straight into
+  bool isBuffer = false;
+  if (status == napi_ok)
+    status = napi_get_named_property(env, config, "buffer", &param);
+  if (status == napi_ok)
+    status = napi_is_buffer(env, param, &isBuffer);
+  if (status == napi_ok && isBuffer)
+  {
+    void *targetData;
+    status = napi_get_buffer_info(env, param, &targetData, &output->targetLength);
+    if (status == napi_ok)
+      status = napi_create_reference(env, param, 1, &output->target);
+    output->targetData = (char *)targetData;
+  }
+  else if (status == napi_ok)
+  {
+    status = napi_typeof(env, param, &type);
+    if (status == napi_ok && type != napi_undefined)
+    {
+      napi_throw_error(env, nullptr, "Audio buffer must be a Node Buffer if present.");
+      return false;
+    }
+  }
+
+  return checkStatus(env, status, __FILE__, __LINE__) == napi_ok;
+}
+
+// Capture whatever of the requested frame types is already waiting. Status
+// changes are only reported when every type is requested, as for data().
+napi_value tryReceive(napi_env env, napi_callback_info info,
+                      bool captureVideo, bool captureAudio, bool captureMetadata)
+{
+  napi_status status;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+  audioOutput audioData;
+  if (captureAudio && argc >= 1 &&
+      !readPollAudioOptions(env, args[0], &audioFormat, &referenceLevel, &audioData))
+  {
+    if (audioData.target != nullptr)
+      napi_delete_reference(env, audioData.target);
+    return nullptr;
+  }
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  if (status != napi_ok && audioData.target != nullptr)
+    napi_delete_reference(env, audioData.target);
+  CHECK_STATUS;
+
+  NDIlib_video_frame_v2_t videoFrame;
+  NDIlib_audio_frame_v2_t audioFrame;
+  NDIlib_metadata_frame_t metadataFrame;
+  NDIlib_frame_type_e frameType = captureFrame(instance,
+                                               captureVideo ? &videoFrame : nullptr,
+                                               captureAudio ? &audioFrame : nullptr,
+                                               captureMetadata ? &metadataFrame : nullptr,
+                                               0);
+
+  napi_value result = nullptr, param;
+  videoOutput videoData;
+  switch (frameType)
+  {
+  case NDIlib_frame_type_video:
+    convertVideo(instance, &videoFrame, &videoData);
+    status = makeVideoFrame(env, instance, &videoFrame, &videoData, &result);
+    releaseVideoOutput(instance, &videoData);
+    break;
+
+  case NDIlib_frame_type_audio:
+    convertAudio(instance, &audioFrame, audioFormat, referenceLevel, &audioData);
+    status = makeAudioFrame(env, instance, &audioFrame, audioFormat, referenceLevel,
+                            &audioData, &result);
+    releaseAudioOutput(instance, &audioData);
+    break;
+
+  case NDIlib_frame_type_metadata:
+    status = makeMetadataFrame(env, instance, &metadataFrame, &result);
+    break;
+
+  case NDIlib_frame_type_status_change:
+    if (!(captureVideo && captureAudio && captureMetadata))
+      break;
+    status = napi_create_object(env, &result);
+    if (status == napi_ok)
+      status = napi_create_string_utf8(env, "statusChange", NAPI_AUTO_LENGTH, &param);
+    if (status == napi_ok)
+      status = napi_set_named_property(env, result, "type", param);
+    break;
+
+  default:
+    break;
+  }
+
+  if (audioData.target != nullptr)
+    napi_delete_reference(env, audioData.target);
+  releaseReceiver(instance);
+  if (frameType == NDIlib_frame_type_error)
+    NAPI_THROW_ERROR("Received error response from NDI data request. Connection lost.");
+  CHECK_STATUS;
+
+  if (result == nullptr)
+  {
+    status = napi_get_undefined(env, &result);
+    CHECK_STATUS;
+  }
+  return result;
+}
+
+napi_value videoTryReceive(napi_env env, napi_callback_info info)
+{
+  return tryReceive(env, info, true, false, false);
+}
+
+napi_value audioTryReceive(napi_env env, napi_callback_info info)
+{
+  return tryReceive(env, info, false, true, false);
+}
+
+napi_value dataTryReceive(napi_env env, napi_callback_info info)
+{
+  return tryReceive(env, info, true, true, true);
+}
@@ -0,0 +1,27 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_POLL_H
+#define GRANDIOSE_POLL_H
+
+#include "node_api.h"
+
+// Captures with a zero timeout made directly on the JS thread, returning a
+// frame or undefined without queueing any async work
+napi_value videoTryReceive(napi_env env, napi_callback_info info);
+napi_value audioTryReceive(napi_env env, napi_callback_info info);
+napi_value dataTryReceive(napi_env env, napi_callback_info info);
+
+#endif /* GRANDIOSE_POLL_H */
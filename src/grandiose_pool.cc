@@ -0,0 +1,784 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "grandiose_pool.h"
+
+#define POOL_DEFAULT_THREADS 4
+#define POOL_MAX_THREADS 256
+#ifdef _WIN32
+#define AFFINITY_MAX_CORE 63 // Bits of a thread affinity mask
+#else
+#define AFFINITY_MAX_CORE 1023
+#endif
+#define REALTIME_DEFAULT_PRIORITY 10
+#define STACK_LOCK_SIZE (256 * 1024) // Below the frame where a media thread starts
+
+enum realtimePolicy
+{
+  realtime_none,
+  realtime_fifo,
+  realtime_rr
+};
+
+// Cores that grandiose's threads are restricted to, empty for no restriction.
+// The generation moves on with every change, for pool threads to pick up.
+static std::mutex settingsLock;
+static std::vector<uint32_t> affinityCores;
+static std::atomic<uint32_t> affinityGeneration{0};
+
+// Scheduling for media threads started from now on, and whether the last
+// configure() found that the process is allowed it
+static realtimePolicy realtime = realtime_none;
+static int32_t realtimePriority = REALTIME_DEFAULT_PRIORITY;
+static bool realtimeGranted = false;
+static std::atomic<bool> memoryLocked{false};
+
+#ifdef __linux__
+// What threads may run on when not restricted, as for the process at start
+static cpu_set_t processAffinity()
+{
+  static cpu_set_t initial;
+  static bool captured = false;
+  if (!captured)
+  {
+    CPU_ZERO(&initial);
+    if (sched_getaffinity(0, sizeof(initial), &initial) != 0)
+      for (int i = 0; i < CPU_SETSIZE; i++)
+        CPU_SET(i, &initial);
+    captured = true;
+  }
+  return initial;
+}
+#endif
+
+void applyThreadAffinity()
+{
+  std::vector<uint32_t> cores;
+  {
+    std::lock_guard<std::mutex> guard(settingsLock);
+#ifdef __linux__
+    processAffinity(); // Captured before any restriction
+#endif
+    cores = affinityCores;
+  }
+#if defined(_WIN32)
+  DWORD_PTR mask = 0;
+  for (uint32_t core : cores)
+    mask |= (DWORD_PTR)1 << core;
+  if (mask == 0)
+  {
+    DWORD_PTR system;
+    GetProcessAffinityMask(GetCurrentProcess(), &mask, &system);
+  }
+  SetThreadAffinityMask(GetCurrentThread(), mask);
+#elif defined(__linux__)
+  cpu_set_t set;
+  if (cores.empty())
+    set = processAffinity();
+  else
+  {
+    CPU_ZERO(&set);
+    for (uint32_t core : cores)
+      CPU_SET(core, &set);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+// Returns false where the process is not permitted real-time scheduling,
+// such as on Linux without CAP_SYS_NICE or a high enough RLIMIT_RTPRIO,
+// leaving the thread as it was
+static bool setRealtime(realtimePolicy policy, int32_t priority)
+{
+#ifdef _WIN32
+  // Windows has no policies or levels, just its highest thread priority
+  return SetThreadPriority(GetCurrentThread(), policy == realtime_none ?
+                           THREAD_PRIORITY_NORMAL : THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+  int native = SCHED_OTHER;
+  sched_param param;
+  param.sched_priority = 0;
+  if (policy != realtime_none)
+  {
+    native = policy == realtime_fifo ? SCHED_FIFO : SCHED_RR;
+    param.sched_priority = std::min(std::max(priority, (int32_t)sched_get_priority_min(native)),
+                                    (int32_t)sched_get_priority_max(native));
+  }
+  return pthread_setschedparam(pthread_self(), native, &param) == 0;
+#endif
+}
+
+static size_t pageSize()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Only the whole pages inside the range are locked, as pages shared with
+// neighbouring allocations would be unlocked along with them
+static bool pageRange(void *data, size_t size, char **start, size_t *length)
+{
+  uintptr_t page = pageSize();
+  uintptr_t first = ((uintptr_t)data + page - 1) & ~(page - 1);
+  uintptr_t last = ((uintptr_t)data + size) & ~(page - 1);
+  if (last <= first)
+    return false;
+  *start = (char *)first;
+  *length = last - first;
+  return true;
+}
+
+bool lockMemory(void *data, size_t size)
+{
+  char *start;
+  size_t length;
+  if (!memoryLocked.load(std::memory_order_relaxed) || !pageRange(data, size, &start, &length))
+    return false;
+#ifdef _WIN32
+  return VirtualLock(start, length) != 0;
+#else
+  return mlock(start, length) == 0; // Fails beyond RLIMIT_MEMLOCK
+#endif
+}
+
+void unlockMemory(void *data, size_t size)
+{
+  char *start;
+  size_t length;
+  if (!pageRange(data, size, &start, &length))
+    return;
+#ifdef _WIN32
+  VirtualUnlock(start, length);
+#else
+  munlock(start, length);
+#endif
+}
+
+void prepareMediaThread()
+{
+  applyThreadAffinity();
+
+  realtimePolicy policy;
+  int32_t priority;
+  {
+    std::lock_guard<std::mutex> guard(settingsLock);
+    policy = realtime;
+    priority = realtimePriority;
+  }
+  if (policy != realtime_none)
+    setRealtime(policy, priority); // Carries on at normal priority if refused
+
+  if (memoryLocked.load())
+  {
+    // The stack grows down from here, so lock what the SDK's calls and the
+    // thread's own frames will use, short of the guard page
+    char marker;
+    size_t page = pageSize();
+    uintptr_t top = ((uintptr_t)&marker + page) & ~(page - 1);
+    char *bottom = (char *)(top - STACK_LOCK_SIZE + page);
+#ifdef _WIN32
+    VirtualLock(bottom, STACK_LOCK_SIZE - page);
+#else
+    mlock(bottom, STACK_LOCK_SIZE - page);
+#endif
+  }
+}
+
+workerPool &workerPool::shared()
+{
+  // Never destroyed, as its threads may be waiting when the process exits
+  static workerPool *pool = new workerPool(POOL_DEFAULT_THREADS);
+  return *pool;
+}
+
+workerPool::workerPool(size_t count)
+{
+  resize(count);
+}
+
+void workerPool::resize(size_t count)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  target = count;
+  for (; live < target; live++)
+    std::thread(&workerPool::work, this).detach();
+  wake.notify_all();
+}
+
+size_t workerPool::size()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return target;
+}
+
+bool workerPool::claim(job *j, size_t *index)
+{
+  if (j->next >= j->count)
+    return false;
+  *index = j->next++;
+  if (j->next == j->count)
+    jobs.erase(std::find(jobs.begin(), jobs.end(), j));
+  return true;
+}
+
+void workerPool::complete(job *j)
+{
+  // The poster may return as soon as the last item is done, so the job is
+  // only touched under its lock
+  std::lock_guard<std::mutex> guard(j->lock);
+  if (++j->done == j->count)
+    j->finished.notify_all();
+}
+
+void workerPool::work()
+{
+  uint32_t generation = affinityGeneration.load() - 1;
+  std::unique_lock<std::mutex> guard(lock);
+  while (true)
+  {
+    wake.wait(guard, [this, generation] {
+      return !jobs.empty() || !tasks.empty() || live > target ||
+             generation != affinityGeneration.load();
+    });
+    // Surplus threads leave straight away, except that the last thread
+    // standing finishes what was queued before the pool emptied
+    if (live > target && (live > 1 || (jobs.empty() && tasks.empty())))
+    {
+      live--;
+      return;
+    }
+    if (generation != affinityGeneration.load())
+    {
+      generation = affinityGeneration.load();
+      guard.unlock();
+      applyThreadAffinity();
+      guard.lock();
+      continue;
+    }
+
+    // Items of fan out jobs are short, so go ahead of blocking tasks
+    if (!jobs.empty())
+    {
+      job *j = jobs.front();
+      size_t index;
+      if (!claim(j, &index))
+        continue;
+      guard.unlock();
+      (*j->fn)(index);
+      complete(j);
+    }
+    else
+    {
+      std::function<void()> task = std::move(tasks.front());
+      tasks.pop_front();
+      guard.unlock();
+      task();
+    }
+    guard.lock();
+  }
+}
+
+void workerPool::post(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    tasks.push_back(std::move(task));
+    // Posted as the pool was resized to nothing, so run it on a thread that
+    // leaves once the queue is empty
+    if (live == 0)
+    {
+      live++;
+      std::thread(&workerPool::work, this).detach();
+    }
+  }
+  wake.notify_one();
+}
+
+void workerPool::parallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+  if (count <= 1 || size() == 0)
+  {
+    for (size_t i = 0; i < count; i++)
+      fn(i);
+    return;
+  }
+
+  job j;
+  j.fn = &fn;
+  j.count = count;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    jobs.push_back(&j);
+  }
+  wake.notify_all();
+
+  // Take a share of the items rather than sitting idle
+  while (true)
+  {
+    size_t index;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (!claim(&j, &index))
+        break;
+    }
+    fn(index);
+    complete(&j);
+  }
+
+  std::unique_lock<std::mutex> guard(j.lock);
+  j.finished.wait(guard, [&j] { return j.done == j.count; });
+}
+
+// Hands completed work back to the JS thread of one env. The threadsafe
+// function is only referenced while work is pending, so that, as with
+// async work, it only keeps the event loop alive while there is work to do.
+struct workQueue
+{
+  napi_env env;
+  napi_threadsafe_function tsfn = nullptr;
+  uint32_t pending = 0; // Only accessed on the JS thread
+  std::mutex lock;
+  std::condition_variable idle;
+  uint32_t running = 0; // Posted to the pool and not yet handed back
+};
+
+struct pooledWork
+{
+  workQueue *queue;
+  napi_env env;
+  napi_async_execute_callback execute;
+  napi_async_complete_callback complete;
+  carrier *c;
+};
+
+static std::mutex queuesLock;
+static std::unordered_map<napi_env, workQueue *> queues;
+
+void workCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  pooledWork *w = (pooledWork *)data;
+  if (env == nullptr)
+  {
+    // Tearing down - the carrier's references go with the env
+    delete w;
+    return;
+  }
+  workQueue *q = w->queue;
+  if (--q->pending == 0)
+    napi_unref_threadsafe_function(env, q->tsfn);
+  w->complete(env, napi_ok, w->c);
+  delete w;
+}
+
+void finalizeWorkQueue(napi_env env, void *data, void *hint)
+{
+  delete (workQueue *)data;
+}
+
+// Wait for work still running for the env, so that no pool thread is left
+// holding its threadsafe function
+void haltWorkQueue(void *data)
+{
+  workQueue *q = (workQueue *)data;
+  {
+    std::unique_lock<std::mutex> guard(q->lock);
+    q->idle.wait(guard, [q] { return q->running == 0; });
+  }
+  {
+    std::lock_guard<std::mutex> guard(queuesLock);
+    queues.erase(q->env);
+  }
+  napi_release_threadsafe_function(q->tsfn, napi_tsfn_abort);
+}
+
+napi_status getWorkQueue(napi_env env, workQueue **result)
+{
+  {
+    std::lock_guard<std::mutex> guard(queuesLock);
+    auto found = queues.find(env);
+    if (found != queues.end())
+    {
+      *result = found->second;
+      return napi_ok;
+    }
+  }
+
+  napi_status status;
+  napi_value resourceName;
+  workQueue *q = new workQueue;
+  q->env = env;
+  status = napi_create_string_utf8(env, "GrandioseWork", NAPI_AUTO_LENGTH, &resourceName);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, nullptr, nullptr, resourceName, 0, 1,
+                                             q, finalizeWorkQueue, nullptr, workCallJs, &q->tsfn);
+  if (status != napi_ok)
+  {
+    delete q;
+    return status;
+  }
+  status = napi_unref_threadsafe_function(env, q->tsfn);
+  PASS_STATUS;
+  status = napi_add_env_cleanup_hook(env, haltWorkQueue, q);
+  PASS_STATUS;
+
+  std::lock_guard<std::mutex> guard(queuesLock);
+  queues[env] = q;
+  *result = q;
+  return napi_ok;
+}
+
+napi_status queueWork(napi_env env, const char *name, napi_async_execute_callback execute,
+                      napi_async_complete_callback complete, carrier *c)
+{
+  napi_status status;
+  if (workerPool::shared().size() == 0)
+  {
+    napi_value resourceName;
+    status = napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resourceName);
+    PASS_STATUS;
+    status = napi_create_async_work(env, NULL, resourceName, execute, complete, c, &c->_request);
+    PASS_STATUS;
+    return napi_queue_async_work(env, c->_request);
+  }
+
+  workQueue *q;
+  status = getWorkQueue(env, &q);
+  PASS_STATUS;
+  if (q->pending == 0)
+  {
+    status = napi_ref_threadsafe_function(env, q->tsfn);
+    PASS_STATUS;
+  }
+  q->pending++;
+  {
+    std::lock_guard<std::mutex> guard(q->lock);
+    q->running++;
+  }
+
+  pooledWork *w = new pooledWork{q, env, execute, complete, c};
+  workerPool::shared().post([w, q]() {
+    w->execute(w->env, w->c);
+    if (napi_call_threadsafe_function(q->tsfn, w, napi_tsfn_nonblocking) != napi_ok)
+      delete w;
+    std::lock_guard<std::mutex> guard(q->lock);
+    if (--q->running == 0)
+      q->idle.notify_all();
+  });
+  return napi_ok;
+}
+
+napi_status makeConfiguration(napi_env env, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  status = napi_create_uint32(env, (uint32_t)workerPool::shared().size(), &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "threads", param);
+  PASS_STATUS;
+
+  std::vector<uint32_t> cores;
+  realtimePolicy policy;
+  int32_t priority;
+  bool granted;
+  {
+    std::lock_guard<std::mutex> guard(settingsLock);
+    cores = affinityCores;
+    policy = realtime;
+    priority = realtimePriority;
+    granted = realtimeGranted;
+  }
+  napi_value affinity;
+  status = napi_create_array_with_length(env, cores.size(), &affinity);
+  PASS_STATUS;
+  for (size_t i = 0; i < cores.size(); i++)
+  {
+    status = napi_create_uint32(env, cores[i], &param);
+    PASS_STATUS;
+    status = napi_set_element(env, affinity, (uint32_t)i, param);
+    PASS_STATUS;
+  }
+  status = napi_set_named_property(env, *result, "affinity", affinity);
+  PASS_STATUS;
+
+  napi_value settings;
+  if (policy == realtime_none)
+  {
+    status = napi_get_null(env, &settings);
+    PASS_STATUS;
+  }
+  else
+  {
+    status = napi_create_object(env, &settings);
+    PASS_STATUS;
+    status = napi_create_string_utf8(env, policy == realtime_fifo ? "fifo" : "rr",
+                                     NAPI_AUTO_LENGTH, &param);
+    PASS_STATUS;
+    status = napi_set_named_property(env, settings, "policy", param);
+    PASS_STATUS;
+    status = napi_create_int32(env, priority, &param);
+    PASS_STATUS;
+    status = napi_set_named_property(env, settings, "priority", param);
+    PASS_STATUS;
+    status = napi_get_boolean(env, granted, &param);
+    PASS_STATUS;
+    status = napi_set_named_property(env, settings, "granted", param);
+    PASS_STATUS;
+  }
+  status = napi_set_named_property(env, *result, "realtime", settings);
+  PASS_STATUS;
+
+  status = napi_get_boolean(env, memoryLocked.load(), &param);
+  PASS_STATUS;
+  return napi_set_named_property(env, *result, "lockMemory", param);
+}
+
+// Read real-time scheduling options, or null for none. Throws and returns
+// false when an option is invalid.
+bool readRealtimeOptions(napi_env env, napi_value config, realtimePolicy *policy,
+                         int32_t *priority)
+{
+  napi_status status;
+  napi_valuetype type;
+  napi_value param;
+
+  status = napi_typeof(env, config, &type);
+  if (status == napi_ok && type == napi_null)
+  {
+    *policy = realtime_none;
+    return true;
+  }
+  bool isArray = false;
+  if (status == napi_ok && type == napi_object)
+    status = napi_is_array(env, config, &isArray);
+  if (status != napi_ok)
+    return checkStatus(env, status, __FILE__, __LINE__) == napi_ok;
+  if (type != napi_object || isArray)
+  {
+    napi_throw_error(env, nullptr, "Realtime must be an object, or null.");
+    return false;
+  }
+
+  *policy = realtime_fifo;
+  status = napi_get_named_property(env, config, "policy", &param);
+  if (status == napi_ok)
+    status = napi_typeof(env, param, &type);
+  if (status == napi_ok && type == napi_string)
+  {
+    char name[8];
+    size_t length;
+    status = napi_get_value_string_utf8(env, param, name, sizeof(name), &length);
+    if (status == napi_ok && strcmp(name, "rr") == 0)
+      *policy = realtime_rr;
+    else if (status == napi_ok && strcmp(name, "fifo") != 0)
+    {
+      napi_throw_error(env, nullptr, "Realtime policy must be 'fifo' or 'rr'.");
+      return false;
+    }
+  }
+  else if (status == napi_ok && type != napi_undefined)
+  {
+    napi_throw_error(env, nullptr, "Realtime policy must be 'fifo' or 'rr'.");
+    return false;
+  }
+
+  *priority = REALTIME_DEFAULT_PRIORITY;
+  if (status == napi_ok)
+    status = napi_get_named_property(env, config, "priority", &param);
+  if (status == napi_ok)
+    status = napi_typeof(env, param, &type);
+  if (status == napi_ok && type == napi_number)
+  {
+    status = napi_get_value_int32(env, param, priority);
+    if (status == napi_ok && (*priority < 1 || *priority > 99))
+    {
+      napi_throw_error(env, nullptr, "Realtime priority must be between 1 and 99.");
+      return false;
+    }
+  }
+  else if (status == napi_ok && type != napi_undefined)
+  {
+    napi_throw_error(env, nullptr, "Realtime priority must be a number if present.");
+    return false;
+  }
+
+  return checkStatus(env, status, __FILE__, __LINE__) == napi_ok;
+}
+
+// Set the size of the worker pool, the cores that grandiose's threads run
+// on and how media threads are scheduled, returning the configuration now in
+// force
+napi_value configure(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  status = napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+  CHECK_STATUS;
+
+  type = napi_undefined;
+  if (argc >= 1)
+  {
+    status = napi_typeof(env, args[0], &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Configuration must be an object.");
+  }
+
+  if (type == napi_object)
+  {
+    napi_value param;
+    bool setThreads = false;
+    uint32_t threads = 0;
+    status = napi_get_named_property(env, args[0], "threads", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      double value;
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Threads must be a number.");
+      status = napi_get_value_double(env, param, &value);
+      CHECK_STATUS;
+      if (!(value >= 0 && value <= POOL_MAX_THREADS) || value != (uint32_t)value)
+        NAPI_THROW_ERROR("Threads must be a whole number between 0 and 256.");
+      threads = (uint32_t)value;
+      setThreads = true;
+    }
+
+    bool setAffinity = false;
+    std::vector<uint32_t> cores;
+    status = napi_get_named_property(env, args[0], "affinity", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type == napi_null)
+      setAffinity = true;
+    else if (type != napi_undefined)
+    {
+      bool isArray = false;
+      if (type == napi_object)
+      {
+        status = napi_is_array(env, param, &isArray);
+        CHECK_STATUS;
+      }
+      if (!isArray)
+        NAPI_THROW_ERROR("Affinity must be an array of core numbers, or null.");
+      uint32_t length;
+      status = napi_get_array_length(env, param, &length);
+      CHECK_STATUS;
+      for (uint32_t i = 0; i < length; i++)
+      {
+        napi_value item;
+        double core;
+        status = napi_get_element(env, param, i, &item);
+        CHECK_STATUS;
+        status = napi_typeof(env, item, &type);
+        CHECK_STATUS;
+        if (type != napi_number)
+          NAPI_THROW_ERROR("Affinity must be an array of core numbers, or null.");
+        status = napi_get_value_double(env, item, &core);
+        CHECK_STATUS;
+        if (!(core >= 0 && core <= AFFINITY_MAX_CORE) || core != (uint32_t)core)
+          NAPI_THROW_ERROR("Affinity core numbers are out of range.");
+        cores.push_back((uint32_t)core);
+      }
+#if !defined(_WIN32) && !defined(__linux__)
+      if (!cores.empty())
+        NAPI_THROW_ERROR("Thread affinity is not supported on this platform.");
+#endif
+      setAffinity = true;
+    }
+
+    bool setLock = false, lock = false;
+    status = napi_get_named_property(env, args[0], "lockMemory", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_boolean)
+        NAPI_THROW_ERROR("Lock memory must be a boolean if present.");
+      status = napi_get_value_bool(env, param, &lock);
+      CHECK_STATUS;
+      setLock = true;
+    }
+
+    status = napi_get_named_property(env, args[0], "realtime", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      realtimePolicy policy;
+      int32_t priority = REALTIME_DEFAULT_PRIORITY;
+      if (!readRealtimeOptions(env, param, &policy, &priority))
+        return nullptr;
+      // Find out whether the process may use it on a thread of its own, so
+      // as not to change the scheduling of the JS thread
+      bool granted = false;
+      if (policy != realtime_none)
+        std::thread([&granted, policy, priority] {
+          granted = setRealtime(policy, priority);
+        }).join();
+      std::lock_guard<std::mutex> guard(settingsLock);
+      realtime = policy;
+      realtimePriority = priority;
+      realtimeGranted = granted;
+    }
+
+    if (setLock)
+      memoryLocked = lock;
+    if (setAffinity)
+    {
+      {
+        std::lock_guard<std::mutex> guard(settingsLock);
+        affinityCores = cores;
+      }
+      // Idle pool threads wake to apply it, busy ones once they finish
+      affinityGeneration.fetch_add(1);
+      workerPool::shared().resize(workerPool::shared().size());
+    }
+    if (setThreads)
+      workerPool::shared().resize(threads);
+  }
+
+  napi_value result;
+  status = makeConfiguration(env, &result);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,93 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_POOL_H
+#define GRANDIOSE_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+
+napi_value configure(napi_env env, napi_callback_info info);
+
+// Run the blocking part of a carrier's work off the JS thread, then complete
+// it on the JS thread, as napi_create_async_work and napi_queue_async_work
+// would. Work runs on grandiose's own pool, so long captures do not hold up
+// the libuv threadpool, unless the pool has been configured with no threads.
+napi_status queueWork(napi_env env, const char* name, napi_async_execute_callback execute,
+  napi_async_complete_callback complete, carrier* c);
+
+// Restrict the calling thread to the cores set by configure(), if any
+void applyThreadAffinity();
+// Set up a thread that captures or sends media as configured: restricted to
+// its cores, promoted to real-time scheduling where the process is allowed it,
+// and with its stack locked in memory
+void prepareMediaThread();
+// Lock a frame pool's block in memory when configured to, returning whether
+// it was, so that it is unlocked before being freed
+bool lockMemory(void* data, size_t size);
+void unlockMemory(void* data, size_t size);
+
+// Threads owned by grandiose. They run queued blocking work, and share out
+// jobs that fan out across many receivers, such as batched captures. A job's
+// items are claimed one at a time by the pool's threads and by the thread
+// that posted the job, so a job never waits for a thread to come free.
+class workerPool
+{
+public:
+  // The pool for the process, started on first use
+  static workerPool &shared();
+
+  // Call fn for each index below count, returning once every call is done
+  void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+  // Run task on one of the pool's threads
+  void post(std::function<void()> task);
+  // Threads are started at once, or stop once they finish their current work.
+  // Work already queued is still run when resizing to no threads.
+  void resize(size_t count);
+  size_t size();
+
+private:
+  struct job
+  {
+    const std::function<void(size_t)> *fn;
+    size_t count;
+    size_t next = 0; // Under the pool lock
+    size_t done = 0; // Under the job lock
+    std::mutex lock;
+    std::condition_variable finished;
+  };
+
+  explicit workerPool(size_t threads);
+  void work();
+  bool claim(job *j, size_t *index); // With the pool lock held
+  void complete(job *j);
+
+  std::mutex lock;
+  std::condition_variable wake;
+  std::deque<job *> jobs;
+  std::deque<std::function<void()>> tasks;
+  size_t target = 0; // Threads wanted
+  size_t live = 0; // Threads running
+};
+
+#endif /* GRANDIOSE_POOL_H */
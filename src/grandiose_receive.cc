@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <Processing.NDI.Lib.h>
 #include <inttypes.h>
+#include <cstring>
 
 #ifdef _WIN32
 #ifdef _WIN64
@@ -26,13 +27,118 @@
 #endif // _WIN64
 #endif // _WIN32
 
+#include "grandiose_audio.h"
+#include "grandiose_video.h"
 #include "grandiose_receive.h"
+#include "grandiose_frames.h"
+#include "grandiose_stream.h"
+#include "grandiose_framesync.h"
+#include "grandiose_poll.h"
+#include "grandiose_connect.h"
+#include "grandiose_record.h"
+#include "grandiose_share.h"
+#include "grandiose_subscribe.h"
+#include "grandiose_pool.h"
 #include "grandiose_util.h"
 
+void retainReceiver(receiverInstance *r)
+{
+  r->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void releaseReceiver(receiverInstance *r)
+{
+  if (r->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    printf("Releasing receiver.\n");
+    NDIlib_recv_destroy(r->recv);
+    delete r;
+  }
+}
+
 void finalizeReceive(napi_env env, void *data, void *hint)
 {
-  printf("Releasing receiver.\n");
-  NDIlib_recv_destroy((NDIlib_recv_instance_t)data);
+  releaseReceiver((receiverInstance *)data);
+}
+
+// Resolve the native receiver from the `embedded` property of a receiver
+// object, taking a reference that the caller must release.
+napi_status getReceiver(napi_env env, napi_value receiver, receiverInstance **result)
+{
+  napi_status status;
+  napi_value recvValue;
+  status = napi_get_named_property(env, receiver, "embedded", &recvValue);
+  PASS_STATUS;
+  void *recvData;
+  status = napi_get_value_external(env, recvValue, &recvData);
+  PASS_STATUS;
+  *result = (receiverInstance *)recvData;
+  retainReceiver(*result);
+  return napi_ok;
+}
+
+bool receiverBusy(receiverInstance *r, bool allowFanout)
+{
+  return r->stream != nullptr || r->record != nullptr || r->share != nullptr ||
+         (r->fanout != nullptr && !allowFanout) || r->synced;
+}
+
+// Parse an optional array of frame type names to capture, from 'video',
+// 'audio' and 'metadata'. Leaves the flags untouched when types is undefined.
+napi_status parseFrameTypes(napi_env env, napi_value types, bool *video, bool *audio, bool *metadata)
+{
+  napi_status status;
+  napi_valuetype type;
+  status = napi_typeof(env, types, &type);
+  PASS_STATUS;
+  if (type == napi_undefined)
+    return napi_ok;
+
+  bool isArray;
+  status = napi_is_array(env, types, &isArray);
+  PASS_STATUS;
+  if (!isArray)
+    return napi_array_expected;
+
+  uint32_t length;
+  status = napi_get_array_length(env, types, &length);
+  PASS_STATUS;
+  *video = *audio = *metadata = false;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    napi_value item;
+    status = napi_get_element(env, types, i, &item);
+    PASS_STATUS;
+    char name[10];
+    size_t namel;
+    status = napi_get_value_string_utf8(env, item, name, sizeof(name), &namel);
+    PASS_STATUS;
+    if (strcmp(name, "video") == 0)
+      *video = true;
+    else if (strcmp(name, "audio") == 0)
+      *audio = true;
+    else if (strcmp(name, "metadata") == 0)
+      *metadata = true;
+    else
+      return napi_invalid_arg;
+  }
+  return napi_ok;
+}
+
+// Video frame whose data has been handed to JS without copying. The frame is
+// returned to the SDK when the Buffer is garbage collected.
+struct videoFrameHold
+{
+  receiverInstance *instance;
+  NDIlib_video_frame_v2_t frame;
+};
+
+void finalizeVideoFrame(napi_env env, void *data, void *hint)
+{
+  videoFrameHold *hold = (videoFrameHold *)hint;
+  NDIlib_recv_free_video_v2(hold->instance->recv, &hold->frame);
+  releaseReceiver(hold->instance);
+  delete hold;
 }
 
 void receiveExecute(napi_env env, void *data)
@@ -73,8 +179,13 @@ void receiveComplete(napi_env env, napi_status asyncStatus, void *data)
   c->status = napi_create_object(env, &result);
   REJECT_STATUS;
 
+  receiverInstance *instance = new receiverInstance;
+  instance->recv = c->recv;
+  instance->zeroCopy = c->zeroCopy;
+  instance->outputFormat = c->outputFormat;
+
   napi_value embedded;
-  c->status = napi_create_external(env, c->recv, finalizeReceive, nullptr, &embedded);
+  c->status = napi_create_external(env, instance, finalizeReceive, nullptr, &embedded);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "embedded", embedded);
   REJECT_STATUS;
@@ -107,19 +218,120 @@ void receiveComplete(napi_env env, napi_status asyncStatus, void *data)
   c->status = napi_set_named_property(env, result, "data", dataFn);
   REJECT_STATUS;
 
-  napi_value source, name, uri;
-  c->status = napi_create_string_utf8(env, c->source->p_ndi_name, NAPI_AUTO_LENGTH, &name);
+  napi_value tryVideoFn;
+  c->status = napi_create_function(env, "tryVideo", NAPI_AUTO_LENGTH, videoTryReceive,
+                                   nullptr, &tryVideoFn);
   REJECT_STATUS;
-  if (c->source->p_url_address != NULL)
-  {
-    c->status = napi_create_string_utf8(env, c->source->p_url_address, NAPI_AUTO_LENGTH, &uri);
-    REJECT_STATUS;
-  }
-  c->status = napi_create_object(env, &source);
+  c->status = napi_set_named_property(env, result, "tryVideo", tryVideoFn);
+  REJECT_STATUS;
+
+  napi_value tryAudioFn;
+  c->status = napi_create_function(env, "tryAudio", NAPI_AUTO_LENGTH, audioTryReceive,
+                                   nullptr, &tryAudioFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "tryAudio", tryAudioFn);
+  REJECT_STATUS;
+
+  napi_value tryDataFn;
+  c->status = napi_create_function(env, "tryData", NAPI_AUTO_LENGTH, dataTryReceive,
+                                   nullptr, &tryDataFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "tryData", tryDataFn);
+  REJECT_STATUS;
+
+  napi_value framesFn;
+  c->status = napi_create_function(env, "frames", NAPI_AUTO_LENGTH, framesReceive,
+                                   nullptr, &framesFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "frames", framesFn);
+  REJECT_STATUS;
+
+  napi_value startStreamFn;
+  c->status = napi_create_function(env, "startStream", NAPI_AUTO_LENGTH, startStream,
+                                   nullptr, &startStreamFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "startStream", startStreamFn);
+  REJECT_STATUS;
+
+  napi_value frameSyncFn;
+  c->status = napi_create_function(env, "frameSync", NAPI_AUTO_LENGTH, frameSync,
+                                   nullptr, &frameSyncFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "frameSync", frameSyncFn);
+  REJECT_STATUS;
+
+  napi_value statsFn;
+  c->status = napi_create_function(env, "stats", NAPI_AUTO_LENGTH, receiverStats,
+                                   nullptr, &statsFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "stats", statsFn);
   REJECT_STATUS;
-  c->status = napi_set_named_property(env, source, "name", name);
+
+  napi_value latencyFn;
+  c->status = napi_create_function(env, "latency", NAPI_AUTO_LENGTH, receiverLatency,
+                                   nullptr, &latencyFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "latency", latencyFn);
+  REJECT_STATUS;
+
+  napi_value stopStreamFn;
+  c->status = napi_create_function(env, "stopStream", NAPI_AUTO_LENGTH, stopStream,
+                                   nullptr, &stopStreamFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "stopStream", stopStreamFn);
+  REJECT_STATUS;
+
+  napi_value recordFn;
+  c->status = napi_create_function(env, "record", NAPI_AUTO_LENGTH, startRecording,
+                                   nullptr, &recordFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "record", recordFn);
+  REJECT_STATUS;
+
+  napi_value stopRecordingFn;
+  c->status = napi_create_function(env, "stopRecording", NAPI_AUTO_LENGTH, stopRecording,
+                                   nullptr, &stopRecordingFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "stopRecording", stopRecordingFn);
+  REJECT_STATUS;
+
+  napi_value shareFn;
+  c->status = napi_create_function(env, "share", NAPI_AUTO_LENGTH, startSharing,
+                                   nullptr, &shareFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "share", shareFn);
+  REJECT_STATUS;
+
+  napi_value stopSharingFn;
+  c->status = napi_create_function(env, "stopSharing", NAPI_AUTO_LENGTH, stopSharing,
+                                   nullptr, &stopSharingFn);
   REJECT_STATUS;
-  c->status = napi_set_named_property(env, source, "urlAddress", uri);
+  c->status = napi_set_named_property(env, result, "stopSharing", stopSharingFn);
+  REJECT_STATUS;
+
+  napi_value subscribeFn;
+  c->status = napi_create_function(env, "subscribe", NAPI_AUTO_LENGTH, subscribe,
+                                   nullptr, &subscribeFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "subscribe", subscribeFn);
+  REJECT_STATUS;
+
+  napi_value connectFn;
+  c->status = napi_create_function(env, "connect", NAPI_AUTO_LENGTH, receiverConnect,
+                                   nullptr, &connectFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "connect", connectFn);
+  REJECT_STATUS;
+
+  napi_value disconnectFn;
+  c->status = napi_create_function(env, "disconnect", NAPI_AUTO_LENGTH, receiverDisconnect,
+                                   nullptr, &disconnectFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "disconnect", disconnectFn);
+  REJECT_STATUS;
+
+  napi_value source, name;
+  c->status = makeSourceObject(env, c->source, &source);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "source", source);
   REJECT_STATUS;
@@ -142,6 +354,18 @@ void receiveComplete(napi_env env, napi_status asyncStatus, void *data)
   c->status = napi_set_named_property(env, result, "allowVideoFields", allowVideoFields);
   REJECT_STATUS;
 
+  napi_value zeroCopy;
+  c->status = napi_get_boolean(env, c->zeroCopy, &zeroCopy);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "zeroCopy", zeroCopy);
+  REJECT_STATUS;
+
+  napi_value outputFormat;
+  c->status = napi_create_int32(env, (int32_t)c->outputFormat, &outputFormat);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "outputFormat", outputFormat);
+  REJECT_STATUS;
+
   if (c->name != nullptr)
   {
     c->status = napi_create_string_utf8(env, c->name, NAPI_AUTO_LENGTH, &name);
@@ -199,6 +423,53 @@ napi_status makeNativeSource(napi_env env, napi_value source, NDIlib_source_t *r
   return napi_ok;
 }
 
+// Check that a value is a source object with a string name and an optional
+// string urlAddress, setting errorMsg to why not when it is invalid
+napi_status checkSource(napi_env env, napi_value source, const char **errorMsg)
+{
+  napi_status status;
+  napi_valuetype type;
+  napi_value checkType;
+  *errorMsg = nullptr;
+
+  status = napi_get_named_property(env, source, "name", &checkType);
+  PASS_STATUS;
+  status = napi_typeof(env, checkType, &type);
+  PASS_STATUS;
+  if (type != napi_string)
+  {
+    *errorMsg = "Source property must have a 'name' sub-property that is of type string.";
+    return napi_ok;
+  }
+
+  status = napi_get_named_property(env, source, "urlAddress", &checkType);
+  PASS_STATUS;
+  status = napi_typeof(env, checkType, &type);
+  PASS_STATUS;
+  if (type != napi_undefined && type != napi_string)
+    *errorMsg = "Source 'urlAddress' sub-property must be of type string.";
+  return napi_ok;
+}
+
+// Make a source object for JS from a native source
+napi_status makeSourceObject(napi_env env, const NDIlib_source_t *source, napi_value *result)
+{
+  napi_status status;
+  napi_value name, uri;
+  status = napi_create_string_utf8(env, source->p_ndi_name, NAPI_AUTO_LENGTH, &name);
+  PASS_STATUS;
+  if (source->p_url_address != NULL)
+    status = napi_create_string_utf8(env, source->p_url_address, NAPI_AUTO_LENGTH, &uri);
+  else
+    status = napi_get_undefined(env, &uri);
+  PASS_STATUS;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "name", name);
+  PASS_STATUS;
+  return napi_set_named_property(env, *result, "urlAddress", uri);
+}
+
 /* makeNativeSource usage example
 NDIlib_source_t* fred = new NDIlib_source_t();
 c->status = makeNativeSource(env, item, fred);
@@ -237,7 +508,7 @@ napi_value receive(napi_env env, napi_callback_info info)
         GRANDIOSE_INVALID_ARGS);
 
   napi_value config = args[0];
-  napi_value source, colorFormat, bandwidth, allowVideoFields, name;
+  napi_value source, colorFormat, bandwidth, allowVideoFields, zeroCopy, outputFormat, name;
   // source is an object, not an array, with name and urlAddress
   // convert to a native source
   c->status = napi_get_named_property(env, config, "source", &source);
@@ -251,25 +522,11 @@ napi_value receive(napi_env env, napi_callback_info info)
         "Source property must be an object and not an array.",
         GRANDIOSE_INVALID_ARGS);
 
-  napi_value checkType;
-  c->status = napi_get_named_property(env, source, "name", &checkType);
-  REJECT_RETURN;
-  c->status = napi_typeof(env, checkType, &type);
-  REJECT_RETURN;
-  if (type != napi_string)
-    REJECT_ERROR_RETURN(
-        "Source property must have a 'name' sub-property that is of type string.",
-        GRANDIOSE_INVALID_ARGS);
-
-  c->status = napi_get_named_property(env, source, "urlAddress", &checkType);
-  REJECT_RETURN;
-  c->status = napi_typeof(env, checkType, &type);
+  const char *sourceError;
+  c->status = checkSource(env, source, &sourceError);
   REJECT_RETURN;
-
-  if (type != napi_undefined && type != napi_string)
-    REJECT_ERROR_RETURN(
-        "Source 'urlAddress' sub-property must be of type string.",
-        GRANDIOSE_INVALID_ARGS);
+  if (sourceError != nullptr)
+    REJECT_ERROR_RETURN(sourceError, GRANDIOSE_INVALID_ARGS);
 
   c->source = new NDIlib_source_t();
   c->status = makeNativeSource(env, source, c->source);
@@ -331,6 +588,41 @@ napi_value receive(napi_env env, napi_callback_info info)
     REJECT_RETURN;
   }
 
+  c->status = napi_get_named_property(env, config, "zeroCopy", &zeroCopy);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, zeroCopy, &type);
+  REJECT_RETURN;
+  if (type != napi_undefined)
+  {
+    if (type != napi_boolean)
+      REJECT_ERROR_RETURN(
+          "Zero copy property must be a Boolean.",
+          GRANDIOSE_INVALID_ARGS);
+    c->status = napi_get_value_bool(env, zeroCopy, &c->zeroCopy);
+    REJECT_RETURN;
+  }
+
+  c->status = napi_get_named_property(env, config, "outputFormat", &outputFormat);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, outputFormat, &type);
+  REJECT_RETURN;
+  if (type != napi_undefined)
+  {
+    if (type != napi_number)
+      REJECT_ERROR_RETURN(
+          "Output format property must be a number.",
+          GRANDIOSE_INVALID_ARGS);
+    int32_t enumValue;
+    c->status = napi_get_value_int32(env, outputFormat, &enumValue);
+    REJECT_RETURN;
+
+    c->outputFormat = (Grandiose_video_format_e)enumValue;
+    if (!validVideoFormat(c->outputFormat))
+      REJECT_ERROR_RETURN(
+          "Invalid output format value.",
+          GRANDIOSE_INVALID_ARGS);
+  }
+
   c->status = napi_get_named_property(env, config, "name", &name);
   REJECT_RETURN;
   c->status = napi_typeof(env, name, &type);
@@ -348,23 +640,41 @@ napi_value receive(napi_env env, napi_callback_info info)
     REJECT_RETURN;
   }
 
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, "Receive", NAPI_AUTO_LENGTH, &resource_name);
-  REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, receiveExecute,
-                                     receiveComplete, c, &c->_request);
-  REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  c->status = queueWork(env, "Receive", receiveExecute, receiveComplete, c);
   REJECT_RETURN;
 
   return promise;
 }
 
+NDIlib_frame_type_e captureFrame(receiverInstance *instance, NDIlib_video_frame_v2_t *video,
+                                 NDIlib_audio_frame_v2_t *audio, NDIlib_metadata_frame_t *metadata,
+                                 uint32_t wait)
+{
+  HR_TIME_POINT start = NOW;
+  NDIlib_frame_type_e type = NDIlib_recv_capture_v2(instance->recv, video, audio, metadata, wait);
+  switch (type)
+  {
+  case NDIlib_frame_type_video:
+  case NDIlib_frame_type_audio:
+  case NDIlib_frame_type_metadata:
+    instance->stats.capture.recordSince(start);
+    break;
+  case NDIlib_frame_type_none:
+    if (wait > 0) // Polls finding nothing waiting are not timeouts
+      instance->stats.timeouts.fetch_add(1, std::memory_order_relaxed);
+    break;
+  default:
+    break;
+  }
+  return type;
+}
+
 void videoReceiveExecute(napi_env env, void *data)
 {
   dataCarrier *c = (dataCarrier *)data;
+  c->instance->stats.queue.recordSince(c->created);
 
-  auto res = NDIlib_recv_capture_v2(c->recv, &c->videoFrame, nullptr, nullptr, c->wait);
+  auto res = captureFrame(c->instance, &c->videoFrame, nullptr, nullptr, c->wait);
   switch (res)
   {
   case NDIlib_frame_type_none:
@@ -377,6 +687,7 @@ void videoReceiveExecute(napi_env env, void *data)
   case NDIlib_frame_type_video:
     /* printf("Video data %i received (%dx%d at %d/%d).\n", &c->videoFrame, c->videoFrame.xres, c->videoFrame.yres,
       c->videoFrame.frame_rate_N, c->videoFrame.frame_rate_D); */
+    convertVideo(c->instance, &c->videoFrame, &c->videoData);
     break;
 
   case NDIlib_frame_type_error:
@@ -393,114 +704,234 @@ void videoReceiveExecute(napi_env env, void *data)
   }
 }
 
-void videoReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
+// PTP-style [seconds, nanoseconds] pair from a 100ns NDI time value
+napi_status makeTimeArray(napi_env env, int64_t time, napi_value *result)
 {
-  dataCarrier *c = (dataCarrier *)data;
-
-  if (asyncStatus != napi_ok)
-  {
-    c->status = asyncStatus;
-    c->errorMsg = "Async video frame receive failed to complete.";
-  }
-  REJECT_STATUS;
-
-  napi_value result;
-  c->status = napi_create_object(env, &result);
-  REJECT_STATUS;
-
-  int32_t ptps, ptpn;
-  ptps = (int32_t)(c->videoFrame.timestamp / 10000000);
-  ptpn = (c->videoFrame.timestamp % 10000000) * 100;
+  napi_status status;
+  napi_value params, paramn;
+  status = napi_create_int32(env, (int32_t)(time / 10000000), &params);
+  PASS_STATUS;
+  status = napi_create_int32(env, (int32_t)((time % 10000000) * 100), &paramn);
+  PASS_STATUS;
+  status = napi_create_array(env, result);
+  PASS_STATUS;
+  status = napi_set_element(env, *result, 0, params);
+  PASS_STATUS;
+  status = napi_set_element(env, *result, 1, paramn);
+  PASS_STATUS;
+  return napi_ok;
+}
 
+napi_status setNamedInt32(napi_env env, napi_value object, const char *name, int32_t value)
+{
+  napi_status status;
   napi_value param;
-  c->status = napi_create_string_utf8(env, "video", NAPI_AUTO_LENGTH, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "type", param);
-  REJECT_STATUS;
-
-  c->status = napi_create_int32(env, c->videoFrame.xres, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "xres", param);
-  REJECT_STATUS;
-
-  c->status = napi_create_int32(env, c->videoFrame.yres, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "yres", param);
-  REJECT_STATUS;
-
-  c->status = napi_create_int32(env, c->videoFrame.frame_rate_N, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "frameRateN", param);
-  REJECT_STATUS;
+  status = napi_create_int32(env, value, &param);
+  PASS_STATUS;
+  return napi_set_named_property(env, object, name, param);
+}
 
-  c->status = napi_create_int32(env, c->videoFrame.frame_rate_D, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "frameRateD", param);
-  REJECT_STATUS;
+void finalizeVideoBlock(napi_env env, void *data, void *hint)
+{
+  receiverInstance *instance = (receiverInstance *)hint;
+  instance->video.release((char *)data);
+  releaseReceiver(instance);
+}
 
-  c->status = napi_create_double(env, (double)c->videoFrame.picture_aspect_ratio, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "pictureAspectRatio", param);
-  REJECT_STATUS;
+// Convert a captured frame to the receiver's output format, returning the SDK
+// frame straight away. Frames in formats that cannot be converted are left
+// untouched, to be passed on as they are.
+void convertVideo(receiverInstance *instance, NDIlib_video_frame_v2_t *frame, videoOutput *output)
+{
+  if (instance->outputFormat == Grandiose_video_format_native)
+    return;
+  size_t size = videoOutputSize(frame, instance->outputFormat, &output->lineStride);
+  if (size == 0)
+    return;
 
-  napi_value params, paramn;
-  c->status = napi_create_int32(env, ptps, &params);
-  REJECT_STATUS;
-  c->status = napi_create_int32(env, ptpn, &paramn);
-  REJECT_STATUS;
-  c->status = napi_create_array(env, &param);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 0, params);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 1, paramn);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "timestamp", param);
-  REJECT_STATUS;
+  HR_TIME_POINT start = NOW;
+  output->data = instance->video.acquire(size);
+  output->size = size;
+  convertVideoFrame(frame, instance->outputFormat, (uint8_t *)output->data);
+  instance->stats.conversion.recordSince(start);
+  if (frame->p_metadata != nullptr)
+    output->metadata = strdup(frame->p_metadata);
+  NDIlib_recv_free_video_v2(instance->recv, frame);
+  frame->p_data = nullptr;
+  frame->p_metadata = output->metadata;
+}
 
-  c->status = napi_create_int32(env, c->videoFrame.FourCC, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "fourCC", param);
-  REJECT_STATUS;
+void releaseVideoOutput(receiverInstance *instance, videoOutput *output)
+{
+  if (output->data != nullptr)
+    instance->video.release(output->data);
+  free(output->metadata);
+  output->data = nullptr;
+  output->metadata = nullptr;
+}
 
-  c->status = napi_create_int32(env, c->videoFrame.frame_format_type, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "frameFormatType", param);
-  REJECT_STATUS;
+// Create the data buffer for a captured video frame. The frame is always
+// consumed - either freed back to the SDK or, in zero copy mode, owned by the
+// finalizer of the returned buffer. Converted frames hand their block from
+// the receiver's video pool to the buffer.
+napi_status makeVideoData(napi_env env, receiverInstance *instance, NDIlib_video_frame_v2_t *frame,
+                          videoOutput *output, napi_value *data, napi_value *metadata)
+{
+  napi_status status = napi_ok;
+  size_t dataLength = frame->line_stride_in_bytes * frame->yres;
 
-  c->status = napi_create_int32(env, (int32_t)c->videoFrame.timecode / 10000000, &params);
-  REJECT_STATUS;
-  c->status = napi_create_int32(env, (c->videoFrame.timecode % 10000000) * 100, &paramn);
-  REJECT_STATUS;
-  c->status = napi_create_array(env, &param);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 0, params);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 1, paramn);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "timecode", param);
-  REJECT_STATUS;
+  *metadata = nullptr;
+  if (frame->p_metadata != nullptr)
+    status = napi_create_string_utf8(env, frame->p_metadata, NAPI_AUTO_LENGTH, metadata);
 
-  c->status = napi_create_int32(env, c->videoFrame.line_stride_in_bytes, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "lineStrideBytes", param);
-  REJECT_STATUS;
+  if (output->data != nullptr)
+  {
+    if (status == napi_ok)
+    {
+      retainReceiver(instance);
+      if (napi_create_external_buffer(env, output->size, output->data,
+                                      finalizeVideoBlock, instance, data) == napi_ok)
+        output->data = nullptr;
+      else
+      {
+        releaseReceiver(instance);
+        instance->stats.addCopy(output->size);
+        status = napi_create_buffer_copy(env, output->size, output->data, nullptr, data);
+      }
+    }
+    releaseVideoOutput(instance, output);
+    return status;
+  }
 
-  if (c->videoFrame.p_metadata != nullptr)
+  if (status == napi_ok && instance->zeroCopy)
   {
-    c->status = napi_create_string_utf8(env, c->videoFrame.p_metadata, NAPI_AUTO_LENGTH, &param);
-    REJECT_STATUS;
-    c->status = napi_set_named_property(env, result, "metadata", param);
-    REJECT_STATUS;
+    videoFrameHold *hold = new videoFrameHold;
+    hold->instance = instance;
+    hold->frame = *frame;
+    retainReceiver(instance);
+    if (napi_create_external_buffer(env, dataLength, (void *)frame->p_data,
+                                    finalizeVideoFrame, hold, data) == napi_ok)
+      return napi_ok;
+    // Runtimes may refuse external buffers - fall back to copying
+    releaseReceiver(instance);
+    delete hold;
   }
 
-  c->status = napi_create_buffer_copy(env,
-                                      c->videoFrame.line_stride_in_bytes * c->videoFrame.yres,
-                                      (void *)c->videoFrame.p_data, nullptr, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "data", param);
-  REJECT_STATUS;
+  if (status == napi_ok)
+  {
+    instance->stats.addCopy(dataLength);
+    status = napi_create_buffer_copy(env, dataLength, (void *)frame->p_data, nullptr, data);
+  }
+  NDIlib_recv_free_video_v2(instance->recv, frame);
+  return status;
+}
 
-  NDIlib_recv_free_video_v2(c->recv, &c->videoFrame);
+napi_status buildVideoFrame(napi_env env, receiverInstance *instance,
+                            NDIlib_video_frame_v2_t *frame, videoOutput *output, napi_value *result)
+{
+  napi_status status;
+  napi_value data, metadata;
+
+  // Copy out the frame description before the data buffer takes the frame
+  NDIlib_video_frame_v2_t desc = *frame;
+  bool converted = output->data != nullptr && !output->copy;
+  int32_t lineStride = converted ? output->lineStride : desc.line_stride_in_bytes;
+  status = makeVideoData(env, instance, frame, output, &data, &metadata);
+  PASS_STATUS;
+
+  return makeVideoObject(env, instance, &desc, lineStride, converted, data, metadata, result);
+}
+
+napi_status makeVideoObject(napi_env env, receiverInstance *instance,
+                            const NDIlib_video_frame_v2_t *frame, int32_t lineStride, bool converted,
+                            napi_value data, napi_value metadata, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  const NDIlib_video_frame_v2_t &desc = *frame;
+
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+
+  status = napi_create_string_utf8(env, "video", NAPI_AUTO_LENGTH, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "type", param);
+  PASS_STATUS;
+
+  status = setNamedInt32(env, *result, "xres", desc.xres);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "yres", desc.yres);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "frameRateN", desc.frame_rate_N);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "frameRateD", desc.frame_rate_D);
+  PASS_STATUS;
+
+  status = napi_create_double(env, (double)desc.picture_aspect_ratio, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "pictureAspectRatio", param);
+  PASS_STATUS;
+
+  status = makeTimeArray(env, desc.timestamp, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "timestamp", param);
+  PASS_STATUS;
+
+  status = setNamedInt32(env, *result, "fourCC", desc.FourCC);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "frameFormatType", desc.frame_format_type);
+  PASS_STATUS;
+
+  status = makeTimeArray(env, desc.timecode, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "timecode", param);
+  PASS_STATUS;
+
+  status = setNamedInt32(env, *result, "lineStrideBytes", lineStride);
+  PASS_STATUS;
+
+  if (instance->outputFormat != Grandiose_video_format_native)
+  {
+    status = setNamedInt32(env, *result, "outputFormat",
+                           converted ? instance->outputFormat : Grandiose_video_format_native);
+    PASS_STATUS;
+  }
+
+  if (metadata != nullptr)
+  {
+    status = napi_set_named_property(env, *result, "metadata", metadata);
+    PASS_STATUS;
+  }
+
+  return napi_set_named_property(env, *result, "data", data);
+}
+
+// Time spent making frames for JS, and how long after being sent they got
+// here, is recorded for every capture path
+napi_status makeVideoFrame(napi_env env, receiverInstance *instance,
+                           NDIlib_video_frame_v2_t *frame, videoOutput *output, napi_value *result)
+{
+  HR_TIME_POINT start = NOW;
+  instance->stats.addDelivery(frame->timestamp);
+  napi_status status = buildVideoFrame(env, instance, frame, output, result);
+  instance->stats.complete.recordSince(start);
+  return status;
+}
+
+void videoReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
+{
+  dataCarrier *c = (dataCarrier *)data;
+
+  if (asyncStatus != napi_ok)
+  {
+    c->status = asyncStatus;
+    c->errorMsg = "Async video frame receive failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result;
+  c->status = makeVideoFrame(env, c->instance, &c->videoFrame, &c->videoData, &result);
+  REJECT_STATUS;
 
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
@@ -524,13 +955,9 @@ napi_value videoReceive(napi_env env, napi_callback_info info)
   c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
   REJECT_RETURN;
 
-  napi_value recvValue;
-  c->status = napi_get_named_property(env, thisValue, "embedded", &recvValue);
-  REJECT_RETURN;
-  void *recvData;
-  c->status = napi_get_value_external(env, recvValue, &recvData);
-  c->recv = (NDIlib_recv_instance_t)recvData;
+  c->status = getReceiver(env, thisValue, &c->instance);
   REJECT_RETURN;
+  c->recv = c->instance->recv;
 
   if (argc >= 1)
   {
@@ -543,13 +970,7 @@ napi_value videoReceive(napi_env env, napi_callback_info info)
     }
   }
 
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, "VideoReceive", NAPI_AUTO_LENGTH, &resource_name);
-  REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, videoReceiveExecute,
-                                     videoReceiveComplete, c, &c->_request);
-  REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  c->status = queueWork(env, "VideoReceive", videoReceiveExecute, videoReceiveComplete, c);
   REJECT_RETURN;
 
   return promise;
@@ -558,10 +979,11 @@ napi_value videoReceive(napi_env env, napi_callback_info info)
 void audioReceiveExecute(napi_env env, void *data)
 {
   dataCarrier *c = (dataCarrier *)data;
+  c->instance->stats.queue.recordSince(c->created);
 
   // printf("Audio receiver executing.\n");
 
-  switch (NDIlib_recv_capture_v2(c->recv, nullptr, &c->audioFrame, nullptr, c->wait))
+  switch (captureFrame(c->instance, nullptr, &c->audioFrame, nullptr, c->wait))
   {
   case NDIlib_frame_type_none:
     printf("No data received.\n");
@@ -571,21 +993,7 @@ void audioReceiveExecute(napi_env env, void *data)
 
   // Audio data
   case NDIlib_frame_type_audio:
-    switch (c->audioFormat)
-    {
-    case Grandiose_audio_format_int_16_interleaved:
-      c->audioFrame16s.reference_level = c->referenceLevel;
-      c->audioFrame16s.p_data = new short[c->audioFrame.no_samples * c->audioFrame.no_channels];
-      NDIlib_util_audio_to_interleaved_16s_v2(&c->audioFrame, &c->audioFrame16s);
-      break;
-    case Grandiose_audio_format_float_32_interleaved:
-      c->audioFrame32fIlvd.p_data = new float[c->audioFrame.no_samples * c->audioFrame.no_channels];
-      NDIlib_util_audio_to_interleaved_32f_v2(&c->audioFrame, &c->audioFrame32fIlvd);
-      break;
-    case Grandiose_audio_format_float_32_separate:
-    default:
-      break;
-    }
+    convertAudio(c->instance, &c->audioFrame, c->audioFormat, c->referenceLevel, &c->audioData);
     break;
 
   default:
@@ -596,126 +1004,258 @@ void audioReceiveExecute(napi_env env, void *data)
   }
 }
 
-void audioReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
+#define BLOCK_POOL_HEADER 16 // Block size and whether locked, keeping samples aligned
+#define BLOCK_POOL_MAX_FREE 4
+
+void freeBlock(char *block)
 {
-  dataCarrier *c = (dataCarrier *)data;
+  size_t *header = (size_t *)(block - BLOCK_POOL_HEADER);
+  if (header[1])
+    unlockMemory(block, header[0]);
+  delete[](block - BLOCK_POOL_HEADER);
+}
 
-  // printf("Audio receiver completing - status %i.\n", c->status);
+blockPool::~blockPool()
+{
+  for (char *block : free)
+    freeBlock(block);
+}
 
-  if (asyncStatus != napi_ok)
+char *blockPool::acquire(size_t size)
+{
   {
-    c->status = asyncStatus;
-    c->errorMsg = "Async audio frame receive failed to complete.";
+    std::lock_guard<std::mutex> guard(lock);
+    if (size > blockSize)
+    { // Everything on the free list is now too small
+      for (char *block : free)
+        freeBlock(block);
+      free.clear();
+      blockSize = size;
+    }
+    else if (!free.empty())
+    {
+      char *block = free.back();
+      free.pop_back();
+      return block;
+    }
+    size = blockSize;
   }
-  REJECT_STATUS;
+  char *raw = new char[size + BLOCK_POOL_HEADER];
+  ((size_t *)raw)[0] = size;
+  ((size_t *)raw)[1] = lockMemory(raw + BLOCK_POOL_HEADER, size);
+  return raw + BLOCK_POOL_HEADER;
+}
 
-  napi_value result;
-  c->status = napi_create_object(env, &result);
-  REJECT_STATUS;
+void blockPool::release(char *block)
+{
+  size_t size = *(size_t *)(block - BLOCK_POOL_HEADER);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (size >= blockSize && free.size() < BLOCK_POOL_MAX_FREE)
+    {
+      free.push_back(block);
+      return;
+    }
+  }
+  freeBlock(block);
+}
 
-  int32_t ptps, ptpn;
-  ptps = (int32_t)(c->audioFrame.timestamp / 10000000);
-  ptpn = (c->audioFrame.timestamp % 10000000) * 100;
+void finalizeAudioBlock(napi_env env, void *data, void *hint)
+{
+  receiverInstance *instance = (receiverInstance *)hint;
+  instance->audio.release((char *)data);
+  releaseReceiver(instance);
+}
 
-  napi_value param;
-  c->status = napi_create_string_utf8(env, "audio", NAPI_AUTO_LENGTH, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "type", param);
-  REJECT_STATUS;
+// Convert a planar float frame to the requested format, writing directly into
+// the caller's target when one big enough was supplied, or otherwise into a
+// block from the receiver's pool. Planar float with no target is left in the
+// SDK frame to be copied once when the frame is marshalled.
+void convertAudio(receiverInstance *instance, NDIlib_audio_frame_v2_t *frame,
+                  Grandiose_audio_format_e audioFormat, int32_t referenceLevel, audioOutput *output)
+{
+  int32_t factor = (audioFormat == Grandiose_audio_format_int_16_interleaved) ? 2 : 1;
+  output->size = (frame->channel_stride_in_bytes / factor) * frame->no_channels;
+  if (audioFormat == Grandiose_audio_format_float_32_separate && output->targetData == nullptr)
+    return;
 
-  c->status = napi_create_int32(env, c->audioFormat, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "audioFormat", param);
-  REJECT_STATUS;
+  HR_TIME_POINT start = NOW;
 
-  if (c->audioFormat == Grandiose_audio_format_int_16_interleaved)
+  if (output->targetData != nullptr && output->targetLength >= output->size)
+    output->data = output->targetData;
+  else
   {
-    c->status = napi_create_int32(env, c->referenceLevel, &param);
-    REJECT_STATUS;
-    c->status = napi_set_named_property(env, result, "referenceLevel", param);
-    REJECT_STATUS;
+    output->data = instance->audio.acquire(output->size);
+    output->pooled = true;
   }
 
-  c->status = napi_create_int32(env, c->audioFrame.sample_rate, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "sampleRate", param);
-  REJECT_STATUS;
+  switch (audioFormat)
+  {
+  case Grandiose_audio_format_int_16_interleaved:
+    audioToInterleaved16s(frame, referenceLevel, (int16_t *)output->data);
+    break;
+  case Grandiose_audio_format_float_32_interleaved:
+    audioToInterleaved32f(frame, (float *)output->data);
+    break;
+  case Grandiose_audio_format_float_32_separate:
+  default:
+    memcpy(output->data, frame->p_data, output->size);
+    instance->stats.addCopy(output->size);
+    return;
+  }
+  instance->stats.conversion.recordSince(start);
+}
 
-  c->status = napi_create_int32(env, c->audioFrame.no_channels, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "channels", param);
-  REJECT_STATUS;
+void releaseAudioOutput(receiverInstance *instance, audioOutput *output)
+{
+  if (output->pooled && output->data != nullptr)
+    instance->audio.release(output->data);
+  output->data = nullptr;
+  output->pooled = false;
+}
 
-  c->status = napi_create_int32(env, c->audioFrame.no_samples, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "samples", param);
-  REJECT_STATUS;
+// Create the data buffer for converted audio without copying the samples again
+napi_status makeAudioData(napi_env env, receiverInstance *instance, NDIlib_audio_frame_v2_t *frame,
+                          audioOutput *output, napi_value *data)
+{
+  napi_status status;
+  if (output->data == nullptr)
+  {
+    instance->stats.addCopy(output->size);
+    return napi_create_buffer_copy(env, output->size, (char *)frame->p_data, nullptr, data);
+  }
 
-  int32_t factor = (c->audioFormat == Grandiose_audio_format_int_16_interleaved) ? 2 : 1;
-  c->status = napi_create_int32(env, c->audioFrame.channel_stride_in_bytes / factor, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "channelStrideInBytes", param);
-  REJECT_STATUS;
+  if (output->pooled)
+  {
+    retainReceiver(instance);
+    status = napi_create_external_buffer(env, output->size, output->data,
+                                         finalizeAudioBlock, instance, data);
+    if (status == napi_ok)
+    { // Block is returned to the pool when the Buffer is collected
+      output->data = nullptr;
+      output->pooled = false;
+      return napi_ok;
+    }
+    // Runtimes may refuse external buffers - fall back to copying
+    releaseReceiver(instance);
+    instance->stats.addCopy(output->size);
+    return napi_create_buffer_copy(env, output->size, output->data, nullptr, data);
+  }
 
-  napi_value params, paramn;
-  c->status = napi_create_int32(env, ptps, &params);
-  REJECT_STATUS;
-  c->status = napi_create_int32(env, ptpn, &paramn);
-  REJECT_STATUS;
-  c->status = napi_create_array(env, &param);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 0, params);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 1, paramn);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "timestamp", param);
-  REJECT_STATUS;
+  // Converted in place into the caller's Buffer, so return a view of it
+  napi_value target, subarray, args[2];
+  status = napi_get_reference_value(env, output->target, &target);
+  PASS_STATUS;
+  status = napi_get_named_property(env, target, "subarray", &subarray);
+  PASS_STATUS;
+  status = napi_create_uint32(env, 0, &args[0]);
+  PASS_STATUS;
+  status = napi_create_uint32(env, (uint32_t)output->size, &args[1]);
+  PASS_STATUS;
+  return napi_call_function(env, target, subarray, 2, args, data);
+}
 
-  // printf("Timecode is %lld.\n", c->audioFrame.timecode);
-  c->status = napi_create_int32(env, (int32_t)(c->audioFrame.timecode / 10000000), &params);
-  REJECT_STATUS;
-  c->status = napi_create_int32(env, (c->audioFrame.timecode % 10000000) * 100, &paramn);
-  REJECT_STATUS;
-  c->status = napi_create_array(env, &param);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 0, params);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 1, paramn);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "timecode", param);
-  REJECT_STATUS;
+napi_status buildAudioFrame(napi_env env, receiverInstance *instance,
+                            NDIlib_audio_frame_v2_t *frame, Grandiose_audio_format_e audioFormat,
+                            int32_t referenceLevel, audioOutput *output, napi_value *result)
+{
+  napi_status status;
+  napi_value data, metadata = nullptr;
+
+  NDIlib_audio_frame_v2_t desc = *frame;
+  status = makeAudioData(env, instance, frame, output, &data);
+  if (status == napi_ok && frame->p_metadata != nullptr)
+    status = napi_create_string_utf8(env, frame->p_metadata, NAPI_AUTO_LENGTH, &metadata);
+  if (frame->p_data != nullptr) // Otherwise already returned by the caller
+    NDIlib_recv_free_audio_v2(instance->recv, frame);
+  PASS_STATUS;
 
-  if (c->audioFrame.p_metadata != nullptr)
+  return makeAudioObject(env, &desc, audioFormat, referenceLevel, data, metadata, result);
+}
+
+napi_status makeAudioObject(napi_env env, const NDIlib_audio_frame_v2_t *frame,
+                            Grandiose_audio_format_e audioFormat, int32_t referenceLevel,
+                            napi_value data, napi_value metadata, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  const NDIlib_audio_frame_v2_t &desc = *frame;
+  int32_t factor = (audioFormat == Grandiose_audio_format_int_16_interleaved) ? 2 : 1;
+
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+
+  status = napi_create_string_utf8(env, "audio", NAPI_AUTO_LENGTH, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "type", param);
+  PASS_STATUS;
+
+  status = setNamedInt32(env, *result, "audioFormat", audioFormat);
+  PASS_STATUS;
+
+  if (audioFormat == Grandiose_audio_format_int_16_interleaved)
   {
-    c->status = napi_create_string_utf8(env, c->audioFrame.p_metadata, NAPI_AUTO_LENGTH, &param);
-    REJECT_STATUS;
-    c->status = napi_set_named_property(env, result, "metadata", param);
-    REJECT_STATUS;
+    status = setNamedInt32(env, *result, "referenceLevel", referenceLevel);
+    PASS_STATUS;
   }
 
-  char *rawFloats;
-  switch (c->audioFormat)
+  status = setNamedInt32(env, *result, "sampleRate", desc.sample_rate);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "channels", desc.no_channels);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "samples", desc.no_samples);
+  PASS_STATUS;
+  status = setNamedInt32(env, *result, "channelStrideInBytes", desc.channel_stride_in_bytes / factor);
+  PASS_STATUS;
+
+  status = makeTimeArray(env, desc.timestamp, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "timestamp", param);
+  PASS_STATUS;
+
+  status = makeTimeArray(env, desc.timecode, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "timecode", param);
+  PASS_STATUS;
+
+  if (metadata != nullptr)
   {
-  case Grandiose_audio_format_int_16_interleaved:
-    rawFloats = (char *)c->audioFrame16s.p_data;
-    break;
-  case Grandiose_audio_format_float_32_interleaved:
-    rawFloats = (char *)c->audioFrame32fIlvd.p_data;
-    break;
-  default:
-  case Grandiose_audio_format_float_32_separate:
-    rawFloats = (char *)c->audioFrame.p_data;
-    break;
+    status = napi_set_named_property(env, *result, "metadata", metadata);
+    PASS_STATUS;
   }
-  c->status = napi_create_buffer_copy(env,
-                                      (c->audioFrame.channel_stride_in_bytes / factor) * c->audioFrame.no_channels,
-                                      rawFloats, nullptr, &param);
-  REJECT_STATUS;
 
-  c->status = napi_set_named_property(env, result, "data", param);
+  return napi_set_named_property(env, *result, "data", data);
+}
+
+napi_status makeAudioFrame(napi_env env, receiverInstance *instance,
+                           NDIlib_audio_frame_v2_t *frame, Grandiose_audio_format_e audioFormat,
+                           int32_t referenceLevel, audioOutput *output, napi_value *result)
+{
+  HR_TIME_POINT start = NOW;
+  instance->stats.addDelivery(frame->timestamp);
+  napi_status status = buildAudioFrame(env, instance, frame, audioFormat, referenceLevel,
+                                       output, result);
+  instance->stats.complete.recordSince(start);
+  return status;
+}
+
+void audioReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
+{
+  dataCarrier *c = (dataCarrier *)data;
+
+  // printf("Audio receiver completing - status %i.\n", c->status);
+
+  if (asyncStatus != napi_ok)
+  {
+    c->status = asyncStatus;
+    c->errorMsg = "Async audio frame receive failed to complete.";
+  }
   REJECT_STATUS;
 
-  NDIlib_recv_free_audio_v2(c->recv, &c->audioFrame);
+  napi_value result;
+  c->status = makeAudioFrame(env, c->instance, &c->audioFrame, c->audioFormat,
+                             c->referenceLevel, &c->audioData, &result);
+  REJECT_STATUS;
 
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
@@ -741,13 +1281,9 @@ napi_value dataAndAudioReceive(napi_env env, napi_callback_info info,
   c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
   REJECT_RETURN;
 
-  napi_value recvValue;
-  c->status = napi_get_named_property(env, thisValue, "embedded", &recvValue);
-  REJECT_RETURN;
-  void *recvData;
-  c->status = napi_get_value_external(env, recvValue, &recvData);
-  c->recv = (NDIlib_recv_instance_t)recvData;
+  c->status = getReceiver(env, thisValue, &c->instance);
   REJECT_RETURN;
+  c->recv = c->instance->recv;
 
   if (argc >= 1)
   {
@@ -799,6 +1335,32 @@ napi_value dataAndAudioReceive(napi_env env, napi_callback_info info,
         REJECT_ERROR_RETURN(
             "Audio reference level must be a number if present.",
             GRANDIOSE_INVALID_ARGS);
+
+      // Optional Buffer to convert samples straight into
+      c->status = napi_get_named_property(env, configValue, "buffer", &param);
+      REJECT_RETURN;
+      bool isBuffer;
+      c->status = napi_is_buffer(env, param, &isBuffer);
+      REJECT_RETURN;
+      if (isBuffer)
+      {
+        void *targetData;
+        c->status = napi_get_buffer_info(env, param, &targetData, &c->audioData.targetLength);
+        REJECT_RETURN;
+        c->audioData.targetData = (char *)targetData;
+        c->status = napi_create_reference(env, param, 1, &c->passthru);
+        REJECT_RETURN;
+        c->audioData.target = c->passthru;
+      }
+      else
+      {
+        c->status = napi_typeof(env, param, &type);
+        REJECT_RETURN;
+        if (type != napi_undefined)
+          REJECT_ERROR_RETURN(
+              "Audio buffer must be a Node Buffer if present.",
+              GRANDIOSE_INVALID_ARGS);
+      }
     }
     c->status = napi_typeof(env, waitValue, &type);
     REJECT_RETURN;
@@ -809,13 +1371,7 @@ napi_value dataAndAudioReceive(napi_env env, napi_callback_info info,
     }
   }
 
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, resourceName, NAPI_AUTO_LENGTH, &resource_name);
-  REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, execute,
-                                     complete, c, &c->_request);
-  REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  c->status = queueWork(env, resourceName, execute, complete, c);
   REJECT_RETURN;
 
   return promise;
@@ -830,10 +1386,11 @@ napi_value audioReceive(napi_env env, napi_callback_info info)
 void metadataReceiveExecute(napi_env env, void *data)
 {
   dataCarrier *c = (dataCarrier *)data;
+  c->instance->stats.queue.recordSince(c->created);
 
   // printf("Metadata receiver executing.\n");
 
-  switch (NDIlib_recv_capture_v2(c->recv, nullptr, nullptr, &c->metadataFrame, c->wait))
+  switch (captureFrame(c->instance, nullptr, nullptr, &c->metadataFrame, c->wait))
   {
   case NDIlib_frame_type_none:
     printf("No data received.\n");
@@ -853,6 +1410,55 @@ void metadataReceiveExecute(napi_env env, void *data)
   }
 }
 
+napi_status buildMetadataFrame(napi_env env, receiverInstance *instance,
+                               NDIlib_metadata_frame_t *frame, napi_value *result)
+{
+  napi_status status;
+  napi_value data;
+
+  NDIlib_metadata_frame_t desc = *frame;
+  status = napi_create_string_utf8(env, frame->p_data, NAPI_AUTO_LENGTH, &data);
+  NDIlib_recv_free_metadata(instance->recv, frame);
+  PASS_STATUS;
+
+  return makeMetadataObject(env, &desc, data, result);
+}
+
+napi_status makeMetadataObject(napi_env env, const NDIlib_metadata_frame_t *frame, napi_value data,
+                               napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  const NDIlib_metadata_frame_t &desc = *frame;
+
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+
+  status = napi_create_string_utf8(env, "metadata", NAPI_AUTO_LENGTH, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "type", param);
+  PASS_STATUS;
+
+  status = setNamedInt32(env, *result, "length", desc.length);
+  PASS_STATUS;
+
+  status = makeTimeArray(env, desc.timecode, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "timecode", param);
+  PASS_STATUS;
+
+  return napi_set_named_property(env, *result, "data", data);
+}
+
+napi_status makeMetadataFrame(napi_env env, receiverInstance *instance,
+                              NDIlib_metadata_frame_t *frame, napi_value *result)
+{
+  HR_TIME_POINT start = NOW;
+  napi_status status = buildMetadataFrame(env, instance, frame, result);
+  instance->stats.complete.recordSince(start);
+  return status;
+}
+
 void metadataReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
 {
   dataCarrier *c = (dataCarrier *)data;
@@ -866,41 +1472,9 @@ void metadataReceiveComplete(napi_env env, napi_status asyncStatus, void *data)
   REJECT_STATUS;
 
   napi_value result;
-  c->status = napi_create_object(env, &result);
-  REJECT_STATUS;
-
-  napi_value param;
-  c->status = napi_create_string_utf8(env, "metadata", NAPI_AUTO_LENGTH, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "type", param);
-  REJECT_STATUS;
-
-  c->status = napi_create_int32(env, c->metadataFrame.length, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "length", param);
-  REJECT_STATUS;
-
-  napi_value params, paramn;
-  c->status = napi_create_int32(env, (int32_t)(c->metadataFrame.timecode / 10000000), &params);
-  REJECT_STATUS;
-  c->status = napi_create_int32(env, (c->metadataFrame.timecode % 10000000) * 100, &paramn);
-  REJECT_STATUS;
-  c->status = napi_create_array(env, &param);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 0, params);
-  REJECT_STATUS;
-  c->status = napi_set_element(env, param, 1, paramn);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "timecode", param);
+  c->status = makeMetadataFrame(env, c->instance, &c->metadataFrame, &result);
   REJECT_STATUS;
 
-  c->status = napi_create_string_utf8(env, c->metadataFrame.p_data, NAPI_AUTO_LENGTH, &param);
-  REJECT_STATUS;
-  c->status = napi_set_named_property(env, result, "data", param);
-  REJECT_STATUS;
-
-  NDIlib_recv_free_metadata(c->recv, &c->metadataFrame);
-
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
   FLOATING_STATUS;
@@ -923,13 +1497,9 @@ napi_value metadataReceive(napi_env env, napi_callback_info info)
   c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
   REJECT_RETURN;
 
-  napi_value recvValue;
-  c->status = napi_get_named_property(env, thisValue, "embedded", &recvValue);
-  REJECT_RETURN;
-  void *recvData;
-  c->status = napi_get_value_external(env, recvValue, &recvData);
-  c->recv = (NDIlib_recv_instance_t)recvData;
+  c->status = getReceiver(env, thisValue, &c->instance);
   REJECT_RETURN;
+  c->recv = c->instance->recv;
 
   if (argc >= 1)
   {
@@ -942,13 +1512,8 @@ napi_value metadataReceive(napi_env env, napi_callback_info info)
     }
   }
 
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, "MetadataReceive", NAPI_AUTO_LENGTH, &resource_name);
-  REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, metadataReceiveExecute,
-                                     metadataReceiveComplete, c, &c->_request);
-  REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  c->status = queueWork(env, "MetadataReceive",
+                       metadataReceiveExecute, metadataReceiveComplete, c);
   REJECT_RETURN;
 
   return promise;
@@ -957,29 +1522,23 @@ napi_value metadataReceive(napi_env env, napi_callback_info info)
 void dataReceiveExecute(napi_env env, void *data)
 {
   dataCarrier *c = (dataCarrier *)data;
+  c->instance->stats.queue.recordSince(c->created);
 
   // printf("Audio receiver executing.\n");
-  c->frameType = NDIlib_recv_capture_v2(c->recv, &c->videoFrame, &c->audioFrame, &c->metadataFrame, c->wait);
+  c->frameType = captureFrame(c->instance,
+                              c->captureVideo ? &c->videoFrame : nullptr,
+                              c->captureAudio ? &c->audioFrame : nullptr,
+                              c->captureMetadata ? &c->metadataFrame : nullptr,
+                              c->wait);
   switch (c->frameType)
   {
+  case NDIlib_frame_type_video:
+    convertVideo(c->instance, &c->videoFrame, &c->videoData);
+    break;
 
   // Audio data
   case NDIlib_frame_type_audio:
-    switch (c->audioFormat)
-    {
-    case Grandiose_audio_format_int_16_interleaved:
-      c->audioFrame16s.reference_level = c->referenceLevel;
-      c->audioFrame16s.p_data = new short[c->audioFrame.no_samples * c->audioFrame.no_channels];
-      NDIlib_util_audio_to_interleaved_16s_v2(&c->audioFrame, &c->audioFrame16s);
-      break;
-    case Grandiose_audio_format_float_32_interleaved:
-      c->audioFrame32fIlvd.p_data = new float[c->audioFrame.no_samples * c->audioFrame.no_channels];
-      NDIlib_util_audio_to_interleaved_32f_v2(&c->audioFrame, &c->audioFrame32fIlvd);
-      break;
-    case Grandiose_audio_format_float_32_separate:
-    default:
-      break;
-    }
+    convertAudio(c->instance, &c->audioFrame, c->audioFormat, c->referenceLevel, &c->audioData);
     break;
 
   // Handle all other types on completion
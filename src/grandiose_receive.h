@@ -16,20 +16,134 @@
 #ifndef GRANDIOSE_RECEIVE_H
 #define GRANDIOSE_RECEIVE_H
 
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "node_api.h"
 #include "grandiose_util.h"
+#include "grandiose_stats.h"
 
 napi_value receive(napi_env env, napi_callback_info info);
 napi_value videoReceive(napi_env env, napi_callback_info info);
 napi_value audioReceive(napi_env env, napi_callback_info info);
 napi_value metadataReceive(napi_env env, napi_callback_info info);
 napi_value dataReceive(napi_env env, napi_callback_info info);
+void dataReceiveExecute(napi_env env, void* data);
+
+// Native state behind a receiver's `embedded` value. Reference counted so that
+// the NDI receiver is only destroyed once the JS receiver object and every
+// frame still pointing into SDK-owned memory have been released.
+struct streamState;
+struct recordState;
+struct shareState;
+struct fanoutState;
+
+// Blocks of memory for converted audio or video, recycled between the
+// captures of one receiver. Every block handed out is at least as large as the
+// largest frame seen so far, so steady streams stop allocating after the first
+// frame.
+class blockPool {
+public:
+  ~blockPool();
+  char* acquire(size_t size);
+  void release(char* block);
+
+private:
+  std::mutex lock;
+  std::vector<char*> free;
+  size_t blockSize = 0;
+};
+
+// Where the converted samples of an audio frame end up. The data is either a
+// block from the receiver's pool, memory inside a Buffer supplied by the
+// caller, or nullptr to copy planar samples straight from the SDK frame.
+struct audioOutput {
+  char* data = nullptr;
+  size_t size = 0;
+  bool pooled = false;
+  char* targetData = nullptr;
+  size_t targetLength = 0;
+  napi_ref target = nullptr; // Held by the owner of the output
+};
+
+// A video frame converted to the receiver's output format on the capture
+// thread. The SDK frame has already been freed, so its metadata is copied.
+struct videoOutput {
+  char* data = nullptr; // Block from the receiver's video pool
+  size_t size = 0;
+  int32_t lineStride = 0;
+  char* metadata = nullptr;
+  bool copy = false; // Holds the frame as delivered, rather than converted
+};
+
+struct receiverInstance {
+  NDIlib_recv_instance_t recv = nullptr;
+  bool zeroCopy = false;
+  Grandiose_video_format_e outputFormat = Grandiose_video_format_native;
+  blockPool audio;
+  blockPool video;
+  streamState* stream = nullptr; // Only accessed on the JS thread
+  recordState* record = nullptr; // As for stream
+  shareState* share = nullptr; // As for stream
+  fanoutState* fanout = nullptr; // Capture for subscribers, as for stream
+  bool synced = false; // Captured through a frame sync, on the JS thread
+  // Connection requests are numbered on the JS thread and applied in order,
+  // with any overtaken by a later request skipped
+  uint32_t connects = 0;
+  std::mutex connectLock;
+  uint32_t connected = 0; // Last request applied, under connectLock
+  captureStats stats;
+  std::atomic<int32_t> refs{1};
+};
+
+void retainReceiver(receiverInstance* r);
+void releaseReceiver(receiverInstance* r);
+napi_status getReceiver(napi_env env, napi_value receiver, receiverInstance** result);
+// Whether the receiver already has a native capture or frame sync of its own.
+// Subscribers share one capture, so subscribe allows it.
+bool receiverBusy(receiverInstance* r, bool allowFanout);
+#define GRANDIOSE_RECEIVER_BUSY \
+  "Receiver is already streaming, recording, sharing, subscribed or has a frame sync."
+napi_status checkSource(napi_env env, napi_value source, const char** errorMsg);
+napi_status makeNativeSource(napi_env env, napi_value source, NDIlib_source_t* result);
+napi_status makeSourceObject(napi_env env, const NDIlib_source_t* source, napi_value* result);
+napi_status parseFrameTypes(napi_env env, napi_value types, bool* video, bool* audio, bool* metadata);
+
+// NDIlib_recv_capture_v2, counted in the receiver's stats
+NDIlib_frame_type_e captureFrame(receiverInstance* instance, NDIlib_video_frame_v2_t* video,
+  NDIlib_audio_frame_v2_t* audio, NDIlib_metadata_frame_t* metadata, uint32_t wait);
+
+// Conversion of captured frames to JS values, shared by every capture path.
+// Each of these consumes the frame, returning it to the SDK as required.
+void convertAudio(receiverInstance* instance, NDIlib_audio_frame_v2_t* frame,
+  Grandiose_audio_format_e audioFormat, int32_t referenceLevel, audioOutput* output);
+void releaseAudioOutput(receiverInstance* instance, audioOutput* output);
+void convertVideo(receiverInstance* instance, NDIlib_video_frame_v2_t* frame, videoOutput* output);
+void releaseVideoOutput(receiverInstance* instance, videoOutput* output);
+napi_status makeVideoFrame(napi_env env, receiverInstance* instance,
+  NDIlib_video_frame_v2_t* frame, videoOutput* output, napi_value* result);
+napi_status makeAudioFrame(napi_env env, receiverInstance* instance,
+  NDIlib_audio_frame_v2_t* frame, Grandiose_audio_format_e audioFormat,
+  int32_t referenceLevel, audioOutput* output, napi_value* result);
+napi_status makeMetadataFrame(napi_env env, receiverInstance* instance,
+  NDIlib_metadata_frame_t* frame, napi_value* result);
+// Frame objects around data already made, for frames that are not consumed
+napi_status makeVideoObject(napi_env env, receiverInstance* instance,
+  const NDIlib_video_frame_v2_t* frame, int32_t lineStride, bool converted,
+  napi_value data, napi_value metadata, napi_value* result);
+napi_status makeAudioObject(napi_env env, const NDIlib_audio_frame_v2_t* frame,
+  Grandiose_audio_format_e audioFormat, int32_t referenceLevel,
+  napi_value data, napi_value metadata, napi_value* result);
+napi_status makeMetadataObject(napi_env env, const NDIlib_metadata_frame_t* frame, napi_value data,
+  napi_value* result);
 
 struct receiveCarrier : carrier {
   NDIlib_source_t* source = nullptr;
   NDIlib_recv_color_format_e colorFormat = NDIlib_recv_color_format_fastest;
   NDIlib_recv_bandwidth_e bandwidth = NDIlib_recv_bandwidth_highest;
   bool allowVideoFields = true;
+  bool zeroCopy = false;
+  Grandiose_video_format_e outputFormat = Grandiose_video_format_native;
   char* name = nullptr;
   NDIlib_recv_instance_t recv;
   ~receiveCarrier() {
@@ -42,18 +156,25 @@ struct receiveCarrier : carrier {
 
 struct dataCarrier : carrier {
   uint32_t wait = 10000;
+  receiverInstance* instance = nullptr;
   NDIlib_recv_instance_t recv;
   NDIlib_frame_type_e frameType;
+  bool captureVideo = true; // Frame types requested by a data capture
+  bool captureAudio = true;
+  bool captureMetadata = true;
   NDIlib_video_frame_v2_t videoFrame;
+  videoOutput videoData;
   NDIlib_audio_frame_v2_t audioFrame;
-  NDIlib_audio_frame_interleaved_16s_t audioFrame16s;
-  NDIlib_audio_frame_interleaved_32f_t audioFrame32fIlvd;
+  audioOutput audioData;
   int32_t referenceLevel = 20;
   Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
   NDIlib_metadata_frame_t metadataFrame;
   ~dataCarrier() {
-    delete[] audioFrame16s.p_data;
-    delete[] audioFrame32fIlvd.p_data;
+    if (instance != nullptr) {
+      releaseVideoOutput(instance, &videoData);
+      releaseAudioOutput(instance, &audioData);
+      releaseReceiver(instance);
+    }
   }
 };
 
@@ -0,0 +1,586 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_record.h"
+#include "grandiose_receive.h"
+#include "grandiose_send.h"
+#include "grandiose_pool.h"
+#include "grandiose_util.h"
+
+// Time to block in each capture, bounding how long stopping takes
+#define RECORD_CAPTURE_WAIT 100
+#define RECORD_WRITER_WAIT 100
+#define RECORD_PROGRESS_INTERVAL 1000
+#define RECORD_MAX_DEPTH 1024
+// Media files are written 4MiB at a time, indexes 64KiB at a time
+#define RECORD_BLOCK_SIZE (4 * 1024 * 1024)
+#define RECORD_INDEX_BLOCK_SIZE (64 * 1024)
+
+recordFile::~recordFile()
+{
+  close();
+  if (block != nullptr)
+    freeAligned(block);
+}
+
+bool recordFile::open(const std::string &name)
+{
+  if (block == nullptr)
+    block = allocAligned(blockSize);
+  if (block == nullptr)
+    return false;
+  file = fopen(name.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+  // Blocks are already as large as stdio would make them
+  setvbuf(file, nullptr, _IONBF, 0);
+  offset = 0;
+  used = 0;
+  return true;
+}
+
+bool recordFile::write(const void *data, size_t size)
+{
+  const char *from = (const char *)data;
+  offset += size;
+  while (size > 0)
+  {
+    size_t part = blockSize - used;
+    if (part > size)
+      part = size;
+    memcpy(block + used, from, part);
+    used += part;
+    from += part;
+    size -= part;
+    if (used == blockSize)
+    {
+      if (fwrite(block, 1, blockSize, file) != blockSize)
+        return false;
+      used = 0;
+    }
+  }
+  return true;
+}
+
+bool recordFile::close()
+{
+  if (file == nullptr)
+    return true;
+  bool written = (used == 0) || (fwrite(block, 1, used, file) == used);
+  used = 0;
+  bool closed = (fclose(file) == 0);
+  file = nullptr;
+  return written && closed;
+}
+
+recordState::recordState(uint32_t depth)
+    : ring(depth), video(RECORD_BLOCK_SIZE), audio(RECORD_BLOCK_SIZE), index(RECORD_INDEX_BLOCK_SIZE) {}
+
+// Bytes of a received video frame, with planes laid out as for conversion
+size_t receivedVideoSize(const NDIlib_video_frame_v2_t *frame)
+{
+  size_t plane = (size_t)frame->line_stride_in_bytes * frame->yres;
+  switch (frame->FourCC)
+  {
+  case NDIlib_FourCC_video_type_UYVA: // Alpha rows are xres bytes apart
+    return plane + (size_t)frame->xres * frame->yres;
+  case NDIlib_FourCC_video_type_P216:
+    return plane * 2;
+  case NDIlib_FourCC_video_type_PA16:
+    return plane * 3;
+  case NDIlib_FourCC_video_type_YV12:
+  case NDIlib_FourCC_video_type_I420:
+  case NDIlib_FourCC_video_type_NV12:
+    return plane * 3 / 2;
+  default:
+    return plane;
+  }
+}
+
+void queueRecordEvent(recordState *s, const char *type, const std::string &path)
+{
+  {
+    std::lock_guard<std::mutex> lock(s->eventsLock);
+    s->events.push_back({type, s->segment, path, s->videoFrames, s->audioFrames, s->bytes,
+                         s->dropped.load(std::memory_order_relaxed)});
+  }
+  if (!s->signalled.exchange(true))
+    napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+}
+
+void failRecording(recordState *s, const std::string &path)
+{
+  s->failed = true;
+  s->video.close();
+  s->audio.close();
+  s->index.close();
+  s->open = false;
+  queueRecordEvent(s, "error", path);
+}
+
+void closeSegment(recordState *s)
+{
+  if (!s->open)
+    return;
+  s->open = false;
+  bool closed = s->video.close();
+  closed = s->audio.close() && closed;
+  closed = s->index.close() && closed;
+  if (!closed)
+    failRecording(s, s->path);
+}
+
+// Start the next segment, so that the frame about to be written opens it
+void openSegment(recordState *s)
+{
+  if (s->open)
+  {
+    closeSegment(s);
+    s->segment++;
+  }
+  if (s->failed)
+    return;
+
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "-%05u", s->segment);
+  std::string name = s->path + suffix;
+  if (s->captureVideo && !s->video.open(name + ".video"))
+    return failRecording(s, name + ".video");
+  if (s->captureAudio && !s->audio.open(name + ".audio"))
+    return failRecording(s, name + ".audio");
+  if (!s->index.open(name + ".index"))
+    return failRecording(s, name + ".index");
+  s->open = true;
+  s->segmentTime = 0.0;
+  queueRecordEvent(s, "segment", name);
+}
+
+// Append a frame's data, and a line describing it to the index. Times are
+// given as [ seconds, nanoseconds ], as for frames received in JS.
+void writeRecordFrame(recordState *s, capturedFrame *frame)
+{
+  // Segments are cut on frames of the clock type, video where there is any,
+  // so that every frame lands in exactly one segment
+  bool clock = frame->type == (s->captureVideo ? NDIlib_frame_type_video : NDIlib_frame_type_audio);
+  if (!s->failed && (!s->open || (clock && s->segmentSeconds > 0.0 && s->segmentTime >= s->segmentSeconds)))
+    openSegment(s);
+  if (s->failed)
+    return;
+
+  char line[512];
+  int length;
+  if (frame->type == NDIlib_frame_type_video)
+  {
+    NDIlib_video_frame_v2_t *v = &frame->video;
+    size_t size = receivedVideoSize(v);
+    uint64_t offset = s->video.offset;
+    if (!s->video.write(v->p_data, size))
+      return failRecording(s, s->path);
+    length = snprintf(line, sizeof(line),
+                      "{\"type\":\"video\",\"offset\":%" PRIu64 ",\"size\":%zu,"
+                      "\"timestamp\":[%d,%d],\"timecode\":[%d,%d],\"xres\":%d,\"yres\":%d,"
+                      "\"fourCC\":%d,\"frameRateN\":%d,\"frameRateD\":%d,"
+                      "\"frameFormatType\":%d,\"lineStrideBytes\":%d}\n",
+                      offset, size,
+                      (int32_t)(v->timestamp / 10000000), (int32_t)((v->timestamp % 10000000) * 100),
+                      (int32_t)(v->timecode / 10000000), (int32_t)((v->timecode % 10000000) * 100),
+                      v->xres, v->yres, (int32_t)v->FourCC, v->frame_rate_N, v->frame_rate_D,
+                      (int32_t)v->frame_format_type, v->line_stride_in_bytes);
+    s->videoFrames++;
+    s->bytes += size;
+    if (v->frame_rate_N > 0)
+    {
+      double duration = (double)v->frame_rate_D / v->frame_rate_N;
+      bool field = v->frame_format_type == NDIlib_frame_format_type_field_0 ||
+                   v->frame_format_type == NDIlib_frame_format_type_field_1;
+      s->segmentTime += field ? duration / 2 : duration;
+    }
+  }
+  else
+  {
+    NDIlib_audio_frame_v2_t *a = &frame->audio;
+    size_t size = (size_t)a->channel_stride_in_bytes * a->no_channels;
+    uint64_t offset = s->audio.offset;
+    if (!s->audio.write(a->p_data, size))
+      return failRecording(s, s->path);
+    length = snprintf(line, sizeof(line),
+                      "{\"type\":\"audio\",\"offset\":%" PRIu64 ",\"size\":%zu,"
+                      "\"timestamp\":[%d,%d],\"timecode\":[%d,%d],\"sampleRate\":%d,"
+                      "\"channels\":%d,\"samples\":%d,\"channelStrideBytes\":%d}\n",
+                      offset, size,
+                      (int32_t)(a->timestamp / 10000000), (int32_t)((a->timestamp % 10000000) * 100),
+                      (int32_t)(a->timecode / 10000000), (int32_t)((a->timecode % 10000000) * 100),
+                      a->sample_rate, a->no_channels, a->no_samples, a->channel_stride_in_bytes);
+    s->audioFrames++;
+    s->bytes += size;
+    if (!s->captureVideo && a->sample_rate > 0)
+      s->segmentTime += (double)a->no_samples / a->sample_rate;
+  }
+
+  if (!s->index.write(line, (size_t)length))
+    failRecording(s, s->path);
+}
+
+void recordCapture(recordState *s)
+{
+  prepareMediaThread();
+  while (s->running.load(std::memory_order_relaxed))
+  {
+    capturedFrame frame;
+    frame.type = captureFrame(s->instance,
+                              s->captureVideo ? &frame.video : nullptr,
+                              s->captureAudio ? &frame.audio : nullptr,
+                              nullptr, RECORD_CAPTURE_WAIT);
+    if (frame.type != NDIlib_frame_type_video && frame.type != NDIlib_frame_type_audio)
+      continue;
+
+    // Frames are written as they came from NDI, so are queued unconverted.
+    // When the writer falls behind, new frames are dropped to keep the
+    // files in order.
+    capturedFrame evicted;
+    if (!s->ring.push(frame, Grandiose_drop_newest, &evicted))
+    {
+      releaseCapturedFrame(s->instance, &frame);
+      s->dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(s->wakeLock);
+    }
+    s->wake.notify_one();
+  }
+}
+
+void recordWrite(recordState *s)
+{
+  applyThreadAffinity();
+  HR_TIME_POINT lastProgress = NOW;
+  capturedFrame frame;
+  while (true)
+  {
+    std::unique_lock<std::mutex> lock(s->wakeLock);
+    if (s->ring.pop(&frame))
+    {
+      lock.unlock();
+      writeRecordFrame(s, &frame);
+      releaseCapturedFrame(s->instance, &frame);
+    }
+    else if (!s->writing.load())
+      break;
+    else
+    {
+      s->wake.wait_for(lock, std::chrono::milliseconds(RECORD_WRITER_WAIT));
+      lock.unlock();
+    }
+
+    if (NOW - lastProgress >= std::chrono::milliseconds(RECORD_PROGRESS_INTERVAL))
+    {
+      lastProgress = NOW;
+      if (s->open)
+        queueRecordEvent(s, "progress", std::string());
+    }
+  }
+  closeSegment(s);
+  queueRecordEvent(s, "end", std::string());
+}
+
+napi_status makeRecordEvent(napi_env env, const recordEvent &event, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  status = napi_create_string_utf8(env, event.type, NAPI_AUTO_LENGTH, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "type", param);
+  PASS_STATUS;
+  status = napi_create_uint32(env, event.segment, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "segment", param);
+  PASS_STATUS;
+  if (!event.path.empty())
+  {
+    status = napi_create_string_utf8(env, event.path.c_str(), NAPI_AUTO_LENGTH, &param);
+    PASS_STATUS;
+    status = napi_set_named_property(env, *result, "path", param);
+    PASS_STATUS;
+  }
+
+  const char *names[4] = {"videoFrames", "audioFrames", "bytes", "dropped"};
+  uint64_t values[4] = {event.videoFrames, event.audioFrames, event.bytes, event.dropped};
+  for (int x = 0; x < 4; x++)
+  {
+    status = napi_create_double(env, (double)values[x], &param);
+    PASS_STATUS;
+    status = napi_set_named_property(env, *result, names[x], param);
+    PASS_STATUS;
+  }
+  return napi_ok;
+}
+
+void recordCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  recordState *s = (recordState *)context;
+  if (env == nullptr)
+    return;
+
+  napi_status status;
+  napi_value undefined;
+  status = napi_get_undefined(env, &undefined);
+  FLOATING_STATUS;
+
+  s->signalled.store(false);
+  std::vector<recordEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(s->eventsLock);
+    events.swap(s->events);
+  }
+
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+    FLOATING_STATUS;
+
+    napi_value argv[2] = {undefined, undefined};
+    if (strcmp(events[i].type, "error") == 0)
+    {
+      std::string message = "Failed to write recording to " + events[i].path + ".";
+      status = makeError(env, GRANDIOSE_RECORD_FAIL, message.c_str(), &argv[0]);
+    }
+    if (status == napi_ok)
+      status = makeRecordEvent(env, events[i], &argv[1]);
+    if (status == napi_ok)
+      status = napi_call_function(env, undefined, callback, 2, argv, nullptr);
+    napi_close_handle_scope(env, scope);
+
+    if (status != napi_ok)
+    {
+      // Most likely the callback threw - deliver the rest on the next turn
+      std::lock_guard<std::mutex> lock(s->eventsLock);
+      s->events.insert(s->events.begin(), events.begin() + i + 1, events.end());
+      if (!s->signalled.exchange(true))
+        napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+      return;
+    }
+  }
+}
+
+void finalizeRecord(napi_env env, void *data, void *hint)
+{
+  recordState *s = (recordState *)data;
+  releaseReceiver(s->instance);
+  delete s;
+}
+
+// Stop capturing, then let the writer drain the queue and close the last
+// segment. Events already queued, ending with "end", are still delivered.
+void haltRecord(void *data)
+{
+  recordState *s = (recordState *)data;
+  s->instance->record = nullptr;
+  s->running.store(false);
+  if (s->capture.joinable())
+    s->capture.join();
+  {
+    std::lock_guard<std::mutex> lock(s->wakeLock);
+    s->writing.store(false);
+  }
+  s->wake.notify_one();
+  if (s->writer.joinable())
+    s->writer.join();
+  napi_release_threadsafe_function(s->tsfn, napi_tsfn_release);
+}
+
+void stopReceiverRecording(napi_env env, receiverInstance *instance)
+{
+  recordState *s = instance->record;
+  if (s == nullptr)
+    return;
+  napi_status status;
+  status = napi_remove_env_cleanup_hook(env, haltRecord, s);
+  FLOATING_STATUS;
+  haltRecord(s);
+}
+
+napi_value startRecording(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 2;
+  napi_value args[2];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 2)
+    NAPI_THROW_ERROR("Recording requires an options object and a callback function.");
+  napi_value options = args[0];
+  napi_value callback = args[1];
+  status = napi_typeof(env, callback, &type);
+  CHECK_STATUS;
+  if (type != napi_function)
+    NAPI_THROW_ERROR("Last argument to record must be a callback function.");
+  status = napi_typeof(env, options, &type);
+  CHECK_STATUS;
+  if (type != napi_object)
+    NAPI_THROW_ERROR("Recording options must be an object.");
+
+  napi_value param;
+  status = napi_get_named_property(env, options, "path", &param);
+  CHECK_STATUS;
+  status = napi_typeof(env, param, &type);
+  CHECK_STATUS;
+  if (type != napi_string)
+    NAPI_THROW_ERROR("Recording path must be a string.");
+  size_t pathl;
+  status = napi_get_value_string_utf8(env, param, nullptr, 0, &pathl);
+  CHECK_STATUS;
+  std::string path(pathl, '\0');
+  status = napi_get_value_string_utf8(env, param, &path[0], pathl + 1, &pathl);
+  CHECK_STATUS;
+  if (pathl == 0)
+    NAPI_THROW_ERROR("Recording path must not be empty.");
+
+  // Raw media with an index is the only container written natively
+  status = napi_get_named_property(env, options, "container", &param);
+  CHECK_STATUS;
+  status = napi_typeof(env, param, &type);
+  CHECK_STATUS;
+  if (type != napi_undefined)
+  {
+    char container[8];
+    size_t containerl = 0;
+    if (type == napi_string)
+    {
+      status = napi_get_value_string_utf8(env, param, container, sizeof(container), &containerl);
+      CHECK_STATUS;
+    }
+    if (type != napi_string || strcmp(container, "raw") != 0)
+      NAPI_THROW_ERROR("Recording container must be 'raw'.");
+  }
+
+  double segmentSeconds = 0.0;
+  status = napi_get_named_property(env, options, "segmentSeconds", &param);
+  CHECK_STATUS;
+  status = napi_typeof(env, param, &type);
+  CHECK_STATUS;
+  if (type != napi_undefined)
+  {
+    if (type != napi_number)
+      NAPI_THROW_ERROR("Segment seconds must be a number.");
+    status = napi_get_value_double(env, param, &segmentSeconds);
+    CHECK_STATUS;
+    if (!(segmentSeconds >= 0.0))
+      NAPI_THROW_ERROR("Segment seconds must not be negative.");
+  }
+
+  uint32_t depth = 16;
+  status = napi_get_named_property(env, options, "depth", &param);
+  CHECK_STATUS;
+  status = napi_typeof(env, param, &type);
+  CHECK_STATUS;
+  if (type != napi_undefined)
+  {
+    if (type != napi_number)
+      NAPI_THROW_ERROR("Recording depth must be a number.");
+    status = napi_get_value_uint32(env, param, &depth);
+    CHECK_STATUS;
+    if (depth < 1 || depth > RECORD_MAX_DEPTH)
+      NAPI_THROW_ERROR("Recording depth must be between 1 and 1024.");
+  }
+
+  bool captureVideo = true, captureAudio = true, captureMetadata = false;
+  status = napi_get_named_property(env, options, "types", &param);
+  CHECK_STATUS;
+  if (parseFrameTypes(env, param, &captureVideo, &captureAudio, &captureMetadata) != napi_ok)
+    NAPI_THROW_ERROR("Recording types must be an array containing 'video' or 'audio'.");
+  if (!captureVideo && !captureAudio)
+    NAPI_THROW_ERROR("Recording types must include 'video' or 'audio'.");
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  if (receiverBusy(instance, false))
+  {
+    releaseReceiver(instance);
+    NAPI_THROW_ERROR(GRANDIOSE_RECEIVER_BUSY);
+  }
+
+  // The recording owns the reference to the receiver taken by getReceiver
+  recordState *s = new recordState(depth);
+  s->instance = instance;
+  s->path = path;
+  s->segmentSeconds = segmentSeconds;
+  s->captureVideo = captureVideo;
+  s->captureAudio = captureAudio;
+
+  napi_value resourceName;
+  status = napi_create_string_utf8(env, "ReceiveRecord", NAPI_AUTO_LENGTH, &resourceName);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, callback, nullptr, resourceName, 0, 1,
+                                             s, finalizeRecord, s, recordCallJs, &s->tsfn);
+  if (status != napi_ok)
+  {
+    releaseReceiver(instance);
+    delete s;
+  }
+  CHECK_STATUS;
+
+  instance->record = s;
+  s->writer = std::thread(recordWrite, s);
+  s->capture = std::thread(recordCapture, s);
+  status = napi_add_env_cleanup_hook(env, haltRecord, s);
+  CHECK_STATUS;
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
+
+napi_value stopRecording(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  stopReceiverRecording(env, instance);
+  releaseReceiver(instance);
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
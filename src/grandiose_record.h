@@ -0,0 +1,103 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_RECORD_H
+#define GRANDIOSE_RECORD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+#include "grandiose_stream.h"
+
+napi_value startRecording(napi_env env, napi_callback_info info);
+napi_value stopRecording(napi_env env, napi_callback_info info);
+
+// Bytes of picture data in a frame as received, across all of its planes
+size_t receivedVideoSize(const NDIlib_video_frame_v2_t* frame);
+
+// A file written in whole blocks of a fixed size, so that the disk sees a
+// few large writes rather than one per frame. Offsets count every byte
+// written, including those still in the block.
+class recordFile {
+public:
+  explicit recordFile(size_t blockSize) : blockSize(blockSize) {}
+  ~recordFile();
+  bool open(const std::string& name);
+  bool write(const void* data, size_t size);
+  bool close(); // Writes out any partly filled block
+  uint64_t offset = 0;
+
+private:
+  size_t blockSize;
+  char* block = nullptr;
+  size_t used = 0;
+  FILE* file = nullptr;
+};
+
+// Something for JS to hear about, queued by the writer thread
+struct recordEvent {
+  const char* type; // "segment", "progress", "end" or "error"
+  uint32_t segment;
+  std::string path; // Of the segment, or what failed for an error
+  uint64_t videoFrames;
+  uint64_t audioFrames;
+  uint64_t bytes;
+  uint64_t dropped;
+};
+
+// A capture thread takes frames from the receiver and queues them, as they
+// come from NDI, for a writer thread. Only the writer touches the files.
+struct recordState {
+  receiverInstance* instance = nullptr;
+  napi_threadsafe_function tsfn = nullptr;
+  std::thread capture;
+  std::thread writer;
+  frameRing ring;
+  std::string path; // Prefix of the files of each segment
+  double segmentSeconds = 0.0; // Zero to write a single segment
+  bool captureVideo = true;
+  bool captureAudio = true;
+  std::atomic<bool> running{true}; // Capturing
+  std::atomic<bool> writing{true}; // Cleared once capture has stopped
+  std::atomic<bool> signalled{false};
+  std::atomic<uint64_t> dropped{0};
+  std::mutex wakeLock;
+  std::condition_variable wake;
+  std::mutex eventsLock;
+  std::vector<recordEvent> events;
+  // Only accessed by the writer thread
+  recordFile video;
+  recordFile audio;
+  recordFile index;
+  uint32_t segment = 0;
+  double segmentTime = 0.0; // Seconds of media in the current segment
+  bool open = false;
+  bool failed = false;
+  uint64_t videoFrames = 0;
+  uint64_t audioFrames = 0;
+  uint64_t bytes = 0;
+  explicit recordState(uint32_t depth);
+};
+
+void stopReceiverRecording(napi_env env, receiverInstance* instance);
+
+#endif /* GRANDIOSE_RECORD_H */
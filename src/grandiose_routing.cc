@@ -0,0 +1,284 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_routing.h"
+#include "grandiose_pool.h"
+#include "grandiose_receive.h"
+#include "grandiose_util.h"
+
+napi_value routingChange(napi_env env, napi_callback_info info);
+napi_value routingClear(napi_env env, napi_callback_info info);
+napi_value routingConnections(napi_env env, napi_callback_info info);
+
+void routingExecute(napi_env env, void* data) {
+  routingCarrier* c = (routingCarrier*) data;
+
+  NDIlib_routing_create_t createDesc;
+  createDesc.p_ndi_name = c->name;
+  createDesc.p_groups = c->groups;
+  c->routing = NDIlib_routing_create(&createDesc);
+  if (!c->routing) {
+    c->status = GRANDIOSE_ROUTING_CREATE_FAIL;
+    c->errorMsg = "Failed to create NDI routing source.";
+  }
+}
+
+void finalizeRouting(napi_env env, void* data, void* hint) {
+  NDIlib_routing_destroy((NDIlib_routing_instance_t) data);
+}
+
+napi_status getRouting(napi_env env, napi_value routing, NDIlib_routing_instance_t* result) {
+  napi_status status;
+  napi_value routingValue;
+  status = napi_get_named_property(env, routing, "embedded", &routingValue);
+  PASS_STATUS;
+  void* routingData;
+  status = napi_get_value_external(env, routingValue, &routingData);
+  PASS_STATUS;
+  *result = (NDIlib_routing_instance_t) routingData;
+  return napi_ok;
+}
+
+void routingComplete(napi_env env, napi_status asyncStatus, void* data) {
+  routingCarrier* c = (routingCarrier*) data;
+
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async routing source creation failed to complete.";
+  }
+  REJECT_STATUS;
+
+  napi_value result;
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+
+  napi_value embedded;
+  c->status = napi_create_external(env, c->routing, finalizeRouting, nullptr, &embedded);
+  if (c->status != napi_ok) NDIlib_routing_destroy(c->routing);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "embedded", embedded);
+  REJECT_STATUS;
+
+  napi_value changeFn;
+  c->status = napi_create_function(env, "change", NAPI_AUTO_LENGTH, routingChange,
+    nullptr, &changeFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "change", changeFn);
+  REJECT_STATUS;
+
+  napi_value clearFn;
+  c->status = napi_create_function(env, "clear", NAPI_AUTO_LENGTH, routingClear,
+    nullptr, &clearFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "clear", clearFn);
+  REJECT_STATUS;
+
+  napi_value connectionsFn;
+  c->status = napi_create_function(env, "connections", NAPI_AUTO_LENGTH, routingConnections,
+    nullptr, &connectionsFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "connections", connectionsFn);
+  REJECT_STATUS;
+
+  napi_value name, groups;
+  c->status = napi_create_string_utf8(env, c->name, NAPI_AUTO_LENGTH, &name);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "name", name);
+  REJECT_STATUS;
+
+  if (c->groups != nullptr) {
+    c->status = napi_create_string_utf8(env, c->groups, NAPI_AUTO_LENGTH, &groups);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, result, "groups", groups);
+    REJECT_STATUS;
+  }
+
+  napi_status status;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value routing(napi_env env, napi_callback_info info) {
+  napi_valuetype type;
+  routingCarrier* c = new routingCarrier;
+
+  napi_value promise;
+  c->status = napi_create_promise(env, &c->_deferred, &promise);
+  REJECT_RETURN;
+
+  size_t argc = 1;
+  napi_value args[1];
+  c->status = napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+  REJECT_RETURN;
+
+  if (argc != (size_t) 1) REJECT_ERROR_RETURN(
+    "Routing source must be created with an object containing at least a 'name' property.",
+    GRANDIOSE_INVALID_ARGS);
+
+  c->status = napi_typeof(env, args[0], &type);
+  REJECT_RETURN;
+  bool isArray;
+  c->status = napi_is_array(env, args[0], &isArray);
+  REJECT_RETURN;
+  if ((type != napi_object) || isArray) REJECT_ERROR_RETURN(
+    "Single argument must be an object, not an array, containing at least a 'name' property.",
+    GRANDIOSE_INVALID_ARGS);
+
+  napi_value config = args[0];
+  napi_value name, groups;
+
+  c->status = napi_get_named_property(env, config, "name", &name);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, name, &type);
+  REJECT_RETURN;
+  if (type != napi_string) REJECT_ERROR_RETURN(
+    "Name property must be of type string.",
+    GRANDIOSE_INVALID_ARGS);
+  size_t namel;
+  c->status = napi_get_value_string_utf8(env, name, nullptr, 0, &namel);
+  REJECT_RETURN;
+  c->name = (char *) malloc(namel + 1);
+  c->status = napi_get_value_string_utf8(env, name, c->name, namel + 1, &namel);
+  REJECT_RETURN;
+
+  c->status = napi_get_named_property(env, config, "groups", &groups);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, groups, &type);
+  REJECT_RETURN;
+  if (type != napi_undefined) {
+    if (type != napi_string) REJECT_ERROR_RETURN(
+      "Groups property must be of type string.",
+      GRANDIOSE_INVALID_ARGS);
+    size_t groupsl;
+    c->status = napi_get_value_string_utf8(env, groups, nullptr, 0, &groupsl);
+    REJECT_RETURN;
+    c->groups = (char *) malloc(groupsl + 1);
+    c->status = napi_get_value_string_utf8(env, groups, c->groups, groupsl + 1, &groupsl);
+    REJECT_RETURN;
+  }
+
+  c->status = queueWork(env, "Routing", routingExecute, routingComplete, c);
+  REJECT_RETURN;
+
+  return promise;
+}
+
+// Point receivers of the routing source at another source. Only the
+// advertised destination changes, so this returns straight away.
+napi_value routingChange(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 1) NAPI_THROW_ERROR("Change requires a source object.");
+  bool isArray = false;
+  status = napi_typeof(env, args[0], &type);
+  CHECK_STATUS;
+  if (type == napi_object) {
+    status = napi_is_array(env, args[0], &isArray);
+    CHECK_STATUS;
+  }
+  if ((type != napi_object) || isArray)
+    NAPI_THROW_ERROR("Source must be an object and not an array.");
+  const char* sourceError;
+  status = checkSource(env, args[0], &sourceError);
+  CHECK_STATUS;
+  if (sourceError != nullptr) {
+    napi_throw_error(env, nullptr, sourceError);
+    return nullptr;
+  }
+
+  NDIlib_routing_instance_t instance;
+  status = getRouting(env, thisValue, &instance);
+  CHECK_STATUS;
+
+  NDIlib_source_t source;
+  status = makeNativeSource(env, args[0], &source);
+  CHECK_STATUS;
+  bool changed = NDIlib_routing_change(instance, &source);
+
+  napi_value sourceValue, result;
+  status = makeSourceObject(env, &source, &sourceValue);
+  free((char*) source.p_ndi_name);
+  free((char*) source.p_url_address);
+  CHECK_STATUS;
+  if (changed) {
+    status = napi_set_named_property(env, thisValue, "source", sourceValue);
+    CHECK_STATUS;
+  }
+
+  status = napi_get_boolean(env, changed, &result);
+  CHECK_STATUS;
+  return result;
+}
+
+// Stop routing receivers anywhere, so that they see no media
+napi_value routingClear(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  NDIlib_routing_instance_t instance;
+  status = getRouting(env, thisValue, &instance);
+  CHECK_STATUS;
+  bool cleared = NDIlib_routing_clear(instance);
+
+  napi_value result;
+  if (cleared) {
+    status = napi_get_undefined(env, &result);
+    CHECK_STATUS;
+    status = napi_set_named_property(env, thisValue, "source", result);
+    CHECK_STATUS;
+  }
+  status = napi_get_boolean(env, cleared, &result);
+  CHECK_STATUS;
+  return result;
+}
+
+// Number of receivers currently connected to the routing source
+napi_value routingConnections(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  NDIlib_routing_instance_t instance;
+  status = getRouting(env, thisValue, &instance);
+  CHECK_STATUS;
+
+  napi_value result;
+  status = napi_create_int32(env, NDIlib_routing_get_no_connections(instance, 0), &result);
+  CHECK_STATUS;
+  return result;
+}
@@ -14,6 +14,7 @@
 */
 
 #include <cstddef>
+#include <stdlib.h>
 #include <Processing.NDI.Lib.h>
 
 #ifdef _WIN32
@@ -25,9 +26,15 @@
 #endif // _WIN32
 
 #include "grandiose_send.h"
+#include "grandiose_submit.h"
+#include "grandiose_pool.h"
 #include "grandiose_util.h"
+#include "grandiose_audio.h"
 
 napi_value videoSend(napi_env env, napi_callback_info info);
+napi_value audioSend(napi_env env, napi_callback_info info);
+napi_value metadataSend(napi_env env, napi_callback_info info);
+napi_value allocateFrame(napi_env env, napi_callback_info info);
 
 void sendExecute(napi_env env, void* data) {
   sendCarrier* c = (sendCarrier *) data;
@@ -46,9 +53,39 @@ void sendExecute(napi_env env, void* data) {
   }
 }
 
+void retainSender(senderInstance* s) {
+  s->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void releaseSender(senderInstance* s) {
+  if (s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    printf("Releasing sender.\n");
+    stopSenderThread(s->env, s);
+    // Destroying the sender ends any asynchronous send, freeing its Buffer
+    NDIlib_send_destroy(s->send);
+    if (s->scheduled != nullptr) napi_delete_reference(s->env, s->scheduled);
+    if (s->scheduledBlock != nullptr) s->frames.release(s->scheduledBlock);
+    delete s;
+  }
+}
+
 void finalizeSend(napi_env env, void* data, void* hint) {
-  printf("Releasing sender.\n");
-  NDIlib_send_destroy((NDIlib_send_instance_t) data);
+  releaseSender((senderInstance*) data);
+}
+
+// Resolve the native sender from the `embedded` property of a sender object,
+// taking a reference that the caller must release.
+napi_status getSender(napi_env env, napi_value sender, senderInstance** result) {
+  napi_status status;
+  napi_value sendValue;
+  status = napi_get_named_property(env, sender, "embedded", &sendValue);
+  PASS_STATUS;
+  void* sendData;
+  status = napi_get_value_external(env, sendValue, &sendData);
+  PASS_STATUS;
+  *result = (senderInstance*) sendData;
+  retainSender(*result);
+  return napi_ok;
 }
 
 void sendComplete(napi_env env, napi_status asyncStatus, void* data) {
@@ -66,8 +103,16 @@ void sendComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_create_object(env, &result);
   REJECT_STATUS;
 
+  senderInstance* instance = new senderInstance;
+  instance->send = c->send;
+  instance->env = env;
+  instance->async = c->async;
   napi_value embedded;
-  c->status = napi_create_external(env, c->send, finalizeSend, nullptr, &embedded);
+  c->status = napi_create_external(env, instance, finalizeSend, nullptr, &embedded);
+  if (c->status != napi_ok) {
+    delete instance;
+    NDIlib_send_destroy(c->send);
+  }
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "embedded", embedded);
   REJECT_STATUS;
@@ -79,28 +124,47 @@ void sendComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "video", videoFn);
   REJECT_STATUS;
 
-  // napi_value audioFn;
-  // c->status = napi_create_function(env, "audio", NAPI_AUTO_LENGTH, audioSend,
-  //   nullptr, &audioFn);
-  // REJECT_STATUS;
-  // c->status = napi_set_named_property(env, result, "audio", audioFn);
-  // REJECT_STATUS;
-
-  // napi_value metadataFn;
-  // c->status = napi_create_function(env, "metadata", NAPI_AUTO_LENGTH, metadataReceive,
-  //   nullptr, &metadataFn);
-  // REJECT_STATUS;
-  // c->status = napi_set_named_property(env, result, "metadata", metadataFn);
-  // REJECT_STATUS;
-
-  // napi_value dataFn;
-  // c->status = napi_create_function(env, "data", NAPI_AUTO_LENGTH, dataReceive,
-  //   nullptr, &dataFn);
-  // REJECT_STATUS;
-  // c->status = napi_set_named_property(env, result, "data", dataFn);
-  // REJECT_STATUS;
-
-  napi_value name, groups, clockVideo, clockAudio;
+  napi_value audioFn;
+  c->status = napi_create_function(env, "audio", NAPI_AUTO_LENGTH, audioSend,
+    nullptr, &audioFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "audio", audioFn);
+  REJECT_STATUS;
+
+  napi_value metadataFn;
+  c->status = napi_create_function(env, "metadata", NAPI_AUTO_LENGTH, metadataSend,
+    nullptr, &metadataFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "metadata", metadataFn);
+  REJECT_STATUS;
+
+  napi_value allocateFn;
+  c->status = napi_create_function(env, "allocateFrame", NAPI_AUTO_LENGTH, allocateFrame,
+    nullptr, &allocateFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "allocateFrame", allocateFn);
+  REJECT_STATUS;
+
+  napi_value latencyFn;
+  c->status = napi_create_function(env, "latency", NAPI_AUTO_LENGTH, senderLatency,
+    nullptr, &latencyFn);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "latency", latencyFn);
+  REJECT_STATUS;
+
+  if (c->queueDepth > 0) {
+    c->status = startSenderThread(env, instance, c->queueDepth);
+    REJECT_STATUS;
+
+    napi_value submitFn;
+    c->status = napi_create_function(env, "submit", NAPI_AUTO_LENGTH, submitVideo,
+      nullptr, &submitFn);
+    REJECT_STATUS;
+    c->status = napi_set_named_property(env, result, "submit", submitFn);
+    REJECT_STATUS;
+  }
+
+  napi_value name, groups, clockVideo, clockAudio, async;
   c->status = napi_create_string_utf8(env, c->name, NAPI_AUTO_LENGTH, &name);
   REJECT_STATUS;
   c->status = napi_set_named_property(env, result, "name", name);
@@ -116,6 +180,11 @@ void sendComplete(napi_env env, napi_status asyncStatus, void* data) {
   c->status = napi_set_named_property(env, result, "clockAudio", clockAudio);
   REJECT_STATUS;
 
+  c->status = napi_get_boolean(env, c->async, &async);
+  REJECT_STATUS;
+  c->status = napi_set_named_property(env, result, "async", async);
+  REJECT_STATUS;
+
   napi_status status;
   status = napi_resolve_deferred(env, c->_deferred, result);
   FLOATING_STATUS;
@@ -150,7 +219,7 @@ napi_value send(napi_env env, napi_callback_info info) {
     GRANDIOSE_INVALID_ARGS);
 
   napi_value config = args[0];
-  napi_value name, groups, clockVideo, clockAudio;
+  napi_value name, groups, clockVideo, clockAudio, async, queueDepth;
 
   c->status = napi_get_named_property(env, config, "name", &name);
   REJECT_RETURN;
@@ -198,24 +267,280 @@ napi_value send(napi_env env, napi_callback_info info) {
     c->status = napi_get_value_bool(env, clockAudio, &c->clockAudio);
     REJECT_RETURN;
   }
-  
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, "Send", NAPI_AUTO_LENGTH, &resource_name);
+
+  c->status = napi_get_named_property(env, config, "async", &async);
   REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, sendExecute,
-    sendComplete, c, &c->_request);
+  c->status = napi_typeof(env, async, &type);
   REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  if (type != napi_undefined) {
+    if (type != napi_boolean) REJECT_ERROR_RETURN(
+      "Async property must be of type boolean.",
+      GRANDIOSE_INVALID_ARGS);
+    c->status = napi_get_value_bool(env, async, &c->async);
+    REJECT_RETURN;
+  }
+
+  c->status = napi_get_named_property(env, config, "queueDepth", &queueDepth);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, queueDepth, &type);
+  REJECT_RETURN;
+  if (type != napi_undefined) {
+    if (type != napi_number) REJECT_ERROR_RETURN(
+      "QueueDepth property must be of type number.",
+      GRANDIOSE_INVALID_ARGS);
+    c->status = napi_get_value_uint32(env, queueDepth, &c->queueDepth);
+    REJECT_RETURN;
+    if (c->queueDepth > 1024) REJECT_ERROR_RETURN(
+      "QueueDepth must be no more than 1024.",
+      GRANDIOSE_OUT_OF_RANGE);
+  }
+  
+  c->status = queueWork(env, "Send", sendExecute, sendComplete, c);
   REJECT_RETURN;
 
   return promise;
 }
 
+#define FRAME_POOL_ALIGN 4096 // Page aligned
+#define FRAME_POOL_MAX_FREE 4
+
+char* allocAligned(size_t size) {
+#ifdef _WIN32
+  return (char*) _aligned_malloc(size, FRAME_POOL_ALIGN);
+#else
+  void* data = nullptr;
+  return (posix_memalign(&data, FRAME_POOL_ALIGN, size) == 0) ? (char*) data : nullptr;
+#endif
+}
+
+void freeAligned(char* data) {
+#ifdef _WIN32
+  _aligned_free(data);
+#else
+  free(data);
+#endif
+}
+
+void freeFrameBlock(frameBlock* block) {
+  if (block->locked) unlockMemory(block->data, block->size);
+  freeAligned(block->data);
+  delete block;
+}
+
+framePool::~framePool() {
+  for (frameBlock* block : free) freeFrameBlock(block);
+}
+
+// Returns nullptr when out of memory
+frameBlock* framePool::acquire(size_t size) {
+  if (size != blockSize) { // Frame format has changed
+    for (frameBlock* block : free) freeFrameBlock(block);
+    free.clear();
+    blockSize = size;
+  }
+  if (!free.empty()) {
+    frameBlock* block = free.back();
+    free.pop_back();
+    return block;
+  }
+  char* data = allocAligned(size);
+  if (data == nullptr) return nullptr;
+  return new frameBlock { data, size, lockMemory(data, size) };
+}
+
+void framePool::release(frameBlock* block) {
+  if (block->size == blockSize && free.size() < FRAME_POOL_MAX_FREE) {
+    free.push_back(block);
+    return;
+  }
+  freeFrameBlock(block);
+}
+
+void finalizeFrameLease(napi_env env, void* data, void* hint) {
+  frameLease* lease = (frameLease*) hint;
+  if (!lease->returned) {
+    lease->instance->leases.erase(lease->block->data);
+    lease->instance->frames.release(lease->block);
+  }
+  releaseSender(lease->instance);
+  delete lease;
+}
+
+// If buffer was handed out by allocateFrame, detach it from its memory and
+// take back the block for sending, or leave block as nullptr.
+napi_status returnFrameLease(napi_env env, senderInstance* instance, napi_value buffer,
+  frameBlock** block) {
+  napi_status status;
+  napi_typedarray_type type;
+  size_t length, offset;
+  void* data;
+  napi_value arrayBuffer;
+
+  *block = nullptr;
+  status = napi_get_typedarray_info(env, buffer, &type, &length, &data, &arrayBuffer, &offset);
+  PASS_STATUS;
+  auto found = instance->leases.find(data);
+  if (found == instance->leases.end() || offset != 0) return napi_ok;
+  // Where the engine will not detach the Buffer, it is pinned like any other
+  if (napi_detach_arraybuffer(env, arrayBuffer) != napi_ok) return napi_ok;
+
+  frameLease* lease = found->second;
+  instance->leases.erase(found);
+  lease->returned = true;
+  *block = lease->block;
+  return napi_ok;
+}
+
+// Bytes in a frame of the given format, with the stride of its first plane,
+// or zero for formats that cannot be allocated
+size_t videoFrameSize(NDIlib_FourCC_video_type_e fourCC, int32_t xres, int32_t yres,
+  int32_t* lineStride) {
+  size_t pixels = (size_t) xres * yres;
+  switch (fourCC) {
+    case NDIlib_FourCC_video_type_UYVY:
+      *lineStride = xres * 2;
+      return pixels * 2;
+    case NDIlib_FourCC_video_type_UYVA: // Followed by an alpha plane
+      *lineStride = xres * 2;
+      return pixels * 3;
+    case NDIlib_FourCC_video_type_P216: // 16-bit Y plane, then interleaved CbCr
+      *lineStride = xres * 2;
+      return pixels * 4;
+    case NDIlib_FourCC_video_type_PA16: // Followed by a 16-bit alpha plane
+      *lineStride = xres * 2;
+      return pixels * 6;
+    case NDIlib_FourCC_video_type_YV12:
+    case NDIlib_FourCC_video_type_I420:
+    case NDIlib_FourCC_video_type_NV12:
+      if ((xres % 2 != 0) || (yres % 2 != 0)) return 0;
+      *lineStride = xres;
+      return pixels * 3 / 2;
+    case NDIlib_FourCC_video_type_BGRA:
+    case NDIlib_FourCC_video_type_BGRX:
+    case NDIlib_FourCC_video_type_RGBA:
+    case NDIlib_FourCC_video_type_RGBX:
+      *lineStride = xres * 4;
+      return pixels * 4;
+    default:
+      return 0;
+  }
+}
+
+// Hand out a video frame of the given format, with its data in memory owned
+// by the sender. The memory is reused once the frame has been sent, or
+// otherwise once its data Buffer is garbage collected.
+napi_value allocateFrame(napi_env env, napi_callback_info info) {
+  napi_status status;
+  napi_valuetype type;
+  senderInstance* instance;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 1)
+    NAPI_THROW_ERROR("A frame format must be provided to allocate a frame.");
+  status = napi_typeof(env, args[0], &type);
+  CHECK_STATUS;
+  if (type != napi_object)
+    NAPI_THROW_ERROR("Frame format must be an object.");
+
+  const char* names[3] = { "xres", "yres", "fourCC" };
+  int32_t values[3];
+  for ( int x = 0 ; x < 3 ; x++ ) {
+    napi_value param;
+    status = napi_get_named_property(env, args[0], names[x], &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_number)
+      NAPI_THROW_ERROR("Frame format must have numeric xres, yres and fourCC properties.");
+    status = napi_get_value_int32(env, param, &values[x]);
+    CHECK_STATUS;
+  }
+  int32_t xres = values[0], yres = values[1], lineStride = 0;
+  NDIlib_FourCC_video_type_e fourCC = (NDIlib_FourCC_video_type_e) values[2];
+  if ((xres <= 0) || (yres <= 0))
+    NAPI_THROW_ERROR("Frame xres and yres must be greater than zero.");
+  size_t size = videoFrameSize(fourCC, xres, yres, &lineStride);
+  if (size == 0)
+    NAPI_THROW_ERROR("Frames cannot be allocated with this fourCC and resolution.");
+
+  status = getSender(env, thisValue, &instance);
+  CHECK_STATUS;
+  frameBlock* block = instance->frames.acquire(size);
+  if (block == nullptr) {
+    releaseSender(instance);
+    NAPI_THROW_ERROR("Failed to allocate memory for a video frame.");
+  }
+
+  // The lease keeps hold of the sender reference taken above
+  frameLease* lease = new frameLease { instance, block };
+  napi_value data;
+  status = napi_create_external_buffer(env, size, block->data, finalizeFrameLease, lease, &data);
+  if (status != napi_ok) {
+    instance->frames.release(block);
+    releaseSender(instance);
+    delete lease;
+  }
+  CHECK_STATUS;
+  instance->leases[block->data] = lease;
+
+  napi_value result, param;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+  status = napi_create_string_utf8(env, "video", NAPI_AUTO_LENGTH, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "type", param);
+  CHECK_STATUS;
+
+  // Defaults for properties needed to send the frame, to be overwritten
+  const char* intNames[7] = { "xres", "yres", "frameRateN", "frameRateD",
+    "fourCC", "frameFormatType", "lineStrideBytes" };
+  int32_t intValues[7] = { xres, yres, 30000, 1001,
+    fourCC, NDIlib_frame_format_type_progressive, lineStride };
+  for ( int x = 0 ; x < 7 ; x++ ) {
+    status = napi_create_int32(env, intValues[x], &param);
+    CHECK_STATUS;
+    status = napi_set_named_property(env, result, intNames[x], param);
+    CHECK_STATUS;
+  }
+  status = napi_create_double(env, (double) xres / yres, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "pictureAspectRatio", param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "data", data);
+  CHECK_STATUS;
+
+  return result;
+}
 
 void videoSendExecute(napi_env env, void* data) {
   sendDataCarrier* c = (sendDataCarrier*) data;
+  c->instance->stats.queue.recordSince(c->created);
+  HR_TIME_POINT start = NOW;
+
+  if (!c->instance->async) {
+    NDIlib_send_send_video_v2(c->send, &c->videoFrame);
+    c->instance->stats.send.recordSince(start);
+    return;
+  }
 
-  NDIlib_send_send_video_v2(c->send, &c->videoFrame);
+  // Returns once the frame is scheduled, waiting only for the SDK to finish
+  // with the frame before, whose Buffer can then be let go. A frame with no
+  // data flushes the sender.
+  std::lock_guard<std::mutex> lock(c->instance->asyncLock);
+  NDIlib_send_send_video_async_v2(c->send,
+    (c->videoFrame.p_data != nullptr) ? &c->videoFrame : nullptr);
+  c->releasedBufferRef = c->instance->scheduled;
+  c->instance->scheduled = c->sourceBufferRef;
+  c->sourceBufferRef = nullptr;
+  c->releasedBlock = c->instance->scheduledBlock;
+  c->instance->scheduledBlock = c->sourceBlock;
+  c->sourceBlock = nullptr;
+  c->instance->stats.send.recordSince(start);
 }
 
 void videoSendComplete(napi_env env, napi_status asyncStatus, void* data) {
@@ -223,9 +548,6 @@ void videoSendComplete(napi_env env, napi_status asyncStatus, void* data) {
   napi_value result;
   napi_status status;
 
-  c->status = napi_delete_reference(env, c->sourceBufferRef);
-  REJECT_STATUS;
-
   if (asyncStatus != napi_ok) {
     c->status = asyncStatus;
     c->errorMsg = "Async video frame receive failed to complete.";
@@ -243,6 +565,7 @@ void videoSendComplete(napi_env env, napi_status asyncStatus, void* data) {
 napi_value videoSend(napi_env env, napi_callback_info info) {
   napi_valuetype type;
   sendDataCarrier* c = new sendDataCarrier;
+  napi_value videoBuffer = nullptr;
 
   napi_value promise;
   c->status = napi_create_promise(env, &c->_deferred, &promise);
@@ -254,15 +577,22 @@ napi_value videoSend(napi_env env, napi_callback_info info) {
   c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
   REJECT_RETURN;
 
-  napi_value sendValue;
-  c->status = napi_get_named_property(env, thisValue, "embedded", &sendValue);
-  REJECT_RETURN;
-  void* sendData;
-  c->status = napi_get_value_external(env, sendValue, &sendData);
-  c->send = (NDIlib_send_instance_t) sendData;
+  c->status = getSender(env, thisValue, &c->instance);
   REJECT_RETURN;
+  c->send = c->instance->send;
+
+  if (c->instance->async && c->instance->thread != nullptr) REJECT_ERROR_RETURN(
+    "Video is sent with submit on async senders with a queueDepth.",
+    GRANDIOSE_INVALID_ARGS);
 
-  if (argc >= 1) {
+  if (argc >= 1 && c->instance->async) {
+    c->status = napi_typeof(env, args[0], &type);
+    REJECT_RETURN;
+  }
+  if (argc >= 1 && c->instance->async && (type == napi_null || type == napi_undefined)) {
+    // Flush, releasing the last frame sent asynchronously
+    c->videoFrame.p_data = nullptr;
+  } else if (argc >= 1) {
     napi_value config;
     config = args[0];
     c->status = napi_typeof(env, config, &type);
@@ -357,7 +687,6 @@ napi_value videoSend(napi_env env, napi_callback_info info) {
     c->status = napi_get_value_int32(env, param, &c->videoFrame.line_stride_in_bytes);
     REJECT_RETURN;
 
-    napi_value videoBuffer;
     c->status = napi_get_named_property(env, config, "data", &videoBuffer);
     REJECT_RETURN;
     c->status = napi_is_buffer(env, videoBuffer, &isBuffer);
@@ -369,9 +698,10 @@ napi_value videoSend(napi_env env, napi_callback_info info) {
     size_t length;
     c->status = napi_get_buffer_info(env, videoBuffer, &data, &length);
     REJECT_RETURN;
+    if (length == 0) REJECT_ERROR_RETURN(
+      "data must not be empty. Frames from allocateFrame can only be sent once.",
+      GRANDIOSE_INVALID_ARGS);
     c->videoFrame.p_data = (uint8_t*) data;
-    c->status = napi_create_reference(env, videoBuffer, 1, &c->sourceBufferRef);
-    REJECT_RETURN;
     // TODO: check length
 
 
@@ -392,13 +722,335 @@ napi_value videoSend(napi_env env, napi_callback_info info) {
       "frame not provided",
     GRANDIOSE_INVALID_ARGS);
 
-  napi_value resource_name;
-  c->status = napi_create_string_utf8(env, "VideoSend", NAPI_AUTO_LENGTH, &resource_name);
+  // Memory from the sender's pool goes back to it once sent. Other Buffers
+  // are pinned until the SDK has finished with them.
+  if (videoBuffer != nullptr) {
+    c->status = returnFrameLease(env, c->instance, videoBuffer, &c->sourceBlock);
+    REJECT_RETURN;
+    if (c->sourceBlock == nullptr) {
+      c->status = napi_create_reference(env, videoBuffer, 1, &c->sourceBufferRef);
+      REJECT_RETURN;
+    }
+  }
+
+  c->status = queueWork(env, "VideoSend", videoSendExecute, videoSendComplete, c);
   REJECT_RETURN;
-  c->status = napi_create_async_work(env, NULL, resource_name, videoSendExecute,
-    videoSendComplete, c, &c->_request);
+
+  return promise;
+}
+
+// Read an optional [ seconds, nanoseconds ] timecode, as found on received
+// frames, in 100ns units. Left to the SDK to synthesize when not present.
+bool readTimecode(napi_env env, napi_value config, int64_t* timecode) {
+  napi_value param, element;
+  napi_valuetype type;
+  bool isArray;
+  uint32_t length;
+  int64_t parts[2];
+
+  *timecode = NDIlib_send_timecode_synthesize;
+  if (napi_get_named_property(env, config, "timecode", &param) != napi_ok) return false;
+  if (napi_typeof(env, param, &type) != napi_ok) return false;
+  if (type == napi_undefined) return true;
+  if (napi_is_array(env, param, &isArray) != napi_ok || !isArray) return false;
+  if (napi_get_array_length(env, param, &length) != napi_ok || length != 2) return false;
+  for ( uint32_t x = 0 ; x < 2 ; x++ ) {
+    if (napi_get_element(env, param, x, &element) != napi_ok) return false;
+    if (napi_typeof(env, element, &type) != napi_ok || type != napi_number) return false;
+    if (napi_get_value_int64(env, element, &parts[x]) != napi_ok) return false;
+  }
+  *timecode = parts[0] * 10000000 + parts[1] / 100;
+  return true;
+}
+
+void audioSendExecute(napi_env env, void* data) {
+  sendDataCarrier* c = (sendDataCarrier*) data;
+  c->instance->stats.queue.recordSince(c->created);
+
+  switch (c->audioFormat) {
+    case Grandiose_audio_format_float_32_interleaved:
+      audioFromInterleaved32f((const float *) c->interleaved, &c->audioFrame);
+      break;
+    case Grandiose_audio_format_int_16_interleaved:
+      audioFromInterleaved16s((const int16_t *) c->interleaved, c->referenceLevel, &c->audioFrame);
+      break;
+    default:
+      break;
+  }
+
+  HR_TIME_POINT start = NOW;
+  NDIlib_send_send_audio_v2(c->send, &c->audioFrame);
+  c->instance->stats.send.recordSince(start);
+}
+
+void audioSendComplete(napi_env env, napi_status asyncStatus, void* data) {
+  sendDataCarrier* c = (sendDataCarrier*) data;
+  napi_value result;
+  napi_status status;
+
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async audio frame send failed to complete.";
+  }
+  REJECT_STATUS;
+
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+napi_value audioSend(napi_env env, napi_callback_info info) {
+  napi_valuetype type;
+  sendDataCarrier* c = new sendDataCarrier;
+
+  napi_value promise;
+  c->status = napi_create_promise(env, &c->_deferred, &promise);
+  REJECT_RETURN;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  REJECT_RETURN;
+
+  c->status = getSender(env, thisValue, &c->instance);
+  REJECT_RETURN;
+  c->send = c->instance->send;
+
+  if (argc < 1) REJECT_ERROR_RETURN(
+    "frame not provided",
+    GRANDIOSE_INVALID_ARGS);
+
+  napi_value config = args[0];
+  c->status = napi_typeof(env, config, &type);
+  REJECT_RETURN;
+  bool isArray, isBuffer;
+  c->status = napi_is_array(env, config, &isArray);
+  REJECT_RETURN;
+  if ((type != napi_object) || isArray) REJECT_ERROR_RETURN(
+    "Argument to audio send must be an object, not an array.",
+    GRANDIOSE_INVALID_ARGS);
+
+  napi_value param;
+  c->status = napi_get_named_property(env, config, "audioFormat", &param);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, param, &type);
   REJECT_RETURN;
-  c->status = napi_queue_async_work(env, c->_request);
+  if (type == napi_number) {
+    uint32_t audioFormatN;
+    c->status = napi_get_value_uint32(env, param, &audioFormatN);
+    REJECT_RETURN;
+    if (!validAudioFormat((Grandiose_audio_format_e) audioFormatN)) REJECT_ERROR_RETURN(
+      "Invalid audio format specified.",
+      GRANDIOSE_INVALID_ARGS);
+    c->audioFormat = (Grandiose_audio_format_e) audioFormatN;
+  }
+  else if (type != napi_undefined) REJECT_ERROR_RETURN(
+    "Audio format value must be a number if present.",
+    GRANDIOSE_INVALID_ARGS);
+
+  c->status = napi_get_named_property(env, config, "referenceLevel", &param);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, param, &type);
+  REJECT_RETURN;
+  if (type == napi_number) {
+    c->status = napi_get_value_int32(env, param, &c->referenceLevel);
+    REJECT_RETURN;
+  }
+  else if (type != napi_undefined) REJECT_ERROR_RETURN(
+    "Audio reference level must be a number if present.",
+    GRANDIOSE_INVALID_ARGS);
+
+  c->status = napi_get_named_property(env, config, "sampleRate", &param);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, param, &type);
+  REJECT_RETURN;
+  if (type != napi_number) REJECT_ERROR_RETURN(
+    "sampleRate value must be a number",
+    GRANDIOSE_INVALID_ARGS);
+  c->status = napi_get_value_int32(env, param, &c->audioFrame.sample_rate);
+  REJECT_RETURN;
+
+  c->status = napi_get_named_property(env, config, "channels", &param);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, param, &type);
+  REJECT_RETURN;
+  if (type != napi_number) REJECT_ERROR_RETURN(
+    "channels value must be a number",
+    GRANDIOSE_INVALID_ARGS);
+  c->status = napi_get_value_int32(env, param, &c->audioFrame.no_channels);
+  REJECT_RETURN;
+
+  c->status = napi_get_named_property(env, config, "samples", &param);
+  REJECT_RETURN;
+  c->status = napi_typeof(env, param, &type);
+  REJECT_RETURN;
+  if (type != napi_number) REJECT_ERROR_RETURN(
+    "samples value must be a number",
+    GRANDIOSE_INVALID_ARGS);
+  c->status = napi_get_value_int32(env, param, &c->audioFrame.no_samples);
+  REJECT_RETURN;
+
+  if ((c->audioFrame.sample_rate <= 0) || (c->audioFrame.no_channels <= 0) ||
+      (c->audioFrame.no_samples <= 0)) REJECT_ERROR_RETURN(
+    "sampleRate, channels and samples must be greater than zero.",
+    GRANDIOSE_OUT_OF_RANGE);
+
+  // Planar float may have gaps between channels; interleaved samples are
+  // converted into a tightly packed planar buffer
+  c->audioFrame.channel_stride_in_bytes = c->audioFrame.no_samples * sizeof(float);
+  if (c->audioFormat == Grandiose_audio_format_float_32_separate) {
+    c->status = napi_get_named_property(env, config, "channelStrideInBytes", &param);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, param, &type);
+    REJECT_RETURN;
+    if (type == napi_number) {
+      c->status = napi_get_value_int32(env, param, &c->audioFrame.channel_stride_in_bytes);
+      REJECT_RETURN;
+      if (c->audioFrame.channel_stride_in_bytes < c->audioFrame.no_samples * (int32_t) sizeof(float))
+        REJECT_ERROR_RETURN(
+          "channelStrideInBytes is too small for the number of samples.",
+          GRANDIOSE_OUT_OF_RANGE);
+    }
+    else if (type != napi_undefined) REJECT_ERROR_RETURN(
+      "channelStrideInBytes value must be a number if present.",
+      GRANDIOSE_INVALID_ARGS);
+  }
+
+  if (!readTimecode(env, config, &c->audioFrame.timecode)) REJECT_ERROR_RETURN(
+    "timecode must be an array of seconds and nanoseconds if present.",
+    GRANDIOSE_INVALID_ARGS);
+
+  napi_value audioBuffer;
+  c->status = napi_get_named_property(env, config, "data", &audioBuffer);
+  REJECT_RETURN;
+  c->status = napi_is_buffer(env, audioBuffer, &isBuffer);
+  REJECT_RETURN;
+  if (!isBuffer) REJECT_ERROR_RETURN(
+    "data must be provided as a Node Buffer",
+    GRANDIOSE_INVALID_ARGS);
+  void* data;
+  size_t length, required;
+  c->status = napi_get_buffer_info(env, audioBuffer, &data, &length);
+  REJECT_RETURN;
+
+  size_t samples = (size_t) c->audioFrame.no_channels * c->audioFrame.no_samples;
+  switch (c->audioFormat) {
+    case Grandiose_audio_format_float_32_interleaved:
+      required = samples * sizeof(float);
+      break;
+    case Grandiose_audio_format_int_16_interleaved:
+      required = samples * sizeof(int16_t);
+      break;
+    default:
+      required = (size_t) c->audioFrame.channel_stride_in_bytes * (c->audioFrame.no_channels - 1) +
+        c->audioFrame.no_samples * sizeof(float);
+      break;
+  }
+  if (length < required) REJECT_ERROR_RETURN(
+    "data buffer is too small for the given channels and samples.",
+    GRANDIOSE_OUT_OF_RANGE);
+
+  // Planar float is sent straight from the caller's Buffer
+  if (c->audioFormat == Grandiose_audio_format_float_32_separate) {
+    c->audioFrame.p_data = (float*) data;
+  } else {
+    c->interleaved = data;
+    c->planar = (float*) malloc(samples * sizeof(float));
+    if (c->planar == nullptr) REJECT_ERROR_RETURN(
+      "Failed to allocate memory for planar audio.",
+      GRANDIOSE_ALLOCATION_FAILURE);
+    c->audioFrame.p_data = c->planar;
+  }
+
+  c->status = napi_create_reference(env, audioBuffer, 1, &c->sourceBufferRef);
+  REJECT_RETURN;
+  c->status = queueWork(env, "AudioSend", audioSendExecute, audioSendComplete, c);
+  REJECT_RETURN;
+
+  return promise;
+}
+
+void metadataSendExecute(napi_env env, void* data) {
+  sendDataCarrier* c = (sendDataCarrier*) data;
+  c->instance->stats.queue.recordSince(c->created);
+
+  HR_TIME_POINT start = NOW;
+  NDIlib_send_send_metadata(c->send, &c->metadataFrame);
+  c->instance->stats.send.recordSince(start);
+}
+
+void metadataSendComplete(napi_env env, napi_status asyncStatus, void* data) {
+  sendDataCarrier* c = (sendDataCarrier*) data;
+  napi_value result;
+  napi_status status;
+
+  if (asyncStatus != napi_ok) {
+    c->status = asyncStatus;
+    c->errorMsg = "Async metadata send failed to complete.";
+  }
+  REJECT_STATUS;
+
+  c->status = napi_create_object(env, &result);
+  REJECT_STATUS;
+  status = napi_resolve_deferred(env, c->_deferred, result);
+  FLOATING_STATUS;
+
+  tidyCarrier(env, c);
+}
+
+// Send an XML string, or an object with the XML as its data property and an
+// optional timecode
+napi_value metadataSend(napi_env env, napi_callback_info info) {
+  napi_valuetype type;
+  sendDataCarrier* c = new sendDataCarrier;
+
+  napi_value promise;
+  c->status = napi_create_promise(env, &c->_deferred, &promise);
+  REJECT_RETURN;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  c->status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  REJECT_RETURN;
+
+  c->status = getSender(env, thisValue, &c->instance);
+  REJECT_RETURN;
+  c->send = c->instance->send;
+
+  if (argc < 1) REJECT_ERROR_RETURN(
+    "metadata not provided",
+    GRANDIOSE_INVALID_ARGS);
+
+  napi_value xml = args[0];
+  c->status = napi_typeof(env, xml, &type);
+  REJECT_RETURN;
+  if (type == napi_object) {
+    if (!readTimecode(env, args[0], &c->metadataFrame.timecode)) REJECT_ERROR_RETURN(
+      "timecode must be an array of seconds and nanoseconds if present.",
+      GRANDIOSE_INVALID_ARGS);
+    c->status = napi_get_named_property(env, args[0], "data", &xml);
+    REJECT_RETURN;
+    c->status = napi_typeof(env, xml, &type);
+    REJECT_RETURN;
+  }
+  if (type != napi_string) REJECT_ERROR_RETURN(
+    "Metadata must be a string or an object with a string data property.",
+    GRANDIOSE_INVALID_ARGS);
+
+  size_t xmll;
+  c->status = napi_get_value_string_utf8(env, xml, nullptr, 0, &xmll);
+  REJECT_RETURN;
+  c->metadataFrame.p_data = (char *) malloc(xmll + 1);
+  c->status = napi_get_value_string_utf8(env, xml, c->metadataFrame.p_data, xmll + 1, &xmll);
+  REJECT_RETURN;
+  c->metadataFrame.length = (int) xmll + 1;
+
+  c->status = queueWork(env, "MetadataSend", metadataSendExecute, metadataSendComplete, c);
   REJECT_RETURN;
 
   return promise;
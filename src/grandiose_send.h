@@ -16,16 +16,81 @@
 #ifndef GRANDIOSE_SEND_H
 #define GRANDIOSE_SEND_H
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "node_api.h"
 #include "grandiose_util.h"
+#include "grandiose_stats.h"
 
 napi_value send(napi_env env, napi_callback_info info);
 
+// Page aligned video frame memory handed out by sender.allocateFrame. Blocks
+// are recycled once JS has let go of them and the SDK has finished sending
+// them. Only used on the JS thread.
+struct frameBlock {
+  char* data;
+  size_t size;
+  bool locked; // In memory, by configure({ lockMemory })
+};
+
+struct framePool {
+  std::vector<frameBlock*> free;
+  size_t blockSize = 0;
+  ~framePool();
+  frameBlock* acquire(size_t size);
+  void release(frameBlock* block);
+};
+
+struct senderInstance;
+struct senderThread;
+
+// Ties a block to the Buffer it was handed out in, until the Buffer is either
+// collected or passed back to the sender to be sent
+struct frameLease {
+  senderInstance* instance;
+  frameBlock* block;
+  bool returned = false;
+};
+
+// Native state behind a sender object, shared by reference count with any
+// sends in flight so that the NDI sender outlives them
+struct senderInstance {
+  NDIlib_send_instance_t send = nullptr;
+  napi_env env; // All references are released on the JS thread
+  bool async = false;
+  // Serialises asynchronous video sends and their access to the frame the
+  // SDK holds until the next synchronizing event. Sends queued together may
+  // still take it in either order.
+  std::mutex asyncLock;
+  napi_ref scheduled = nullptr;
+  frameBlock* scheduledBlock = nullptr;
+  framePool frames;
+  std::unordered_map<void*, frameLease*> leases; // By data address
+  senderThread* thread = nullptr; // Sends submitted video, if started
+  sendStats stats;
+  std::atomic<int32_t> refs{1};
+};
+
+void retainSender(senderInstance* s);
+void releaseSender(senderInstance* s);
+napi_status getSender(napi_env env, napi_value sender, senderInstance** result);
+napi_status returnFrameLease(napi_env env, senderInstance* instance, napi_value buffer,
+  frameBlock** block);
+// Page aligned memory, as used for frame pools
+char* allocAligned(size_t size);
+void freeAligned(char* data);
+size_t videoFrameSize(NDIlib_FourCC_video_type_e fourCC, int32_t xres, int32_t yres,
+  int32_t* lineStride);
+
 struct sendCarrier : carrier {
   char* name = nullptr;
   char* groups = nullptr;
   bool clockVideo = false;
   bool clockAudio = false;
+  bool async = false;
+  uint32_t queueDepth = 0; // Start a send thread with this queue depth
   NDIlib_send_instance_t send;
   ~sendCarrier() {
     free(name);
@@ -33,13 +98,33 @@ struct sendCarrier : carrier {
 };
 
 struct sendDataCarrier : carrier {
+  senderInstance* instance = nullptr;
   NDIlib_send_instance_t send;
   NDIlib_video_frame_v2_t videoFrame;
   NDIlib_audio_frame_v2_t audioFrame;
   NDIlib_metadata_frame_t metadataFrame;
   napi_ref sourceBufferRef = nullptr;
+  // Pooled frame memory, in place of a Buffer reference
+  frameBlock* sourceBlock = nullptr;
+  // Buffer of an earlier asynchronous frame that this send let the SDK release
+  napi_ref releasedBufferRef = nullptr;
+  frameBlock* releasedBlock = nullptr;
+  // Interleaved audio is converted on the worker thread from the pinned
+  // source Buffer into planar samples owned by the carrier
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 0;
+  void* interleaved = nullptr;
+  float* planar = nullptr;
   ~sendDataCarrier() {
-    // TODO: free sourceBufferRef
+    free(planar);
+    free(metadataFrame.p_data);
+    if (instance != nullptr) {
+      if (sourceBufferRef != nullptr) napi_delete_reference(instance->env, sourceBufferRef);
+      if (releasedBufferRef != nullptr) napi_delete_reference(instance->env, releasedBufferRef);
+      if (sourceBlock != nullptr) instance->frames.release(sourceBlock);
+      if (releasedBlock != nullptr) instance->frames.release(releasedBlock);
+      releaseSender(instance);
+    }
   }
 };
 
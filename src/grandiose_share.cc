@@ -0,0 +1,418 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_share.h"
+#include "grandiose_receive.h"
+#include "grandiose_record.h"
+#include "grandiose_video.h"
+#include "grandiose_pool.h"
+#include "grandiose_util.h"
+
+// Time to block in each capture, bounding how long stopping takes
+#define SHARE_CAPTURE_WAIT 100
+#define SHARE_MAX_SLOTS 64
+#define SHARE_MAX_SLOT_SIZE (256 * 1024 * 1024)
+#define SHARE_MAX_READERS 1024
+#define SHARE_DEFAULT_SLOT_SIZE (1920 * 1080 * 4) // An HD frame of 4 bytes per pixel
+
+// Fields are shared with Atomics in JS, which work on the same plain int32s
+std::atomic<int32_t> *shareField(char *header, int32_t index)
+{
+  return reinterpret_cast<std::atomic<int32_t> *>(header + index * sizeof(int32_t));
+}
+
+void setSlotTimes(int32_t *fields, int64_t timestamp, int64_t timecode)
+{
+  fields[SLOT_FIELD_TIMESTAMP] = (int32_t)(timestamp / 10000000);
+  fields[SLOT_FIELD_TIMESTAMP + 1] = (int32_t)((timestamp % 10000000) * 100);
+  fields[SLOT_FIELD_TIMECODE] = (int32_t)(timecode / 10000000);
+  fields[SLOT_FIELD_TIMECODE + 1] = (int32_t)((timecode % 10000000) * 100);
+}
+
+// Convert or copy a picture into a free slot. Returns false if it does not fit.
+bool shareVideo(shareState *s, char *slot, NDIlib_video_frame_v2_t *frame)
+{
+  receiverInstance *instance = s->instance;
+  uint8_t *data = (uint8_t *)slot + SHARE_SLOT_HEADER_SIZE;
+  Grandiose_video_format_e outputFormat = Grandiose_video_format_native;
+  int32_t lineStride = frame->line_stride_in_bytes;
+  size_t size = 0;
+  if (instance->outputFormat != Grandiose_video_format_native)
+    size = videoOutputSize(frame, instance->outputFormat, &lineStride);
+  if (size > 0)
+  {
+    if (size > s->slotSize)
+      return false;
+    HR_TIME_POINT start = NOW;
+    convertVideoFrame(frame, instance->outputFormat, data);
+    instance->stats.conversion.recordSince(start);
+    outputFormat = instance->outputFormat;
+  }
+  else
+  {
+    lineStride = frame->line_stride_in_bytes;
+    size = receivedVideoSize(frame);
+    if (size > s->slotSize)
+      return false;
+    memcpy(data, frame->p_data, size);
+    instance->stats.addCopy(size);
+  }
+
+  int32_t *fields = (int32_t *)slot;
+  fields[SLOT_FIELD_TYPE] = SLOT_TYPE_VIDEO;
+  fields[SLOT_FIELD_SIZE] = (int32_t)size;
+  setSlotTimes(fields, frame->timestamp, frame->timecode);
+  fields[SLOT_FIELD_XRES] = frame->xres;
+  fields[SLOT_FIELD_YRES] = frame->yres;
+  fields[SLOT_FIELD_FOURCC] = (int32_t)frame->FourCC;
+  fields[SLOT_FIELD_LINE_STRIDE] = lineStride;
+  fields[SLOT_FIELD_FRAME_RATE_N] = frame->frame_rate_N;
+  fields[SLOT_FIELD_FRAME_RATE_D] = frame->frame_rate_D;
+  fields[SLOT_FIELD_FRAME_FORMAT_TYPE] = frame->frame_format_type;
+  memcpy(&fields[SLOT_FIELD_PICTURE_ASPECT_RATIO], &frame->picture_aspect_ratio, sizeof(float));
+  fields[SLOT_FIELD_OUTPUT_FORMAT] = outputFormat;
+  return true;
+}
+
+// Copy planar float samples into a free slot, with the channels packed
+// together. Returns false if they do not fit.
+bool shareAudio(shareState *s, char *slot, NDIlib_audio_frame_v2_t *frame)
+{
+  size_t channelSize = (size_t)frame->no_samples * sizeof(float);
+  size_t size = channelSize * frame->no_channels;
+  if (size > s->slotSize)
+    return false;
+  char *data = slot + SHARE_SLOT_HEADER_SIZE;
+  for (int32_t c = 0; c < frame->no_channels; c++)
+    memcpy(data + c * channelSize, (char *)frame->p_data + c * frame->channel_stride_in_bytes,
+           channelSize);
+  s->instance->stats.addCopy(size);
+
+  int32_t *fields = (int32_t *)slot;
+  fields[SLOT_FIELD_TYPE] = SLOT_TYPE_AUDIO;
+  fields[SLOT_FIELD_SIZE] = (int32_t)size;
+  setSlotTimes(fields, frame->timestamp, frame->timecode);
+  fields[SLOT_FIELD_SAMPLE_RATE] = frame->sample_rate;
+  fields[SLOT_FIELD_CHANNELS] = frame->no_channels;
+  fields[SLOT_FIELD_SAMPLES] = frame->no_samples;
+  fields[SLOT_FIELD_CHANNEL_STRIDE] = (int32_t)channelSize;
+  return true;
+}
+
+void shareCapture(shareState *s)
+{
+  prepareMediaThread();
+  while (s->running.load(std::memory_order_relaxed))
+  {
+    NDIlib_video_frame_v2_t video;
+    NDIlib_audio_frame_v2_t audio;
+    NDIlib_frame_type_e type = captureFrame(s->instance,
+                                            s->captureVideo ? &video : nullptr,
+                                            s->captureAudio ? &audio : nullptr,
+                                            nullptr, SHARE_CAPTURE_WAIT);
+    if (type != NDIlib_frame_type_video && type != NDIlib_frame_type_audio)
+      continue;
+
+    // A slot is only written once every reader is done with its last frame
+    char *slot = s->base + SHARE_HEADER_SIZE + (size_t)(s->sequence % s->slots) * s->slotStride;
+    std::atomic<int32_t> *refs = shareField(slot, SLOT_FIELD_REFS);
+    bool published = false;
+    if (refs->load(std::memory_order_acquire) == 0)
+      published = (type == NDIlib_frame_type_video) ? shareVideo(s, slot, &video)
+                                                    : shareAudio(s, slot, &audio);
+    if (type == NDIlib_frame_type_video)
+      NDIlib_recv_free_video_v2(s->instance->recv, &video);
+    else
+      NDIlib_recv_free_audio_v2(s->instance->recv, &audio);
+    if (!published)
+    {
+      shareField(s->base, SHARE_FIELD_DROPPED)->fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    shareField(slot, SLOT_FIELD_SEQUENCE)->store((int32_t)s->sequence, std::memory_order_relaxed);
+    refs->store(s->readers, std::memory_order_release);
+    s->sequence++;
+    shareField(s->base, SHARE_FIELD_SEQUENCE)->store((int32_t)s->sequence, std::memory_order_release);
+
+    if (!s->signalled.exchange(true))
+      napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+  }
+}
+
+// Wake readers waiting on the sequence with Atomics.notify
+void shareCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  shareState *s = (shareState *)context;
+  if (env == nullptr)
+    return;
+
+  napi_status status;
+  s->signalled.store(false);
+  napi_value undefined, argv[2];
+  status = napi_get_undefined(env, &undefined);
+  FLOATING_STATUS;
+  status = napi_get_reference_value(env, s->view, &argv[0]);
+  FLOATING_STATUS;
+  status = napi_create_int32(env, SHARE_FIELD_SEQUENCE, &argv[1]);
+  FLOATING_STATUS;
+  status = napi_call_function(env, undefined, callback, 2, argv, nullptr);
+  FLOATING_STATUS;
+}
+
+void finalizeShare(napi_env env, void *data, void *hint)
+{
+  shareState *s = (shareState *)data;
+  if (s->locked)
+    unlockMemory(s->base, s->length);
+  napi_delete_reference(env, s->view);
+  releaseReceiver(s->instance);
+  delete s;
+}
+
+void haltShare(void *data)
+{
+  shareState *s = (shareState *)data;
+  s->instance->share = nullptr;
+  s->running.store(false);
+  if (s->thread.joinable())
+    s->thread.join();
+  // Readers take the frames already published, then see that capture is over
+  shareField(s->base, SHARE_FIELD_STATE)->store(1, std::memory_order_release);
+  napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+  napi_release_threadsafe_function(s->tsfn, napi_tsfn_release);
+}
+
+void stopReceiverSharing(napi_env env, receiverInstance *instance)
+{
+  shareState *s = instance->share;
+  if (s == nullptr)
+    return;
+  napi_status status;
+  status = napi_remove_env_cleanup_hook(env, haltShare, s);
+  FLOATING_STATUS;
+  haltShare(s);
+}
+
+// Create a SharedArrayBuffer of the given length, with an Int32Array over it
+napi_status makeSharedBuffer(napi_env env, size_t length, napi_value *buffer, napi_value *view,
+                             char **data)
+{
+  napi_status status;
+  napi_value global, constructor, param;
+  status = napi_get_global(env, &global);
+  PASS_STATUS;
+  status = napi_get_named_property(env, global, "SharedArrayBuffer", &constructor);
+  PASS_STATUS;
+  status = napi_create_double(env, (double)length, &param);
+  PASS_STATUS;
+  status = napi_new_instance(env, constructor, 1, &param, buffer);
+  PASS_STATUS;
+  status = napi_get_named_property(env, global, "Int32Array", &constructor);
+  PASS_STATUS;
+  status = napi_new_instance(env, constructor, 1, buffer, view);
+  PASS_STATUS;
+  napi_typedarray_type type;
+  size_t elements, offset;
+  return napi_get_typedarray_info(env, *view, &type, &elements, (void **)data, nullptr, &offset);
+}
+
+napi_status readShareOption(napi_env env, napi_value options, const char *name, uint32_t min,
+                            uint32_t max, uint32_t *result, bool *valid)
+{
+  napi_status status;
+  napi_valuetype type;
+  napi_value param;
+  *valid = true;
+  status = napi_get_named_property(env, options, name, &param);
+  PASS_STATUS;
+  status = napi_typeof(env, param, &type);
+  PASS_STATUS;
+  if (type == napi_undefined)
+    return napi_ok;
+  double value = 0;
+  if (type == napi_number)
+  {
+    status = napi_get_value_double(env, param, &value);
+    PASS_STATUS;
+  }
+  *valid = type == napi_number && value >= min && value <= max && value == (uint32_t)value;
+  *result = (uint32_t)value;
+  return napi_ok;
+}
+
+// Capture frames into a ring of slots in a SharedArrayBuffer, returned for
+// posting to worker threads, which read them in place with reader.js
+napi_value startSharing(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  uint32_t slots = 4, slotSize = SHARE_DEFAULT_SLOT_SIZE, readers = 1;
+  bool captureVideo = true, captureAudio = false, captureMetadata = false;
+  type = napi_undefined;
+  if (argc >= 1)
+  {
+    status = napi_typeof(env, args[0], &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Share options must be an object.");
+  }
+  if (type == napi_object)
+  {
+    bool valid;
+    status = readShareOption(env, args[0], "slots", 1, SHARE_MAX_SLOTS, &slots, &valid);
+    CHECK_STATUS;
+    if (!valid)
+      NAPI_THROW_ERROR("Slots must be a whole number between 1 and 64.");
+    status = readShareOption(env, args[0], "slotSize", 1, SHARE_MAX_SLOT_SIZE, &slotSize, &valid);
+    CHECK_STATUS;
+    if (!valid)
+      NAPI_THROW_ERROR("Slot size must be a whole number of bytes, up to 256MiB.");
+    status = readShareOption(env, args[0], "readers", 1, SHARE_MAX_READERS, &readers, &valid);
+    CHECK_STATUS;
+    if (!valid)
+      NAPI_THROW_ERROR("Readers must be a whole number between 1 and 1024.");
+
+    napi_value param;
+    status = napi_get_named_property(env, args[0], "types", &param);
+    CHECK_STATUS;
+    if (parseFrameTypes(env, param, &captureVideo, &captureAudio, &captureMetadata) != napi_ok ||
+        captureMetadata || !(captureVideo || captureAudio))
+      NAPI_THROW_ERROR("Share types must be an array containing 'video' or 'audio'.");
+  }
+
+  uint32_t slotStride = SHARE_SLOT_HEADER_SIZE +
+                        (slotSize + SHARE_SLOT_ALIGN - 1) / SHARE_SLOT_ALIGN * SHARE_SLOT_ALIGN;
+  size_t length = SHARE_HEADER_SIZE + (size_t)slots * slotStride;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  if (receiverBusy(instance, false))
+  {
+    releaseReceiver(instance);
+    NAPI_THROW_ERROR(GRANDIOSE_RECEIVER_BUSY);
+  }
+
+  napi_value buffer, view, global, atomics, notify, resourceName;
+  char *base;
+  status = makeSharedBuffer(env, length, &buffer, &view, &base);
+  if (status == napi_ok)
+    status = napi_get_global(env, &global);
+  if (status == napi_ok)
+    status = napi_get_named_property(env, global, "Atomics", &atomics);
+  if (status == napi_ok)
+    status = napi_get_named_property(env, atomics, "notify", &notify);
+  if (status == napi_ok)
+    status = napi_create_string_utf8(env, "ReceiveShare", NAPI_AUTO_LENGTH, &resourceName);
+  if (status != napi_ok)
+    releaseReceiver(instance);
+  CHECK_STATUS;
+
+  // The share owns the reference to the receiver taken by getReceiver
+  shareState *s = new shareState;
+  s->instance = instance;
+  s->base = base;
+  s->length = length;
+  s->slots = slots;
+  s->slotSize = slotSize;
+  s->slotStride = slotStride;
+  s->readers = (int32_t)readers;
+  s->captureVideo = captureVideo;
+  s->captureAudio = captureAudio;
+
+  status = napi_create_reference(env, view, 1, &s->view);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, notify, nullptr, resourceName, 0, 1,
+                                             s, finalizeShare, s, shareCallJs, &s->tsfn);
+  if (status != napi_ok)
+  {
+    if (s->view != nullptr)
+      napi_delete_reference(env, s->view);
+    releaseReceiver(instance);
+    delete s;
+  }
+  CHECK_STATUS;
+
+  int32_t *fields = (int32_t *)base;
+  fields[SHARE_FIELD_MAGIC] = SHARE_MAGIC;
+  fields[SHARE_FIELD_SLOTS] = (int32_t)slots;
+  fields[SHARE_FIELD_SLOT_SIZE] = (int32_t)slotSize;
+  fields[SHARE_FIELD_SLOT_STRIDE] = (int32_t)slotStride;
+  fields[SHARE_FIELD_READERS] = (int32_t)readers;
+  s->locked = lockMemory(base, length);
+
+  instance->share = s;
+  s->thread = std::thread(shareCapture, s);
+  status = napi_add_env_cleanup_hook(env, haltShare, s);
+  CHECK_STATUS;
+
+  napi_value result, param;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "buffer", buffer);
+  CHECK_STATUS;
+  status = napi_create_uint32(env, slots, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "slots", param);
+  CHECK_STATUS;
+  status = napi_create_uint32(env, slotSize, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "slotSize", param);
+  CHECK_STATUS;
+  status = napi_create_uint32(env, readers, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "readers", param);
+  CHECK_STATUS;
+  return result;
+}
+
+napi_value stopSharing(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  stopReceiverSharing(env, instance);
+  releaseReceiver(instance);
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,97 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_SHARE_H
+#define GRANDIOSE_SHARE_H
+
+#include <atomic>
+#include <thread>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+
+napi_value startSharing(napi_env env, napi_callback_info info);
+napi_value stopSharing(napi_env env, napi_callback_info info);
+
+// Layout of the SharedArrayBuffer that frames are captured into, as read by
+// reader.js. A header of Int32 fields is followed by a ring of slots, each
+// an Int32 header then the frame's data. All offsets are in bytes.
+#define SHARE_MAGIC 0x47524e44 // "GRND"
+#define SHARE_HEADER_SIZE 64
+#define SHARE_SLOT_HEADER_SIZE 128
+#define SHARE_SLOT_ALIGN 64
+
+// Int32 indexes into the ring header
+#define SHARE_FIELD_MAGIC 0
+#define SHARE_FIELD_SLOTS 1
+#define SHARE_FIELD_SLOT_SIZE 2 // Bytes of data a slot can hold
+#define SHARE_FIELD_SLOT_STRIDE 3 // Bytes from one slot to the next
+#define SHARE_FIELD_READERS 4
+#define SHARE_FIELD_SEQUENCE 5 // Frames published, which readers wait on
+#define SHARE_FIELD_STATE 6 // Non-zero once capture has stopped
+#define SHARE_FIELD_DROPPED 7 // Frames with no free slot, or too big for one
+
+// Int32 indexes into a slot header. Frame n is published in slot n % slots,
+// and only once every reader has released the frame before it in that slot.
+#define SLOT_FIELD_REFS 0 // Readers yet to release the frame
+#define SLOT_FIELD_SEQUENCE 1
+#define SLOT_FIELD_TYPE 2 // SLOT_TYPE_VIDEO or SLOT_TYPE_AUDIO
+#define SLOT_FIELD_SIZE 3 // Bytes of data
+#define SLOT_FIELD_TIMESTAMP 4 // Seconds then nanoseconds
+#define SLOT_FIELD_TIMECODE 6 // As for timestamp
+// Video
+#define SLOT_FIELD_XRES 8
+#define SLOT_FIELD_YRES 9
+#define SLOT_FIELD_FOURCC 10
+#define SLOT_FIELD_LINE_STRIDE 11
+#define SLOT_FIELD_FRAME_RATE_N 12
+#define SLOT_FIELD_FRAME_RATE_D 13
+#define SLOT_FIELD_FRAME_FORMAT_TYPE 14
+#define SLOT_FIELD_PICTURE_ASPECT_RATIO 15 // Float32
+#define SLOT_FIELD_OUTPUT_FORMAT 16
+// Audio, always planar 32-bit float
+#define SLOT_FIELD_SAMPLE_RATE 8
+#define SLOT_FIELD_CHANNELS 9
+#define SLOT_FIELD_SAMPLES 10
+#define SLOT_FIELD_CHANNEL_STRIDE 11
+
+#define SLOT_TYPE_VIDEO 1
+#define SLOT_TYPE_AUDIO 2
+
+// A capture thread writes frames straight into the slots of a shared ring,
+// for worker threads to read in place. Readers are woken by Atomics.notify,
+// called through the threadsafe function on the JS thread.
+struct shareState {
+  receiverInstance* instance = nullptr;
+  napi_threadsafe_function tsfn = nullptr; // Calls Atomics.notify
+  napi_ref view = nullptr; // Int32Array over the ring, keeping it alive
+  char* base = nullptr;
+  size_t length = 0;
+  bool locked = false; // In memory, by configure({ lockMemory })
+  uint32_t slots = 0;
+  uint32_t slotSize = 0;
+  uint32_t slotStride = 0;
+  int32_t readers = 1;
+  bool captureVideo = true;
+  bool captureAudio = false;
+  std::thread thread;
+  std::atomic<bool> running{true};
+  std::atomic<bool> signalled{false};
+  uint32_t sequence = 0; // Next frame to publish, capture thread only
+};
+
+void stopReceiverSharing(napi_env env, receiverInstance* instance);
+
+#endif /* GRANDIOSE_SHARE_H */
@@ -0,0 +1,66 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_SIMD_H
+#define GRANDIOSE_SIMD_H
+
+// Instruction set support shared by the conversion kernels. On x86, kernels
+// for each instruction set are compiled into the same binary with target
+// attributes and picked at runtime. ARM64 always has NEON.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GRANDIOSE_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows any intrinsic in any function
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GRANDIOSE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef GRANDIOSE_SIMD_X86
+inline void detectX86(bool *sse41, bool *avx2)
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+  __cpuid(info, 1);
+  *sse41 = (info[2] & (1 << 19)) != 0;
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  *avx2 = false;
+  // AVX registers are only usable if the OS saves them on context switches
+  if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+  {
+    __cpuidex(info, 7, 0);
+    *avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  *sse41 = __builtin_cpu_supports("sse4.1");
+  *avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+#endif /* GRANDIOSE_SIMD_X86 */
+
+#endif /* GRANDIOSE_SIMD_H */
@@ -0,0 +1,363 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <vector>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_stats.h"
+#include "grandiose_receive.h"
+#include "grandiose_stream.h"
+#include "grandiose_send.h"
+#include "grandiose_util.h"
+
+uint32_t latencyHistogram::bucketFor(uint64_t micros)
+{
+  if (micros < 2 * HISTOGRAM_SUB_BUCKETS)
+    return (uint32_t)micros;
+  uint32_t shift = 1;
+  while ((micros >> shift) >= 2 * HISTOGRAM_SUB_BUCKETS)
+    shift++;
+  if (shift > HISTOGRAM_MAX_SHIFT)
+    return HISTOGRAM_BUCKETS - 1;
+  return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (uint32_t)((micros >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+uint64_t latencyHistogram::highestEquivalent(uint32_t bucket)
+{
+  if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+  uint32_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+  return ((HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void latencyHistogram::record(uint64_t micros)
+{
+  buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+  total.fetch_add(1, std::memory_order_relaxed);
+  totalMicros.fetch_add(micros, std::memory_order_relaxed);
+  uint64_t seen = highest.load(std::memory_order_relaxed);
+  while (micros > seen &&
+         !highest.compare_exchange_weak(seen, micros, std::memory_order_relaxed))
+    ;
+}
+
+uint64_t latencyHistogram::snapshot(uint64_t *counts)
+{
+  uint64_t sum = 0;
+  for (uint32_t x = 0; x < HISTOGRAM_BUCKETS; x++)
+  {
+    counts[x] = buckets[x].load(std::memory_order_relaxed);
+    sum += counts[x];
+  }
+  return sum;
+}
+
+uint64_t latencyHistogram::percentile(const uint64_t *counts, uint64_t count, double percent)
+{
+  if (count == 0)
+    return 0;
+  uint64_t target = (uint64_t)((percent / 100.0) * (double)count + 0.5);
+  if (target < 1)
+    target = 1;
+  uint64_t seen = 0;
+  for (uint32_t x = 0; x < HISTOGRAM_BUCKETS; x++)
+  {
+    seen += counts[x];
+    if (seen >= target)
+      return highestEquivalent(x);
+  }
+  return highestEquivalent(HISTOGRAM_BUCKETS - 1);
+}
+
+void captureStats::addDelivery(int64_t timestamp)
+{
+  if (timestamp == NDIlib_recv_timestamp_undefined || timestamp <= 0)
+    return;
+  // NDI timestamps count 100ns intervals since the Unix epoch
+  int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+  int64_t micros = now - timestamp / 10;
+  if (micros >= 0) // Otherwise the sender's clock is ahead
+    delivery.record((uint64_t)micros);
+}
+
+napi_status setNamedCount(napi_env env, napi_value object, const char *name, uint64_t value)
+{
+  napi_status status;
+  napi_value param;
+  status = napi_create_double(env, (double)value, &param);
+  PASS_STATUS;
+  return napi_set_named_property(env, object, name, param);
+}
+
+napi_status makeFrameCounts(napi_env env, int64_t video, int64_t audio, int64_t metadata,
+                            napi_value *result)
+{
+  napi_status status;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  status = setNamedCount(env, *result, "video", (uint64_t)video);
+  PASS_STATUS;
+  status = setNamedCount(env, *result, "audio", (uint64_t)audio);
+  PASS_STATUS;
+  return setNamedCount(env, *result, "metadata", (uint64_t)metadata);
+}
+
+// Snapshot of the SDK's frame counts and queue depths for a receiver, with
+// the counters kept by grandiose for its captures
+napi_value receiverStats(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+
+  NDIlib_recv_performance_t total, dropped;
+  NDIlib_recv_queue_t queue;
+  NDIlib_recv_get_performance(instance->recv, &total, &dropped);
+  NDIlib_recv_get_queue(instance->recv, &queue);
+  captureStats &stats = instance->stats;
+  uint64_t counts[5] = {
+    stats.capture.count(),
+    stats.timeouts.load(std::memory_order_relaxed),
+    stats.copyBytes.load(std::memory_order_relaxed),
+    stats.conversion.count(),
+    stats.conversion.sum()};
+  uint64_t streamDropped = (instance->stream != nullptr) ?
+    instance->stream->dropped.load(std::memory_order_relaxed) : 0;
+  releaseReceiver(instance);
+
+  napi_value result, param;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+
+  status = makeFrameCounts(env, total.video_frames, total.audio_frames,
+                           total.metadata_frames, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "total", param);
+  CHECK_STATUS;
+  status = makeFrameCounts(env, dropped.video_frames, dropped.audio_frames,
+                           dropped.metadata_frames, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "dropped", param);
+  CHECK_STATUS;
+  status = makeFrameCounts(env, queue.video_frames, queue.audio_frames,
+                           queue.metadata_frames, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "queue", param);
+  CHECK_STATUS;
+
+  const char *names[5] = {"captures", "timeouts", "copyBytes", "conversions", "conversionMicros"};
+  for (int x = 0; x < 5; x++)
+  {
+    status = setNamedCount(env, result, names[x], counts[x]);
+    CHECK_STATUS;
+  }
+  status = setNamedCount(env, result, "streamDropped", streamDropped);
+  CHECK_STATUS;
+
+  return result;
+}
+
+// Read an optional array of extra percentiles to report, from 0 to 100
+napi_status readPercentiles(napi_env env, size_t argc, napi_value *args,
+                            std::vector<double> *percentiles, bool *valid)
+{
+  napi_status status;
+  napi_valuetype type;
+  *valid = true;
+  if (argc < 1)
+    return napi_ok;
+  status = napi_typeof(env, args[0], &type);
+  PASS_STATUS;
+  if (type == napi_undefined)
+    return napi_ok;
+  bool isArray;
+  status = napi_is_array(env, args[0], &isArray);
+  PASS_STATUS;
+  if (!isArray)
+  {
+    *valid = false;
+    return napi_ok;
+  }
+  uint32_t length;
+  status = napi_get_array_length(env, args[0], &length);
+  PASS_STATUS;
+  for (uint32_t x = 0; x < length; x++)
+  {
+    napi_value element;
+    double percent;
+    status = napi_get_element(env, args[0], x, &element);
+    PASS_STATUS;
+    status = napi_typeof(env, element, &type);
+    PASS_STATUS;
+    if (type != napi_number)
+    {
+      *valid = false;
+      return napi_ok;
+    }
+    status = napi_get_value_double(env, element, &percent);
+    PASS_STATUS;
+    if (!(percent >= 0.0 && percent <= 100.0))
+    {
+      *valid = false;
+      return napi_ok;
+    }
+    percentiles->push_back(percent);
+  }
+  return napi_ok;
+}
+
+// Summary of a histogram in microseconds, with standard percentiles and any
+// extra ones asked for
+napi_status makeLatencySummary(napi_env env, latencyHistogram *histogram,
+                               const std::vector<double> &extra, napi_value *result)
+{
+  napi_status status;
+  std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+  uint64_t count = histogram->snapshot(counts.data());
+  uint64_t max = histogram->max();
+  uint64_t sum = histogram->sum();
+
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  status = setNamedCount(env, *result, "count", count);
+  PASS_STATUS;
+  napi_value param;
+  status = napi_create_double(env, (count > 0) ? (double)sum / (double)count : 0.0, &param);
+  PASS_STATUS;
+  status = napi_set_named_property(env, *result, "mean", param);
+  PASS_STATUS;
+  status = setNamedCount(env, *result, "max", max);
+  PASS_STATUS;
+
+  const char *names[4] = {"p50", "p90", "p99", "p999"};
+  const double standard[4] = {50.0, 90.0, 99.0, 99.9};
+  for (int x = 0; x < 4; x++)
+  {
+    uint64_t value = latencyHistogram::percentile(counts.data(), count, standard[x]);
+    status = setNamedCount(env, *result, names[x], (value < max) ? value : max);
+    PASS_STATUS;
+  }
+
+  if (extra.empty())
+    return napi_ok;
+  status = napi_create_array_with_length(env, extra.size(), &param);
+  PASS_STATUS;
+  for (uint32_t x = 0; x < extra.size(); x++)
+  {
+    uint64_t value = latencyHistogram::percentile(counts.data(), count, extra[x]);
+    napi_value element;
+    status = napi_create_double(env, (double)((value < max) ? value : max), &element);
+    PASS_STATUS;
+    status = napi_set_element(env, param, x, element);
+    PASS_STATUS;
+  }
+  return napi_set_named_property(env, *result, "percentiles", param);
+}
+
+napi_status makeLatencyReport(napi_env env, latencyHistogram **histograms, const char **names,
+                              int stages, const std::vector<double> &extra, napi_value *result)
+{
+  napi_status status;
+  status = napi_create_object(env, result);
+  PASS_STATUS;
+  for (int x = 0; x < stages; x++)
+  {
+    napi_value summary;
+    status = makeLatencySummary(env, histograms[x], extra, &summary);
+    PASS_STATUS;
+    status = napi_set_named_property(env, *result, names[x], summary);
+    PASS_STATUS;
+  }
+  return napi_ok;
+}
+
+// Latency percentiles for each stage of a receiver's captures
+napi_value receiverLatency(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  std::vector<double> percentiles;
+  bool valid;
+  status = readPercentiles(env, argc, args, &percentiles, &valid);
+  CHECK_STATUS;
+  if (!valid)
+    NAPI_THROW_ERROR("Percentiles must be an array of numbers from 0 to 100.");
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+
+  captureStats &stats = instance->stats;
+  latencyHistogram *histograms[5] = {
+    &stats.capture, &stats.queue, &stats.conversion, &stats.complete, &stats.delivery};
+  const char *names[5] = {"capture", "queue", "conversion", "complete", "delivery"};
+  napi_value result;
+  status = makeLatencyReport(env, histograms, names, 5, percentiles, &result);
+  releaseReceiver(instance);
+  CHECK_STATUS;
+  return result;
+}
+
+// Latency percentiles for a sender's queueing and sends
+napi_value senderLatency(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  std::vector<double> percentiles;
+  bool valid;
+  status = readPercentiles(env, argc, args, &percentiles, &valid);
+  CHECK_STATUS;
+  if (!valid)
+    NAPI_THROW_ERROR("Percentiles must be an array of numbers from 0 to 100.");
+
+  senderInstance *instance;
+  status = getSender(env, thisValue, &instance);
+  CHECK_STATUS;
+
+  latencyHistogram *histograms[2] = {&instance->stats.queue, &instance->stats.send};
+  const char *names[2] = {"queue", "send"};
+  napi_value result;
+  status = makeLatencyReport(env, histograms, names, 2, percentiles, &result);
+  releaseSender(instance);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,96 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_STATS_H
+#define GRANDIOSE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "node_api.h"
+#include "grandiose_util.h"
+
+napi_value receiverStats(napi_env env, napi_callback_info info);
+napi_value receiverLatency(napi_env env, napi_callback_info info);
+napi_value senderLatency(napi_env env, napi_callback_info info);
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_SHIFT 32 // Values up to 2^37us, well over a day
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_SHIFT + 2) * HISTOGRAM_SUB_BUCKETS)
+
+// Durations in microseconds, bucketed in the style of HdrHistogram. Values
+// under 32us have a bucket each, then every power of two range is split into
+// 16 linear buckets, so any value is known to within 1/16th. Recording is
+// wait free from any thread. Reads are relaxed, so percentiles taken while
+// recording continues may be out by the odd value.
+class latencyHistogram {
+public:
+  void record(uint64_t micros);
+  void recordSince(HR_TIME_POINT start) {
+    long long micros = microTime(start);
+    record((micros > 0) ? (uint64_t)micros : 0);
+  }
+  // Copy the bucket counts, returning the number of values they hold
+  uint64_t snapshot(uint64_t* buckets);
+  uint64_t count() { return total.load(std::memory_order_relaxed); }
+  uint64_t sum() { return totalMicros.load(std::memory_order_relaxed); }
+  uint64_t max() { return highest.load(std::memory_order_relaxed); }
+
+  static uint32_t bucketFor(uint64_t micros);
+  // Highest value that lands in the same bucket
+  static uint64_t highestEquivalent(uint32_t bucket);
+  // Value at or below which the given percentage of a snapshot falls
+  static uint64_t percentile(const uint64_t* buckets, uint64_t count, double percent);
+
+private:
+  std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS] = {};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> totalMicros{0};
+  std::atomic<uint64_t> highest{0};
+};
+
+// Counters kept by grandiose for one receiver, updated by whichever thread
+// captures and read by receiver.stats() and receiver.latency(). Counts are
+// relaxed, so a snapshot is not consistent between counters.
+struct captureStats {
+  std::atomic<uint64_t> timeouts{0}; // Captures that waited and got nothing
+  std::atomic<uint64_t> copyBytes{0}; // Copied out of SDK frames into JS
+  // Time blocked in captures that returned a frame
+  latencyHistogram capture;
+  // Time async captures waited for a thread pool thread
+  latencyHistogram queue;
+  latencyHistogram conversion;
+  // Time making the JS value for a frame, on the JS thread
+  latencyHistogram complete;
+  // From the sender's timestamp to the frame being made for JS, which is
+  // only meaningful when sender and receiver clocks are synchronized
+  latencyHistogram delivery;
+
+  void addCopy(size_t bytes) {
+    copyBytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  void addDelivery(int64_t timestamp);
+};
+
+// Timings of a sender's hot path
+struct sendStats {
+  // Time frames waited for a thread pool thread or in the submit queue
+  latencyHistogram queue;
+  // Time in SDK send calls, including any wait for clocking
+  latencyHistogram send;
+};
+
+#endif /* GRANDIOSE_STATS_H */
@@ -0,0 +1,403 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_stream.h"
+#include "grandiose_receive.h"
+#include "grandiose_pool.h"
+#include "grandiose_util.h"
+
+// Time to block in each capture, bounding how long stopping a stream takes
+#define STREAM_CAPTURE_WAIT 100
+#define STREAM_MAX_DEPTH 1024
+
+bool frameRing::push(const capturedFrame &frame, Grandiose_drop_policy_e policy, capturedFrame *evicted)
+{
+  uint64_t h = head.load(std::memory_order_relaxed);
+  uint64_t t = tail.load(std::memory_order_acquire);
+  evicted->type = NDIlib_frame_type_none;
+  while (h - t >= depth)
+  {
+    if (policy == Grandiose_drop_newest)
+      return false;
+    *evicted = slots[t % depth];
+    if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      break;
+    // The consumer took this entry first, so there may be room now
+    evicted->type = NDIlib_frame_type_none;
+  }
+  slots[h % depth] = frame;
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool frameRing::pop(capturedFrame *frame)
+{
+  uint64_t t = tail.load(std::memory_order_acquire);
+  while (t != head.load(std::memory_order_acquire))
+  {
+    *frame = slots[t % depth];
+    if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      return true;
+  }
+  return false;
+}
+
+void releaseCapturedFrame(receiverInstance *instance, capturedFrame *frame)
+{
+  switch (frame->type)
+  {
+  case NDIlib_frame_type_video:
+    if (frame->videoData.data != nullptr)
+      releaseVideoOutput(instance, &frame->videoData);
+    else
+      NDIlib_recv_free_video_v2(instance->recv, &frame->video);
+    break;
+  case NDIlib_frame_type_audio:
+    NDIlib_recv_free_audio_v2(instance->recv, &frame->audio);
+    releaseAudioOutput(instance, &frame->audioData);
+    break;
+  case NDIlib_frame_type_metadata:
+    NDIlib_recv_free_metadata(instance->recv, &frame->metadata);
+    break;
+  default:
+    break;
+  }
+  frame->type = NDIlib_frame_type_none;
+}
+
+void streamCapture(streamState *s)
+{
+  prepareMediaThread();
+  bool lost = false;
+  while (s->running.load(std::memory_order_relaxed))
+  {
+    capturedFrame frame;
+    frame.type = captureFrame(s->instance,
+                              s->captureVideo ? &frame.video : nullptr,
+                              s->captureAudio ? &frame.audio : nullptr,
+                              s->captureMetadata ? &frame.metadata : nullptr,
+                              STREAM_CAPTURE_WAIT);
+    switch (frame.type)
+    {
+    case NDIlib_frame_type_video:
+      convertVideo(s->instance, &frame.video, &frame.videoData);
+      break;
+    case NDIlib_frame_type_audio:
+      convertAudio(s->instance, &frame.audio, s->audioFormat, s->referenceLevel, &frame.audioData);
+      break;
+    case NDIlib_frame_type_error:
+      // Only report the transition, rather than every failed capture
+      if (lost)
+        continue;
+      break;
+    case NDIlib_frame_type_metadata:
+    case NDIlib_frame_type_status_change:
+      break;
+    default:
+      continue;
+    }
+    lost = (frame.type == NDIlib_frame_type_error);
+
+    capturedFrame evicted;
+    if (!s->ring.push(frame, s->dropPolicy, &evicted))
+    {
+      releaseCapturedFrame(s->instance, &frame);
+      s->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (evicted.type != NDIlib_frame_type_none)
+    {
+      releaseCapturedFrame(s->instance, &evicted);
+      s->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The ring is the queue - the threadsafe function is only a wake up call
+    if (!s->signalled.exchange(true))
+      napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+  }
+}
+
+napi_status makeStreamValue(napi_env env, streamState *s, capturedFrame *frame,
+                            napi_value *error, napi_value *result)
+{
+  napi_status status;
+  napi_value param;
+  switch (frame->type)
+  {
+  case NDIlib_frame_type_video:
+    return makeVideoFrame(env, s->instance, &frame->video, &frame->videoData, result);
+  case NDIlib_frame_type_audio:
+    status = makeAudioFrame(env, s->instance, &frame->audio, s->audioFormat,
+                            s->referenceLevel, &frame->audioData, result);
+    releaseAudioOutput(s->instance, &frame->audioData);
+    return status;
+  case NDIlib_frame_type_metadata:
+    return makeMetadataFrame(env, s->instance, &frame->metadata, result);
+  case NDIlib_frame_type_error:
+    return makeError(env, GRANDIOSE_CONNECTION_LOST,
+                     "Received error response from NDI stream capture. Connection lost.", error);
+  case NDIlib_frame_type_status_change:
+  default:
+    status = napi_create_object(env, result);
+    PASS_STATUS;
+    status = napi_create_string_utf8(env, "statusChange", NAPI_AUTO_LENGTH, &param);
+    PASS_STATUS;
+    return napi_set_named_property(env, *result, "type", param);
+  }
+}
+
+void streamCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  streamState *s = (streamState *)context;
+  if (env == nullptr)
+    return; // Tearing down - queued frames are released by finalizeStream
+
+  napi_status status;
+  napi_value undefined;
+  status = napi_get_undefined(env, &undefined);
+  FLOATING_STATUS;
+
+  s->signalled.store(false);
+  capturedFrame frame;
+  // The callback may stop the stream, so check between frames
+  while (s->running.load() && s->ring.pop(&frame))
+  {
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+    FLOATING_STATUS;
+
+    napi_value argv[2] = {undefined, undefined};
+    status = makeStreamValue(env, s, &frame, &argv[0], &argv[1]);
+    if (status == napi_ok)
+      status = napi_call_function(env, undefined, callback, 2, argv, nullptr);
+    napi_close_handle_scope(env, scope);
+
+    if (status != napi_ok)
+    {
+      // Most likely the callback threw - deliver the rest on the next turn
+      if (!s->signalled.exchange(true))
+        napi_call_threadsafe_function(s->tsfn, nullptr, napi_tsfn_nonblocking);
+      return;
+    }
+  }
+}
+
+void finalizeStream(napi_env env, void *data, void *hint)
+{
+  streamState *s = (streamState *)data;
+  capturedFrame frame;
+  while (s->ring.pop(&frame))
+    releaseCapturedFrame(s->instance, &frame);
+  releaseReceiver(s->instance);
+  delete s;
+}
+
+void haltStream(void *data)
+{
+  streamState *s = (streamState *)data;
+  s->instance->stream = nullptr;
+  s->running.store(false);
+  if (s->thread.joinable())
+    s->thread.join();
+  napi_release_threadsafe_function(s->tsfn, napi_tsfn_abort);
+}
+
+void stopReceiverStream(napi_env env, receiverInstance *instance)
+{
+  streamState *s = instance->stream;
+  if (s == nullptr)
+    return;
+  napi_status status;
+  status = napi_remove_env_cleanup_hook(env, haltStream, s);
+  FLOATING_STATUS;
+  haltStream(s);
+}
+
+napi_value startStream(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 2;
+  napi_value args[2];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 1)
+    NAPI_THROW_ERROR("A callback function must be provided to start streaming.");
+  napi_value options = (argc >= 2) ? args[0] : nullptr;
+  napi_value callback = (argc >= 2) ? args[1] : args[0];
+  status = napi_typeof(env, callback, &type);
+  CHECK_STATUS;
+  if (type != napi_function)
+    NAPI_THROW_ERROR("Last argument to startStream must be a callback function.");
+
+  uint32_t depth = 4;
+  Grandiose_drop_policy_e dropPolicy = Grandiose_drop_oldest;
+  bool captureVideo = true, captureAudio = true, captureMetadata = true;
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+
+  if (options != nullptr)
+  {
+    status = napi_typeof(env, options, &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Stream options must be an object.");
+  }
+  if (options != nullptr && type == napi_object)
+  {
+    napi_value param;
+    status = napi_get_named_property(env, options, "depth", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Stream depth must be a number.");
+      status = napi_get_value_uint32(env, param, &depth);
+      CHECK_STATUS;
+      if (depth < 1 || depth > STREAM_MAX_DEPTH)
+        NAPI_THROW_ERROR("Stream depth must be between 1 and 1024.");
+    }
+
+    status = napi_get_named_property(env, options, "dropPolicy", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      char policy[10];
+      size_t policyl = 0;
+      if (type == napi_string)
+      {
+        status = napi_get_value_string_utf8(env, param, policy, sizeof(policy), &policyl);
+        CHECK_STATUS;
+      }
+      if (type == napi_string && strcmp(policy, "oldest") == 0)
+        dropPolicy = Grandiose_drop_oldest;
+      else if (type == napi_string && strcmp(policy, "newest") == 0)
+        dropPolicy = Grandiose_drop_newest;
+      else
+        NAPI_THROW_ERROR("Stream drop policy must be one of 'oldest' or 'newest'.");
+    }
+
+    status = napi_get_named_property(env, options, "types", &param);
+    CHECK_STATUS;
+    if (parseFrameTypes(env, param, &captureVideo, &captureAudio, &captureMetadata) != napi_ok)
+      NAPI_THROW_ERROR("Stream types must be an array containing 'video', 'audio' or 'metadata'.");
+
+    status = napi_get_named_property(env, options, "audioFormat", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      uint32_t audioFormatN;
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio format value must be a number if present.");
+      status = napi_get_value_uint32(env, param, &audioFormatN);
+      CHECK_STATUS;
+      if (!validAudioFormat((Grandiose_audio_format_e)audioFormatN))
+        NAPI_THROW_ERROR("Invalid audio format specified.");
+      audioFormat = (Grandiose_audio_format_e)audioFormatN;
+    }
+
+    status = napi_get_named_property(env, options, "referenceLevel", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Audio reference level must be a number if present.");
+      status = napi_get_value_int32(env, param, &referenceLevel);
+      CHECK_STATUS;
+    }
+  }
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  if (receiverBusy(instance, false))
+  {
+    releaseReceiver(instance);
+    NAPI_THROW_ERROR(GRANDIOSE_RECEIVER_BUSY);
+  }
+
+  // The stream owns the reference to the receiver taken by getReceiver
+  streamState *s = new streamState(depth);
+  s->instance = instance;
+  s->dropPolicy = dropPolicy;
+  s->captureVideo = captureVideo;
+  s->captureAudio = captureAudio;
+  s->captureMetadata = captureMetadata;
+  s->audioFormat = audioFormat;
+  s->referenceLevel = referenceLevel;
+
+  napi_value resourceName;
+  status = napi_create_string_utf8(env, "ReceiveStream", NAPI_AUTO_LENGTH, &resourceName);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, callback, nullptr, resourceName, 0, 1,
+                                             s, finalizeStream, s, streamCallJs, &s->tsfn);
+  if (status != napi_ok)
+  {
+    releaseReceiver(instance);
+    delete s;
+  }
+  CHECK_STATUS;
+
+  instance->stream = s;
+  s->thread = std::thread(streamCapture, s);
+  status = napi_add_env_cleanup_hook(env, haltStream, s);
+  CHECK_STATUS;
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
+
+napi_value stopStream(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  stopReceiverStream(env, instance);
+  releaseReceiver(instance);
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,88 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_STREAM_H
+#define GRANDIOSE_STREAM_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+
+napi_value startStream(napi_env env, napi_callback_info info);
+napi_value stopStream(napi_env env, napi_callback_info info);
+
+// A frame captured by a native thread, waiting to be converted to a JS value
+struct capturedFrame {
+  NDIlib_frame_type_e type = NDIlib_frame_type_none;
+  NDIlib_video_frame_v2_t video;
+  NDIlib_audio_frame_v2_t audio;
+  NDIlib_metadata_frame_t metadata;
+  videoOutput videoData; // Converted picture, if any
+  audioOutput audioData; // Converted audio samples
+};
+
+void releaseCapturedFrame(receiverInstance* instance, capturedFrame* frame);
+
+typedef enum Grandiose_drop_policy_e {
+  // Discard the oldest queued frame to make room for a new one
+  Grandiose_drop_oldest = 0,
+  // Discard newly captured frames until the consumer catches up
+  Grandiose_drop_newest = 1
+} Grandiose_drop_policy_e;
+
+// Bounded lock-free ring between one capture thread and the JS thread. The
+// consumer, and the producer when dropping the oldest frame, claim the entry
+// at the tail by copying it out and then advancing the tail with a CAS. A
+// claimant that loses the CAS discards its copy without touching the frame.
+class frameRing {
+public:
+  explicit frameRing(uint32_t depth) : slots(depth), depth(depth) {}
+
+  // Returns false if the frame could not be queued and is still owned by the
+  // caller. When the oldest entry is evicted to make room, it is returned
+  // in evicted for the caller to release.
+  bool push(const capturedFrame& frame, Grandiose_drop_policy_e policy, capturedFrame* evicted);
+  bool pop(capturedFrame* frame);
+
+private:
+  std::vector<capturedFrame> slots;
+  uint32_t depth;
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+};
+
+struct streamState {
+  receiverInstance* instance = nullptr;
+  napi_threadsafe_function tsfn = nullptr;
+  std::thread thread;
+  frameRing ring;
+  Grandiose_drop_policy_e dropPolicy = Grandiose_drop_oldest;
+  bool captureVideo = true;
+  bool captureAudio = true;
+  bool captureMetadata = true;
+  Grandiose_audio_format_e audioFormat = Grandiose_audio_format_float_32_separate;
+  int32_t referenceLevel = 20;
+  std::atomic<bool> running{true};
+  std::atomic<bool> signalled{false};
+  std::atomic<uint64_t> dropped{0};
+  explicit streamState(uint32_t depth) : ring(depth) {}
+};
+
+void stopReceiverStream(napi_env env, receiverInstance* instance);
+
+#endif /* GRANDIOSE_STREAM_H */
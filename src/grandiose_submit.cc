@@ -0,0 +1,389 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_submit.h"
+#include "grandiose_send.h"
+#include "grandiose_pool.h"
+#include "grandiose_util.h"
+
+submitQueue::submitQueue(uint32_t depth) : slots(new slot[depth]), depth(depth)
+{
+  for (uint32_t x = 0; x < depth; x++)
+    slots[x].sequence.store(x, std::memory_order_relaxed);
+}
+
+bool submitQueue::push(const submittedFrame &frame)
+{
+  uint64_t pos = head.load(std::memory_order_relaxed);
+  while (true)
+  {
+    slot &s = slots[pos % depth];
+    uint64_t sequence = s.sequence.load(std::memory_order_acquire);
+    int64_t diff = (int64_t)sequence - (int64_t)pos;
+    if (diff == 0)
+    {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        s.frame = frame;
+        s.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    }
+    else if (diff < 0)
+      return false; // Still holds a frame from the previous lap
+    else
+      pos = head.load(std::memory_order_relaxed);
+  }
+}
+
+bool submitQueue::pop(submittedFrame *frame)
+{
+  slot &s = slots[tail % depth];
+  if (s.sequence.load(std::memory_order_acquire) != tail + 1)
+    return false;
+  *frame = s.frame;
+  s.sequence.store(tail + depth, std::memory_order_release);
+  tail++;
+  return true;
+}
+
+bool submitQueue::hasRoom()
+{
+  uint64_t pos = head.load(std::memory_order_relaxed);
+  return slots[pos % depth].sequence.load(std::memory_order_acquire) == pos;
+}
+
+bool submitQueue::peek()
+{
+  return slots[tail % depth].sequence.load(std::memory_order_acquire) == tail + 1;
+}
+
+void senderLoop(senderThread *t)
+{
+  prepareMediaThread();
+  senderInstance *instance = t->instance;
+  while (t->running.load())
+  {
+    submittedFrame frame;
+    if (!t->queue.pop(&frame))
+    {
+      std::unique_lock<std::mutex> lock(t->wakeLock);
+      t->sleeping.store(true);
+      // Producers check sleeping after pushing, so recheck the queue first
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      t->wake.wait(lock, [t] { return !t->running.load() || t->queue.peek(); });
+      t->sleeping.store(false);
+      continue;
+    }
+
+    submittedFrame released;
+    HR_TIME_POINT start = NOW;
+    instance->stats.queue.recordSince(frame.submitted);
+    if (instance->async)
+    {
+      // The previous frame is let go as this one is scheduled
+      NDIlib_send_send_video_async_v2(instance->send, &frame.video);
+      released = t->scheduled;
+      t->scheduled = frame;
+    }
+    else
+    {
+      NDIlib_send_send_video_v2(instance->send, &frame.video);
+      released = frame;
+    }
+    instance->stats.send.recordSince(start);
+
+    if (released.buffer != nullptr || released.block != nullptr)
+    {
+      std::lock_guard<std::mutex> lock(t->doneLock);
+      t->done.push_back(released);
+    }
+    t->sent.fetch_add(1);
+    if (!t->signalled.exchange(true))
+      napi_call_threadsafe_function(t->tsfn, nullptr, napi_tsfn_nonblocking);
+  }
+}
+
+void releaseSubmittedFrame(napi_env env, senderThread *t, submittedFrame *frame)
+{
+  if (frame->buffer != nullptr)
+    napi_delete_reference(env, frame->buffer);
+  if (frame->block != nullptr)
+    t->instance->frames.release(frame->block);
+  frame->buffer = nullptr;
+  frame->block = nullptr;
+}
+
+// Release the Buffers and blocks of frames the SDK has finished with
+void drainSubmitted(napi_env env, senderThread *t)
+{
+  std::vector<submittedFrame> done;
+  {
+    std::lock_guard<std::mutex> lock(t->doneLock);
+    done.swap(t->done);
+  }
+  for (submittedFrame &frame : done)
+    releaseSubmittedFrame(env, t, &frame);
+}
+
+void submitCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  senderThread *t = (senderThread *)context;
+  if (env == nullptr || t->instance == nullptr)
+    return; // Halted - frames were released by haltSenderThread
+  t->signalled.store(false);
+  drainSubmitted(env, t);
+  // Let the process exit once nothing is waiting to be sent
+  if (t->sent.load() == t->submitted)
+    napi_unref_threadsafe_function(env, t->tsfn);
+}
+
+void finalizeSenderThread(napi_env env, void *data, void *hint)
+{
+  delete (senderThread *)data;
+}
+
+void haltSenderThread(void *data)
+{
+  senderThread *t = (senderThread *)data;
+  senderInstance *instance = t->instance;
+  napi_env env = instance->env;
+  instance->thread = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(t->wakeLock);
+    t->running.store(false);
+  }
+  t->wake.notify_one();
+  if (t->thread.joinable())
+    t->thread.join();
+
+  // Flush any asynchronous frame before letting go of everything held
+  if (t->scheduled.buffer != nullptr || t->scheduled.block != nullptr)
+  {
+    NDIlib_send_send_video_async_v2(instance->send, nullptr);
+    releaseSubmittedFrame(env, t, &t->scheduled);
+  }
+  submittedFrame frame;
+  while (t->queue.pop(&frame))
+    releaseSubmittedFrame(env, t, &frame);
+  drainSubmitted(env, t);
+
+  t->instance = nullptr;
+  napi_release_threadsafe_function(t->tsfn, napi_tsfn_abort);
+}
+
+napi_status startSenderThread(napi_env env, senderInstance *instance, uint32_t depth)
+{
+  napi_status status;
+  senderThread *t = new senderThread(depth);
+  t->instance = instance;
+
+  napi_value resourceName;
+  status = napi_create_string_utf8(env, "SendThread", NAPI_AUTO_LENGTH, &resourceName);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, nullptr, nullptr, resourceName, 0, 1,
+                                             t, finalizeSenderThread, t, submitCallJs, &t->tsfn);
+  if (status != napi_ok)
+  {
+    delete t;
+    return status;
+  }
+  // Only keeps the process alive while frames are waiting to be sent
+  status = napi_unref_threadsafe_function(env, t->tsfn);
+  PASS_STATUS;
+
+  instance->thread = t;
+  t->thread = std::thread(senderLoop, t);
+  return napi_add_env_cleanup_hook(env, haltSenderThread, t);
+}
+
+void stopSenderThread(napi_env env, senderInstance *instance)
+{
+  senderThread *t = instance->thread;
+  if (t == nullptr)
+    return;
+  napi_status status;
+  status = napi_remove_env_cleanup_hook(env, haltSenderThread, t);
+  FLOATING_STATUS;
+  haltSenderThread(t);
+}
+
+// Read and check the properties of a video frame object needed to send it,
+// throwing and returning false if any are missing or out of range.
+bool readSubmitFormat(napi_env env, napi_value config, NDIlib_video_frame_v2_t *video,
+                      size_t *size)
+{
+  napi_status status;
+  napi_valuetype type;
+  const char *names[7] = {"xres", "yres", "frameRateN", "frameRateD",
+                          "frameFormatType", "lineStrideBytes", "fourCC"};
+  int32_t values[7];
+  double pictureAspectRatio = 0.0;
+  napi_value param;
+
+  for (int x = 0; x < 7; x++)
+  {
+    status = napi_get_named_property(env, config, names[x], &param);
+    if (status == napi_ok)
+      status = napi_typeof(env, param, &type);
+    if (status == napi_ok && type != napi_number)
+    {
+      char errorMsg[100];
+      sprintf(errorMsg, "Submitted frame %s value must be a number.", names[x]);
+      napi_throw_error(env, nullptr, errorMsg);
+      return false;
+    }
+    if (status == napi_ok)
+      status = napi_get_value_int32(env, param, &values[x]);
+    if (checkStatus(env, status, __FILE__, __LINE__) != napi_ok)
+      return false;
+  }
+  status = napi_get_named_property(env, config, "pictureAspectRatio", &param);
+  if (status == napi_ok)
+    status = napi_typeof(env, param, &type);
+  if (status == napi_ok && type == napi_number)
+    status = napi_get_value_double(env, param, &pictureAspectRatio);
+  if (checkStatus(env, status, __FILE__, __LINE__) != napi_ok)
+    return false;
+
+  *video = NDIlib_video_frame_v2_t();
+  video->xres = values[0];
+  video->yres = values[1];
+  video->frame_rate_N = values[2];
+  video->frame_rate_D = values[3];
+  video->frame_format_type = (NDIlib_frame_format_type_e)values[4];
+  video->line_stride_in_bytes = values[5];
+  video->FourCC = (NDIlib_FourCC_video_type_e)values[6];
+  video->picture_aspect_ratio = (float)pictureAspectRatio;
+
+  int32_t minStride = 0;
+  size_t minSize = videoFrameSize(video->FourCC, video->xres, video->yres, &minStride);
+  if (video->xres <= 0 || video->yres <= 0 || video->frame_rate_N <= 0 || video->frame_rate_D <= 0 ||
+      !validFrameFormat(video->frame_format_type) || minSize == 0 ||
+      video->line_stride_in_bytes < minStride)
+  {
+    napi_throw_error(env, nullptr, "Submitted frame format is not valid.");
+    return false;
+  }
+  // Planes scale with the stride of the first
+  *size = minSize / minStride * video->line_stride_in_bytes;
+  return true;
+}
+
+// Queue a video frame for the sender's thread, returning false without
+// taking the frame if the queue is full. The frame's properties are checked
+// and remembered, so later frames of the same format can be submitted as a
+// Buffer of data alone.
+napi_value submitVideo(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+  if (argc < 1)
+    NAPI_THROW_ERROR("A frame or Buffer must be provided to submit.");
+
+  senderInstance *instance;
+  status = getSender(env, thisValue, &instance);
+  CHECK_STATUS;
+  senderThread *t = instance->thread;
+  releaseSender(instance); // Held by the sender object while this runs
+  if (t == nullptr)
+    NAPI_THROW_ERROR("Submit requires a sender created with a queueDepth.");
+
+  napi_value dataValue = args[0];
+  bool isBuffer;
+  status = napi_is_buffer(env, args[0], &isBuffer);
+  CHECK_STATUS;
+  if (!isBuffer)
+  {
+    status = napi_typeof(env, args[0], &type);
+    CHECK_STATUS;
+    if (type != napi_object)
+      NAPI_THROW_ERROR("Submit expects a video frame object or a Buffer.");
+    t->formatValid = false;
+    if (!readSubmitFormat(env, args[0], &t->format, &t->formatSize))
+      return nullptr;
+    t->formatValid = true;
+    status = napi_get_named_property(env, args[0], "data", &dataValue);
+    CHECK_STATUS;
+    status = napi_is_buffer(env, dataValue, &isBuffer);
+    CHECK_STATUS;
+    if (!isBuffer)
+      NAPI_THROW_ERROR("Submitted frame data must be a Buffer.");
+  }
+  else if (!t->formatValid)
+    NAPI_THROW_ERROR("Submit a video frame object before submitting a Buffer alone.");
+
+  void *data;
+  size_t length;
+  status = napi_get_buffer_info(env, dataValue, &data, &length);
+  CHECK_STATUS;
+  if (length < t->formatSize)
+    NAPI_THROW_ERROR("Submitted data is too small for the frame format.");
+
+  napi_value result;
+  // Check for room first, so the frame is untouched when it is refused
+  if (!t->queue.hasRoom())
+  {
+    status = napi_get_boolean(env, false, &result);
+    CHECK_STATUS;
+    return result;
+  }
+
+  submittedFrame frame;
+  frame.video = t->format;
+  frame.video.p_data = (uint8_t *)data;
+  status = returnFrameLease(env, instance, dataValue, &frame.block);
+  CHECK_STATUS;
+  if (frame.block == nullptr)
+  {
+    status = napi_create_reference(env, dataValue, 1, &frame.buffer);
+    CHECK_STATUS;
+  }
+  frame.submitted = NOW;
+  bool queued = t->queue.push(frame);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!queued)
+    releaseSubmittedFrame(env, t, &frame);
+  else if (t->submitted++ == t->sent.load())
+    napi_ref_threadsafe_function(env, t->tsfn);
+  if (queued && t->sleeping.load())
+  {
+    {
+      std::lock_guard<std::mutex> lock(t->wakeLock);
+    }
+    t->wake.notify_one();
+  }
+
+  status = napi_get_boolean(env, queued, &result);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,90 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_SUBMIT_H
+#define GRANDIOSE_SUBMIT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_send.h"
+
+napi_value submitVideo(napi_env env, napi_callback_info info);
+
+// A video frame queued for a sender's thread, with whatever keeps its data
+// alive: either a pinned Buffer or a block from the sender's frame pool
+struct submittedFrame {
+  NDIlib_video_frame_v2_t video;
+  napi_ref buffer = nullptr;
+  frameBlock* block = nullptr;
+  HR_TIME_POINT submitted;
+};
+
+// Bounded multi-producer, single consumer queue. Each slot carries a sequence
+// number saying whether it is free for the producer claiming that position,
+// or filled for the consumer, so producers only contend on the head.
+class submitQueue {
+public:
+  explicit submitQueue(uint32_t depth);
+
+  // Returns false when the queue is full
+  bool push(const submittedFrame& frame);
+  bool pop(submittedFrame* frame);
+  bool hasRoom(); // For producers, whether the next push would succeed
+  bool peek(); // For the consumer, whether a frame is waiting
+
+private:
+  struct slot {
+    std::atomic<uint64_t> sequence;
+    submittedFrame frame;
+  };
+  std::unique_ptr<slot[]> slots;
+  uint32_t depth;
+  std::atomic<uint64_t> head{0};
+  uint64_t tail = 0; // Consumer only
+};
+
+struct senderThread {
+  senderInstance* instance; // Cleared when the thread is halted
+  napi_threadsafe_function tsfn = nullptr;
+  std::thread thread;
+  submitQueue queue;
+  std::mutex wakeLock;
+  std::condition_variable wake;
+  std::atomic<bool> running{true};
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> signalled{false};
+  // Frames the SDK has finished with, for the JS thread to release
+  std::mutex doneLock;
+  std::vector<submittedFrame> done;
+  submittedFrame scheduled; // Last frame sent asynchronously
+  std::atomic<uint64_t> sent{0};
+  // Only accessed on the JS thread
+  uint64_t submitted = 0;
+  NDIlib_video_frame_v2_t format; // Validated by the last submitted frame object
+  size_t formatSize = 0;
+  bool formatValid = false;
+  explicit senderThread(uint32_t depth) : queue(depth) {}
+};
+
+napi_status startSenderThread(napi_env env, senderInstance* instance, uint32_t depth);
+void stopSenderThread(napi_env env, senderInstance* instance);
+
+#endif /* GRANDIOSE_SUBMIT_H */
@@ -0,0 +1,584 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <Processing.NDI.Lib.h>
+
+#ifdef _WIN32
+#ifdef _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x64.lib")
+#else // _WIN64
+#pragma comment(lib, "Processing.NDI.Lib.x86.lib")
+#endif // _WIN64
+#endif // _WIN32
+
+#include "grandiose_subscribe.h"
+#include "grandiose_receive.h"
+#include "grandiose_record.h"
+#include "grandiose_pool.h"
+#include "grandiose_util.h"
+
+// Time to block in each capture, bounding how long stopping takes
+#define FANOUT_CAPTURE_WAIT 100
+#define SUBSCRIBE_MAX_DEPTH 1024
+
+napi_value unsubscribe(napi_env env, napi_callback_info info);
+napi_value subscriptionStats(napi_env env, napi_callback_info info);
+
+void releaseSharedFrame(sharedFrame *f)
+{
+  if (f->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    receiverInstance *instance = f->instance;
+    releaseCapturedFrame(instance, &f->frame);
+    delete f;
+    releaseReceiver(instance);
+  }
+}
+
+void releaseSubscriber(subscriber *sub)
+{
+  if (--sub->refs == 0)
+    delete sub;
+}
+
+bool wantsFrame(subscriber *sub, NDIlib_frame_type_e type)
+{
+  switch (type)
+  {
+  case NDIlib_frame_type_video:
+    return sub->captureVideo;
+  case NDIlib_frame_type_audio:
+    return sub->captureAudio;
+  case NDIlib_frame_type_metadata:
+    return sub->captureMetadata;
+  default: // Status changes and lost connections go to everyone
+    return true;
+  }
+}
+
+// With the fanout lock held, so the subscriber is not going anywhere
+void queueSharedFrame(subscriber *sub, sharedFrame *f)
+{
+  sharedFrame *evicted = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(sub->lock);
+    if (sub->queue.size() >= sub->depth)
+    {
+      sub->dropped.fetch_add(1, std::memory_order_relaxed);
+      if (sub->dropPolicy == Grandiose_drop_newest)
+        return;
+      evicted = sub->queue.front();
+      sub->queue.pop_front();
+    }
+    f->refs.fetch_add(1, std::memory_order_relaxed);
+    sub->queue.push_back(f);
+  }
+  if (evicted != nullptr)
+    releaseSharedFrame(evicted);
+
+  // The queue holds the frames - the threadsafe function is only a wake up call
+  if (!sub->signalled.exchange(true))
+    napi_call_threadsafe_function(sub->tsfn, nullptr, napi_tsfn_nonblocking);
+}
+
+void fanoutCapture(fanoutState *s)
+{
+  prepareMediaThread();
+  receiverInstance *instance = s->instance;
+  bool lost = false;
+  while (s->running.load(std::memory_order_relaxed))
+  {
+    sharedFrame *f = new sharedFrame;
+    f->instance = instance;
+    capturedFrame &frame = f->frame;
+    frame.type = captureFrame(instance,
+                              s->captureVideo.load() ? &frame.video : nullptr,
+                              s->captureAudio.load() ? &frame.audio : nullptr,
+                              s->captureMetadata.load() ? &frame.metadata : nullptr,
+                              FANOUT_CAPTURE_WAIT);
+    switch (frame.type)
+    {
+    case NDIlib_frame_type_video:
+      // Converted once, however many subscribers see it
+      convertVideo(instance, &frame.video, &frame.videoData);
+      break;
+    case NDIlib_frame_type_error:
+      // Only report the transition, rather than every failed capture
+      if (lost)
+      {
+        delete f;
+        continue;
+      }
+      break;
+    case NDIlib_frame_type_audio:
+    case NDIlib_frame_type_metadata:
+    case NDIlib_frame_type_status_change:
+      break;
+    default:
+      delete f;
+      continue;
+    }
+    lost = (frame.type == NDIlib_frame_type_error);
+
+    retainReceiver(instance); // Released with the frame
+    {
+      std::lock_guard<std::mutex> guard(s->lock);
+      for (subscriber *sub : s->subscribers)
+        if (wantsFrame(sub, frame.type))
+          queueSharedFrame(sub, f);
+    }
+    releaseSharedFrame(f);
+  }
+}
+
+void finalizeSharedData(napi_env env, void *data, void *hint)
+{
+  releaseSharedFrame((sharedFrame *)hint);
+}
+
+// Make a Buffer over a shared frame's data, taking over the caller's
+// reference to it. Where external memory is not allowed, the data is copied.
+napi_status makeSharedData(napi_env env, sharedFrame *f, void *bytes, size_t size,
+                           napi_value *data)
+{
+  if (size > 0 &&
+      napi_create_external_buffer(env, size, bytes, finalizeSharedData, f, data) == napi_ok)
+    return napi_ok;
+  f->instance->stats.addCopy(size);
+  napi_status status = napi_create_buffer_copy(env, size, bytes, nullptr, data);
+  releaseSharedFrame(f);
+  return status;
+}
+
+// Make the value passed to a subscriber's callback, consuming the queue's
+// reference to the frame
+napi_status makeSubscriberValue(napi_env env, sharedFrame *f, napi_value *error, napi_value *result)
+{
+  napi_status status;
+  napi_value data, metadata = nullptr, param;
+  capturedFrame &frame = f->frame;
+  switch (frame.type)
+  {
+  case NDIlib_frame_type_video:
+  {
+    NDIlib_video_frame_v2_t desc = frame.video;
+    bool converted = frame.videoData.data != nullptr;
+    if (desc.p_metadata != nullptr)
+    {
+      status = napi_create_string_utf8(env, desc.p_metadata, NAPI_AUTO_LENGTH, &metadata);
+      if (status != napi_ok)
+        releaseSharedFrame(f);
+      PASS_STATUS;
+    }
+    receiverInstance *instance = f->instance;
+    if (converted)
+      status = makeSharedData(env, f, frame.videoData.data, frame.videoData.size, &data);
+    else
+      status = makeSharedData(env, f, desc.p_data, receivedVideoSize(&desc), &data);
+    PASS_STATUS;
+    return makeVideoObject(env, instance, &desc,
+                           converted ? frame.videoData.lineStride : desc.line_stride_in_bytes,
+                           converted, data, metadata, result);
+  }
+  case NDIlib_frame_type_audio:
+  {
+    NDIlib_audio_frame_v2_t desc = frame.audio;
+    if (desc.p_metadata != nullptr)
+    {
+      status = napi_create_string_utf8(env, desc.p_metadata, NAPI_AUTO_LENGTH, &metadata);
+      if (status != napi_ok)
+        releaseSharedFrame(f);
+      PASS_STATUS;
+    }
+    status = makeSharedData(env, f, desc.p_data,
+                            (size_t)desc.channel_stride_in_bytes * desc.no_channels, &data);
+    PASS_STATUS;
+    return makeAudioObject(env, &desc, Grandiose_audio_format_float_32_separate, 20,
+                           data, metadata, result);
+  }
+  case NDIlib_frame_type_metadata:
+  {
+    NDIlib_metadata_frame_t desc = frame.metadata;
+    status = napi_create_string_utf8(env, desc.p_data, NAPI_AUTO_LENGTH, &data);
+    releaseSharedFrame(f);
+    PASS_STATUS;
+    return makeMetadataObject(env, &desc, data, result);
+  }
+  case NDIlib_frame_type_error:
+    releaseSharedFrame(f);
+    return makeError(env, GRANDIOSE_CONNECTION_LOST,
+                     "Received error response from NDI subscription capture. Connection lost.",
+                     error);
+  case NDIlib_frame_type_status_change:
+  default:
+    releaseSharedFrame(f);
+    status = napi_create_object(env, result);
+    PASS_STATUS;
+    status = napi_create_string_utf8(env, "statusChange", NAPI_AUTO_LENGTH, &param);
+    PASS_STATUS;
+    return napi_set_named_property(env, *result, "type", param);
+  }
+}
+
+void subscriberCallJs(napi_env env, napi_value callback, void *context, void *data)
+{
+  subscriber *sub = (subscriber *)context;
+  if (env == nullptr)
+    return; // Tearing down - queued frames are released by haltFanout
+
+  napi_status status;
+  napi_value undefined;
+  status = napi_get_undefined(env, &undefined);
+  FLOATING_STATUS;
+
+  sub->signalled.store(false);
+  // The callback may unsubscribe, so check between frames
+  while (sub->fanout != nullptr)
+  {
+    sharedFrame *f;
+    {
+      std::lock_guard<std::mutex> guard(sub->lock);
+      if (sub->queue.empty())
+        return;
+      f = sub->queue.front();
+      sub->queue.pop_front();
+    }
+
+    napi_handle_scope scope;
+    status = napi_open_handle_scope(env, &scope);
+    FLOATING_STATUS;
+
+    napi_value argv[2] = {undefined, undefined};
+    status = makeSubscriberValue(env, f, &argv[0], &argv[1]);
+    if (status == napi_ok)
+    {
+      sub->delivered++;
+      status = napi_call_function(env, undefined, callback, 2, argv, nullptr);
+    }
+    napi_close_handle_scope(env, scope);
+
+    if (status != napi_ok)
+    {
+      // Most likely the callback threw - deliver the rest on the next turn
+      if (!sub->signalled.exchange(true))
+        napi_call_threadsafe_function(sub->tsfn, nullptr, napi_tsfn_nonblocking);
+      return;
+    }
+  }
+}
+
+void finalizeSubscriber(napi_env env, void *data, void *hint)
+{
+  releaseSubscriber((subscriber *)data);
+}
+
+void finalizeSubscription(napi_env env, void *data, void *hint)
+{
+  releaseSubscriber((subscriber *)data);
+}
+
+void updateFanoutTypes(fanoutState *s)
+{
+  bool video = false, audio = false, metadata = false;
+  for (subscriber *sub : s->subscribers)
+  {
+    video = video || sub->captureVideo;
+    audio = audio || sub->captureAudio;
+    metadata = metadata || sub->captureMetadata;
+  }
+  s->captureVideo.store(video);
+  s->captureAudio.store(audio);
+  s->captureMetadata.store(metadata);
+}
+
+// Drop a subscriber's queued frames and stop its callback
+void closeSubscriber(subscriber *sub)
+{
+  sub->fanout = nullptr;
+  std::deque<sharedFrame *> queue;
+  {
+    std::lock_guard<std::mutex> guard(sub->lock);
+    queue.swap(sub->queue);
+  }
+  for (sharedFrame *f : queue)
+    releaseSharedFrame(f);
+  napi_release_threadsafe_function(sub->tsfn, napi_tsfn_abort);
+}
+
+void haltFanout(void *data)
+{
+  fanoutState *s = (fanoutState *)data;
+  s->instance->fanout = nullptr;
+  s->running.store(false);
+  if (s->thread.joinable())
+    s->thread.join();
+  for (subscriber *sub : s->subscribers)
+    closeSubscriber(sub);
+  releaseReceiver(s->instance);
+  delete s;
+}
+
+void removeSubscriber(napi_env env, subscriber *sub)
+{
+  fanoutState *s = sub->fanout;
+  if (s == nullptr)
+    return;
+  bool last;
+  {
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->subscribers.erase(std::find(s->subscribers.begin(), s->subscribers.end(), sub));
+    updateFanoutTypes(s);
+    last = s->subscribers.empty();
+  }
+  closeSubscriber(sub);
+
+  // Capture stops with the last subscriber
+  if (last)
+  {
+    napi_status status;
+    status = napi_remove_env_cleanup_hook(env, haltFanout, s);
+    FLOATING_STATUS;
+    haltFanout(s);
+  }
+}
+
+napi_status getSubscriber(napi_env env, napi_value value, subscriber **result)
+{
+  napi_status status;
+  napi_value subValue;
+  status = napi_get_named_property(env, value, "embedded", &subValue);
+  PASS_STATUS;
+  void *subData;
+  status = napi_get_value_external(env, subValue, &subData);
+  PASS_STATUS;
+  *result = (subscriber *)subData;
+  return napi_ok;
+}
+
+// Add a consumer of the receiver's frames, with its own queue and callback.
+// All the subscribers of a receiver share one capture thread, and the same
+// native frames, so a source is only received and converted once.
+napi_value subscribe(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_valuetype type;
+
+  size_t argc = 2;
+  napi_value args[2];
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, &argc, args, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  if (argc < 1)
+    NAPI_THROW_ERROR("A callback function must be provided to subscribe.");
+  napi_value options = (argc >= 2) ? args[0] : nullptr;
+  napi_value callback = (argc >= 2) ? args[1] : args[0];
+  status = napi_typeof(env, callback, &type);
+  CHECK_STATUS;
+  if (type != napi_function)
+    NAPI_THROW_ERROR("Last argument to subscribe must be a callback function.");
+
+  uint32_t depth = 4;
+  Grandiose_drop_policy_e dropPolicy = Grandiose_drop_oldest;
+  bool captureVideo = true, captureAudio = true, captureMetadata = true;
+
+  if (options != nullptr)
+  {
+    status = napi_typeof(env, options, &type);
+    CHECK_STATUS;
+    if (type != napi_object && type != napi_undefined)
+      NAPI_THROW_ERROR("Subscription options must be an object.");
+  }
+  if (options != nullptr && type == napi_object)
+  {
+    napi_value param;
+    status = napi_get_named_property(env, options, "depth", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      if (type != napi_number)
+        NAPI_THROW_ERROR("Subscription depth must be a number.");
+      status = napi_get_value_uint32(env, param, &depth);
+      CHECK_STATUS;
+      if (depth < 1 || depth > SUBSCRIBE_MAX_DEPTH)
+        NAPI_THROW_ERROR("Subscription depth must be between 1 and 1024.");
+    }
+
+    status = napi_get_named_property(env, options, "dropPolicy", &param);
+    CHECK_STATUS;
+    status = napi_typeof(env, param, &type);
+    CHECK_STATUS;
+    if (type != napi_undefined)
+    {
+      char policy[10];
+      size_t policyl = 0;
+      if (type == napi_string)
+      {
+        status = napi_get_value_string_utf8(env, param, policy, sizeof(policy), &policyl);
+        CHECK_STATUS;
+      }
+      if (type == napi_string && strcmp(policy, "oldest") == 0)
+        dropPolicy = Grandiose_drop_oldest;
+      else if (type == napi_string && strcmp(policy, "newest") == 0)
+        dropPolicy = Grandiose_drop_newest;
+      else
+        NAPI_THROW_ERROR("Subscription drop policy must be one of 'oldest' or 'newest'.");
+    }
+
+    status = napi_get_named_property(env, options, "types", &param);
+    CHECK_STATUS;
+    if (parseFrameTypes(env, param, &captureVideo, &captureAudio, &captureMetadata) != napi_ok)
+      NAPI_THROW_ERROR("Subscription types must be an array of 'video', 'audio' or 'metadata'.");
+  }
+
+  receiverInstance *instance;
+  status = getReceiver(env, thisValue, &instance);
+  CHECK_STATUS;
+  if (receiverBusy(instance, true))
+  {
+    releaseReceiver(instance);
+    NAPI_THROW_ERROR(GRANDIOSE_RECEIVER_BUSY);
+  }
+
+  subscriber *sub = new subscriber;
+  sub->depth = depth;
+  sub->dropPolicy = dropPolicy;
+  sub->captureVideo = captureVideo;
+  sub->captureAudio = captureAudio;
+  sub->captureMetadata = captureMetadata;
+
+  napi_value resourceName, result, embedded;
+  status = napi_create_string_utf8(env, "ReceiveSubscribe", NAPI_AUTO_LENGTH, &resourceName);
+  if (status == napi_ok)
+    status = napi_create_object(env, &result);
+  if (status == napi_ok)
+    status = napi_create_threadsafe_function(env, callback, nullptr, resourceName, 0, 1,
+                                             sub, finalizeSubscriber, sub, subscriberCallJs,
+                                             &sub->tsfn);
+  if (status != napi_ok)
+  {
+    releaseReceiver(instance);
+    delete sub;
+  }
+  CHECK_STATUS;
+  status = napi_create_external(env, sub, finalizeSubscription, nullptr, &embedded);
+  if (status != napi_ok)
+  {
+    sub->refs--; // Never held by a handle
+    napi_release_threadsafe_function(sub->tsfn, napi_tsfn_abort);
+    releaseReceiver(instance);
+  }
+  CHECK_STATUS;
+
+  // The first subscriber starts capture, which keeps the receiver reference
+  fanoutState *s = instance->fanout;
+  bool start = (s == nullptr);
+  if (start)
+  {
+    s = new fanoutState;
+    s->instance = instance;
+    instance->fanout = s;
+  }
+  else
+    releaseReceiver(instance);
+  sub->fanout = s;
+  {
+    std::lock_guard<std::mutex> guard(s->lock);
+    s->subscribers.push_back(sub);
+    updateFanoutTypes(s);
+  }
+  if (start)
+  {
+    s->thread = std::thread(fanoutCapture, s);
+    status = napi_add_env_cleanup_hook(env, haltFanout, s);
+    CHECK_STATUS;
+  }
+
+  status = napi_set_named_property(env, result, "embedded", embedded);
+  CHECK_STATUS;
+  napi_property_descriptor desc[] = {
+      DECLARE_NAPI_METHOD("unsubscribe", unsubscribe),
+      DECLARE_NAPI_METHOD("stats", subscriptionStats)};
+  status = napi_define_properties(env, result, 2, desc);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "receiver", thisValue);
+  CHECK_STATUS;
+
+  return result;
+}
+
+// Stop delivering frames to this subscriber, dropping any still queued.
+// Capture stops once a receiver has no subscribers left.
+napi_value unsubscribe(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  subscriber *sub;
+  status = getSubscriber(env, thisValue, &sub);
+  CHECK_STATUS;
+  removeSubscriber(env, sub);
+
+  napi_value result;
+  status = napi_get_undefined(env, &result);
+  CHECK_STATUS;
+  return result;
+}
+
+// Frames delivered to and dropped for this subscriber, and those waiting
+napi_value subscriptionStats(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  napi_value thisValue;
+  status = napi_get_cb_info(env, info, nullptr, nullptr, &thisValue, nullptr);
+  CHECK_STATUS;
+
+  subscriber *sub;
+  status = getSubscriber(env, thisValue, &sub);
+  CHECK_STATUS;
+  size_t queued;
+  {
+    std::lock_guard<std::mutex> guard(sub->lock);
+    queued = sub->queue.size();
+  }
+
+  napi_value result, param;
+  status = napi_create_object(env, &result);
+  CHECK_STATUS;
+  status = napi_create_double(env, (double)sub->delivered, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "delivered", param);
+  CHECK_STATUS;
+  status = napi_create_double(env, (double)sub->dropped.load(), &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "dropped", param);
+  CHECK_STATUS;
+  status = napi_create_uint32(env, (uint32_t)queued, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "queued", param);
+  CHECK_STATUS;
+  status = napi_get_boolean(env, sub->fanout != nullptr, &param);
+  CHECK_STATUS;
+  status = napi_set_named_property(env, result, "subscribed", param);
+  CHECK_STATUS;
+  return result;
+}
@@ -0,0 +1,73 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_SUBSCRIBE_H
+#define GRANDIOSE_SUBSCRIBE_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "node_api.h"
+#include "grandiose_util.h"
+#include "grandiose_receive.h"
+#include "grandiose_stream.h"
+
+napi_value subscribe(napi_env env, napi_callback_info info);
+
+// A frame captured once for every subscriber of a receiver. Each queue entry
+// and each Buffer handed to JS holds a reference, and the last to go returns
+// the frame to the SDK or its block to the receiver's pool.
+struct sharedFrame {
+  receiverInstance* instance;
+  capturedFrame frame;
+  std::atomic<int32_t> refs{1};
+};
+
+struct fanoutState;
+
+// One consumer of a receiver's frames, with its own queue and callback
+struct subscriber {
+  fanoutState* fanout; // Cleared once unsubscribed, on the JS thread
+  napi_threadsafe_function tsfn = nullptr;
+  std::mutex lock; // Guards the queue
+  std::deque<sharedFrame*> queue;
+  uint32_t depth = 4;
+  Grandiose_drop_policy_e dropPolicy = Grandiose_drop_oldest;
+  bool captureVideo = true;
+  bool captureAudio = true;
+  bool captureMetadata = true;
+  std::atomic<bool> signalled{false};
+  std::atomic<uint64_t> dropped{0};
+  uint64_t delivered = 0; // Only accessed on the JS thread
+  int32_t refs = 2; // Held by the threadsafe function and the handle, on the JS thread
+};
+
+// The capture thread behind a receiver's subscribers, which runs while there
+// is at least one of them
+struct fanoutState {
+  receiverInstance* instance = nullptr;
+  std::thread thread;
+  std::atomic<bool> running{true};
+  std::mutex lock; // Guards subscribers
+  std::vector<subscriber*> subscribers;
+  // What any subscriber wants, updated as they come and go
+  std::atomic<bool> captureVideo{false};
+  std::atomic<bool> captureAudio{false};
+  std::atomic<bool> captureMetadata{false};
+};
+
+#endif /* GRANDIOSE_SUBSCRIBE_H */
@@ -106,6 +106,20 @@ napi_status checkArgs(napi_env env, napi_callback_info info, char* methodName,
 };
 
 
+// Create an Error with one of the GRANDIOSE_* status values as its code,
+// matching errors used to reject promises.
+napi_status makeError(napi_env env, int32_t code, const char* msg, napi_value* result) {
+  napi_status status;
+  napi_value errorCode, errorMsg;
+  char errorChars[20];
+  sprintf(errorChars, "%d", code);
+  status = napi_create_string_utf8(env, errorChars, NAPI_AUTO_LENGTH, &errorCode);
+  PASS_STATUS;
+  status = napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &errorMsg);
+  PASS_STATUS;
+  return napi_create_error(env, errorCode, errorMsg, result);
+}
+
 void tidyCarrier(napi_env env, carrier* c) {
   napi_status status;
   if (c->passthru != nullptr) {
@@ -155,6 +169,7 @@ bool validColorFormat(NDIlib_recv_color_format_e format) {
     case NDIlib_recv_color_format_RGBX_RGBA:
     case NDIlib_recv_color_format_UYVY_RGBA:
     case NDIlib_recv_color_format_fastest:
+    case NDIlib_recv_color_format_best:
   #ifdef _WIN32
     case 	NDIlib_recv_color_format_BGRX_BGRA_flipped:
   #endif
@@ -198,3 +213,17 @@ bool validAudioFormat(Grandiose_audio_format_e format) {
       return false;
   }
 }
+
+bool validVideoFormat(Grandiose_video_format_e format) {
+  switch (format) {
+    case Grandiose_video_format_native:
+    case Grandiose_video_format_rgba:
+    case Grandiose_video_format_bgra:
+    case Grandiose_video_format_nv12:
+    case Grandiose_video_format_i420:
+    case Grandiose_video_format_yuv422p10:
+      return true;
+    default:
+      return false;
+  }
+}
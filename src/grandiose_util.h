@@ -39,6 +39,22 @@ typedef enum Grandiose_audio_format_e {
   Grandiose_audio_format_int_16_interleaved = 2
 } Grandiose_audio_format_e;
 
+// Formats that grandiose can convert received video to on the capture thread
+typedef enum Grandiose_video_format_e {
+  // Video as delivered by NDI, according to the receiver's colour format
+  Grandiose_video_format_native = 0,
+  // 8-bit RGBA, 4 bytes per pixel
+  Grandiose_video_format_rgba = 1,
+  // 8-bit BGRA, 4 bytes per pixel
+  Grandiose_video_format_bgra = 2,
+  // 8-bit 4:2:0 - a luminance plane followed by interleaved Cb, Cr pairs
+  Grandiose_video_format_nv12 = 3,
+  // 8-bit 4:2:0 - luminance, Cb and Cr planes
+  Grandiose_video_format_i420 = 4,
+  // 10-bit 4:2:2 - luminance, Cb and Cr planes of 16-bit samples
+  Grandiose_video_format_yuv422p10 = 5
+} Grandiose_video_format_e;
+
 #define DECLARE_NAPI_METHOD(name, func) { name, 0, func, 0, 0, 0, napi_default, 0 }
 
 // Handling NAPI errors - use "napi_status status;" where used
@@ -66,6 +82,8 @@ napi_status checkArgs(napi_env env, napi_callback_info info, char* methodName,
 #define GRANDIOSE_ALLOCATION_FAILURE 4100
 #define GRANDIOSE_RECEIVE_CREATE_FAIL 4101
 #define GRANDIOSE_SEND_CREATE_FAIL 4102
+#define GRANDIOSE_ROUTING_CREATE_FAIL 4103
+#define GRANDIOSE_RECORD_FAIL 4104
 #define GRANDIOSE_NOT_FOUND 4040
 #define GRANDIOSE_NOT_VIDEO 4140
 #define GRANDIOSE_NOT_AUDIO 4141
@@ -79,10 +97,13 @@ struct carrier {
   int32_t status = GRANDIOSE_SUCCESS;
   std::string errorMsg;
   long long totalTime;
+  HR_TIME_POINT created = NOW; // Queue time is measured from here
   napi_deferred _deferred;
   napi_async_work _request = nullptr;
 };
 
+napi_status makeError(napi_env env, int32_t code, const char* msg, napi_value* result);
+
 void tidyCarrier(napi_env env, carrier* c);
 int32_t rejectStatus(napi_env env, carrier* c, char* file, int32_t line);
 
@@ -116,5 +137,6 @@ bool validColorFormat(NDIlib_recv_color_format_e format);
 bool validBandwidth(NDIlib_recv_bandwidth_e bandwidth);
 bool validFrameFormat(NDIlib_frame_format_type_e format);
 bool validAudioFormat(Grandiose_audio_format_e format);
+bool validVideoFormat(Grandiose_video_format_e format);
 
 #endif // GRANDIOSE_UTIL_H
@@ -0,0 +1,699 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <cstring>
+#include <vector>
+#include "grandiose_video.h"
+#include "grandiose_simd.h"
+
+// Cr, Cb contributions to R, G and B
+static const colourMatrix bt601 = { 102, 25, 52, 129 };
+static const colourMatrix bt709 = { 115, 14, 34, 135 };
+
+// Luminance is scaled from video range by 74.5, as 74 and a half
+#define LUMA_SCALE 74
+
+static inline uint8_t clamp8(int32_t value)
+{
+  return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+/* Plain C++ kernels, also used for the ends of rows by the vector kernels.
+   The vector kernels give identical results. */
+
+static void scalarUyvyToPlanar(const uint8_t *src, int32_t width, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+  for (int32_t x = 0; x < width / 2; x++)
+  {
+    u[x] = src[4 * x];
+    y[2 * x] = src[4 * x + 1];
+    v[x] = src[4 * x + 2];
+    y[2 * x + 1] = src[4 * x + 3];
+  }
+}
+
+static void scalarSplitUV16(const uint16_t *uv, int32_t pairs, int32_t shift, uint16_t *u, uint16_t *v)
+{
+  for (int32_t x = 0; x < pairs; x++)
+  {
+    u[x] = uv[2 * x] >> shift;
+    v[x] = uv[2 * x + 1] >> shift;
+  }
+}
+
+static void scalarShift16(const uint16_t *src, int32_t count, int32_t shift, uint16_t *dst)
+{
+  for (int32_t x = 0; x < count; x++)
+    dst[x] = src[x] >> shift;
+}
+
+static void scalarNarrow16(const uint16_t *src, int32_t count, uint8_t *dst)
+{
+  for (int32_t x = 0; x < count; x++)
+    dst[x] = src[x] >= 0xff80 ? 0xff : (uint8_t)((src[x] + 0x80) >> 8);
+}
+
+static void scalarWiden8(const uint8_t *src, int32_t count, uint16_t *dst)
+{
+  for (int32_t x = 0; x < count; x++)
+    dst[x] = src[x] << 2;
+}
+
+static void scalarAverage8(const uint8_t *a, const uint8_t *b, int32_t count, uint8_t *dst)
+{
+  for (int32_t x = 0; x < count; x++)
+    dst[x] = (uint8_t)((a[x] + b[x] + 1) >> 1);
+}
+
+static void scalarInterleave8(const uint8_t *u, const uint8_t *v, int32_t count, uint8_t *uv)
+{
+  for (int32_t x = 0; x < count; x++)
+  {
+    uv[2 * x] = u[x];
+    uv[2 * x + 1] = v[x];
+  }
+}
+
+static void scalarYuvToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *alpha,
+                            int32_t width, const colourMatrix *m, bool bgra, uint8_t *dst)
+{
+  int32_t r = bgra ? 2 : 0;
+  int32_t b = bgra ? 0 : 2;
+  for (int32_t x = 0; x < width; x++)
+  {
+    int32_t yy = (y[x] - 16) * LUMA_SCALE + ((y[x] - 16) >> 1) + 32;
+    int32_t uu = u[x / 2] - 128;
+    int32_t vv = v[x / 2] - 128;
+    uint8_t *out = dst + 4 * x;
+    out[r] = clamp8((yy + vv * m->crv) >> 6);
+    out[1] = clamp8((yy - uu * m->cgu - vv * m->cgv) >> 6);
+    out[b] = clamp8((yy + uu * m->cbu) >> 6);
+    out[3] = alpha != nullptr ? alpha[x] : 0xff;
+  }
+}
+
+static const videoKernels scalarKernels = {
+  "scalar", scalarUyvyToPlanar, scalarSplitUV16, scalarShift16, scalarNarrow16,
+  scalarWiden8, scalarAverage8, scalarInterleave8, scalarYuvToRgba
+};
+
+#ifdef GRANDIOSE_SIMD_X86
+
+/* SSE4.1 kernels. The AVX2 set only replaces the colour matrix, as the other
+   kernels are limited by memory bandwidth rather than arithmetic. */
+
+TARGET_SSE41 static void sse41UyvyToPlanar(const uint8_t *src, int32_t width, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+  const __m128i split = _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14);
+  const __m128i gather = _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+  int32_t x = 0;
+  for (; x + 16 <= width; x += 16)
+  {
+    // Y0-7 then Cb0-3, Cr0-3 from each half
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 2 * x)), split);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 2 * x + 16)), split);
+    _mm_storeu_si128((__m128i *)(y + x), _mm_unpacklo_epi64(a, b));
+    __m128i uv = _mm_shuffle_epi8(_mm_unpackhi_epi64(a, b), gather);
+    _mm_storel_epi64((__m128i *)(u + x / 2), uv);
+    _mm_storel_epi64((__m128i *)(v + x / 2), _mm_unpackhi_epi64(uv, uv));
+  }
+  scalarUyvyToPlanar(src + 2 * x, width - x, y + x, u + x / 2, v + x / 2);
+}
+
+TARGET_SSE41 static void sse41SplitUV16(const uint16_t *uv, int32_t pairs, int32_t shift, uint16_t *u, uint16_t *v)
+{
+  const __m128i split = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+  __m128i count = _mm_cvtsi32_si128(shift);
+  int32_t x = 0;
+  for (; x + 8 <= pairs; x += 8)
+  {
+    __m128i a = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(uv + 2 * x)), count);
+    __m128i b = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(uv + 2 * x + 8)), count);
+    a = _mm_shuffle_epi8(a, split);
+    b = _mm_shuffle_epi8(b, split);
+    _mm_storeu_si128((__m128i *)(u + x), _mm_unpacklo_epi64(a, b));
+    _mm_storeu_si128((__m128i *)(v + x), _mm_unpackhi_epi64(a, b));
+  }
+  scalarSplitUV16(uv + 2 * x, pairs - x, shift, u + x, v + x);
+}
+
+TARGET_SSE41 static void sse41Shift16(const uint16_t *src, int32_t count, int32_t shift, uint16_t *dst)
+{
+  __m128i bits = _mm_cvtsi32_si128(shift);
+  int32_t x = 0;
+  for (; x + 8 <= count; x += 8)
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(src + x)), bits));
+  scalarShift16(src + x, count - x, shift, dst + x);
+}
+
+TARGET_SSE41 static void sse41Narrow16(const uint16_t *src, int32_t count, uint8_t *dst)
+{
+  const __m128i half = _mm_set1_epi16(0x80);
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m128i a = _mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i *)(src + x)), half), 8);
+    __m128i b = _mm_srli_epi16(_mm_adds_epu16(_mm_loadu_si128((const __m128i *)(src + x + 8)), half), 8);
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(a, b));
+  }
+  scalarNarrow16(src + x, count - x, dst + x);
+}
+
+TARGET_SSE41 static void sse41Widen8(const uint8_t *src, int32_t count, uint16_t *dst)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m128i in = _mm_loadu_si128((const __m128i *)(src + x));
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_slli_epi16(_mm_cvtepu8_epi16(in), 2));
+    _mm_storeu_si128((__m128i *)(dst + x + 8), _mm_slli_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(in, 8)), 2));
+  }
+  scalarWiden8(src + x, count - x, dst + x);
+}
+
+TARGET_SSE41 static void sse41Average8(const uint8_t *a, const uint8_t *b, int32_t count, uint8_t *dst)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(a + x)),
+                                                         _mm_loadu_si128((const __m128i *)(b + x))));
+  scalarAverage8(a + x, b + x, count - x, dst + x);
+}
+
+TARGET_SSE41 static void sse41Interleave8(const uint8_t *u, const uint8_t *v, int32_t count, uint8_t *uv)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m128i cb = _mm_loadu_si128((const __m128i *)(u + x));
+    __m128i cr = _mm_loadu_si128((const __m128i *)(v + x));
+    _mm_storeu_si128((__m128i *)(uv + 2 * x), _mm_unpacklo_epi8(cb, cr));
+    _mm_storeu_si128((__m128i *)(uv + 2 * x + 16), _mm_unpackhi_epi8(cb, cr));
+  }
+  scalarInterleave8(u + x, v + x, count - x, uv + 2 * x);
+}
+
+TARGET_SSE41 static void sse41YuvToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *alpha,
+                                        int32_t width, const colourMatrix *m, bool bgra, uint8_t *dst)
+{
+  const __m128i offset = _mm_set1_epi16(16);
+  const __m128i centre = _mm_set1_epi16(128);
+  const __m128i round = _mm_set1_epi16(32);
+  const __m128i cy = _mm_set1_epi16(LUMA_SCALE);
+  const __m128i crv = _mm_set1_epi16(m->crv);
+  const __m128i cgu = _mm_set1_epi16(m->cgu);
+  const __m128i cgv = _mm_set1_epi16(m->cgv);
+  const __m128i cbu = _mm_set1_epi16(m->cbu);
+  const __m128i opaque = _mm_set1_epi8(-1);
+  int32_t x = 0;
+  for (; x + 16 <= width; x += 16)
+  {
+    __m128i luma = _mm_loadu_si128((const __m128i *)(y + x));
+    __m128i ylo = _mm_cvtepu8_epi16(luma);
+    __m128i yhi = _mm_cvtepu8_epi16(_mm_srli_si128(luma, 8));
+    ylo = _mm_sub_epi16(ylo, offset);
+    yhi = _mm_sub_epi16(yhi, offset);
+    ylo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(ylo, cy), _mm_srai_epi16(ylo, 1)), round);
+    yhi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(yhi, cy), _mm_srai_epi16(yhi, 1)), round);
+    __m128i cb = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + x / 2))), centre);
+    __m128i cr = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + x / 2))), centre);
+
+    // Each chroma sample covers two pixels
+    __m128i rv = _mm_mullo_epi16(cr, crv);
+    __m128i gc = _mm_add_epi16(_mm_mullo_epi16(cb, cgu), _mm_mullo_epi16(cr, cgv));
+    __m128i bu = _mm_mullo_epi16(cb, cbu);
+    __m128i red = _mm_packus_epi16(
+        _mm_srai_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(rv, rv)), 6),
+        _mm_srai_epi16(_mm_add_epi16(yhi, _mm_unpackhi_epi16(rv, rv)), 6));
+    __m128i green = _mm_packus_epi16(
+        _mm_srai_epi16(_mm_sub_epi16(ylo, _mm_unpacklo_epi16(gc, gc)), 6),
+        _mm_srai_epi16(_mm_sub_epi16(yhi, _mm_unpackhi_epi16(gc, gc)), 6));
+    // Blue can exceed the 16-bit range before clamping
+    __m128i blue = _mm_packus_epi16(
+        _mm_srai_epi16(_mm_adds_epi16(ylo, _mm_unpacklo_epi16(bu, bu)), 6),
+        _mm_srai_epi16(_mm_adds_epi16(yhi, _mm_unpackhi_epi16(bu, bu)), 6));
+    __m128i a = alpha != nullptr ? _mm_loadu_si128((const __m128i *)(alpha + x)) : opaque;
+    if (bgra)
+    {
+      __m128i swap = red;
+      red = blue;
+      blue = swap;
+    }
+
+    __m128i rglo = _mm_unpacklo_epi8(red, green);
+    __m128i rghi = _mm_unpackhi_epi8(red, green);
+    __m128i balo = _mm_unpacklo_epi8(blue, a);
+    __m128i bahi = _mm_unpackhi_epi8(blue, a);
+    uint8_t *out = dst + 4 * x;
+    _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(rglo, balo));
+    _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi16(rglo, balo));
+    _mm_storeu_si128((__m128i *)(out + 32), _mm_unpacklo_epi16(rghi, bahi));
+    _mm_storeu_si128((__m128i *)(out + 48), _mm_unpackhi_epi16(rghi, bahi));
+  }
+  scalarYuvToRgba(y + x, u + x / 2, v + x / 2, alpha != nullptr ? alpha + x : nullptr,
+                  width - x, m, bgra, dst + 4 * x);
+}
+
+static const videoKernels sse41Kernels = {
+  "sse4.1", sse41UyvyToPlanar, sse41SplitUV16, sse41Shift16, sse41Narrow16,
+  sse41Widen8, sse41Average8, sse41Interleave8, sse41YuvToRgba
+};
+
+TARGET_AVX2 static void avx2YuvToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *alpha,
+                                      int32_t width, const colourMatrix *m, bool bgra, uint8_t *dst)
+{
+  const __m256i offset = _mm256_set1_epi16(16);
+  const __m256i centre = _mm256_set1_epi16(128);
+  const __m256i round = _mm256_set1_epi16(32);
+  const __m256i cy = _mm256_set1_epi16(LUMA_SCALE);
+  const __m256i crv = _mm256_set1_epi16(m->crv);
+  const __m256i cgu = _mm256_set1_epi16(m->cgu);
+  const __m256i cgv = _mm256_set1_epi16(m->cgv);
+  const __m256i cbu = _mm256_set1_epi16(m->cbu);
+  const __m256i opaque = _mm256_set1_epi8(-1);
+  int32_t x = 0;
+  for (; x + 32 <= width; x += 32)
+  {
+    __m256i luma = _mm256_loadu_si256((const __m256i *)(y + x));
+    __m256i ylo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(luma));
+    __m256i yhi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(luma, 1));
+    ylo = _mm256_sub_epi16(ylo, offset);
+    yhi = _mm256_sub_epi16(yhi, offset);
+    ylo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(ylo, cy), _mm256_srai_epi16(ylo, 1)), round);
+    yhi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(yhi, cy), _mm256_srai_epi16(yhi, 1)), round);
+    // Arrange chroma so that unpacking within lanes lines up with ylo and yhi
+    __m256i cb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x / 2)));
+    __m256i cr = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x / 2)));
+    cb = _mm256_permute4x64_epi64(_mm256_sub_epi16(cb, centre), _MM_SHUFFLE(3, 1, 2, 0));
+    cr = _mm256_permute4x64_epi64(_mm256_sub_epi16(cr, centre), _MM_SHUFFLE(3, 1, 2, 0));
+
+    __m256i rv = _mm256_mullo_epi16(cr, crv);
+    __m256i gc = _mm256_add_epi16(_mm256_mullo_epi16(cb, cgu), _mm256_mullo_epi16(cr, cgv));
+    __m256i bu = _mm256_mullo_epi16(cb, cbu);
+    // Packing leaves pixels 0-7, 16-23 in the low lane and 8-15, 24-31 in the high
+    __m256i red = _mm256_packus_epi16(
+        _mm256_srai_epi16(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(rv, rv)), 6),
+        _mm256_srai_epi16(_mm256_add_epi16(yhi, _mm256_unpackhi_epi16(rv, rv)), 6));
+    __m256i green = _mm256_packus_epi16(
+        _mm256_srai_epi16(_mm256_sub_epi16(ylo, _mm256_unpacklo_epi16(gc, gc)), 6),
+        _mm256_srai_epi16(_mm256_sub_epi16(yhi, _mm256_unpackhi_epi16(gc, gc)), 6));
+    __m256i blue = _mm256_packus_epi16(
+        _mm256_srai_epi16(_mm256_adds_epi16(ylo, _mm256_unpacklo_epi16(bu, bu)), 6),
+        _mm256_srai_epi16(_mm256_adds_epi16(yhi, _mm256_unpackhi_epi16(bu, bu)), 6));
+    __m256i a = opaque;
+    if (alpha != nullptr)
+      a = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(alpha + x)), _MM_SHUFFLE(3, 1, 2, 0));
+    if (bgra)
+    {
+      __m256i swap = red;
+      red = blue;
+      blue = swap;
+    }
+
+    __m256i rglo = _mm256_unpacklo_epi8(red, green); // Pixels 0-7 | 8-15
+    __m256i rghi = _mm256_unpackhi_epi8(red, green); // Pixels 16-23 | 24-31
+    __m256i balo = _mm256_unpacklo_epi8(blue, a);
+    __m256i bahi = _mm256_unpackhi_epi8(blue, a);
+    __m256i p0 = _mm256_unpacklo_epi16(rglo, balo); // Pixels 0-3 | 8-11
+    __m256i p1 = _mm256_unpackhi_epi16(rglo, balo); // Pixels 4-7 | 12-15
+    __m256i p2 = _mm256_unpacklo_epi16(rghi, bahi);
+    __m256i p3 = _mm256_unpackhi_epi16(rghi, bahi);
+    uint8_t *out = dst + 4 * x;
+    _mm256_storeu_si256((__m256i *)out, _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 32), _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256((__m256i *)(out + 64), _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+  }
+  sse41YuvToRgba(y + x, u + x / 2, v + x / 2, alpha != nullptr ? alpha + x : nullptr,
+                 width - x, m, bgra, dst + 4 * x);
+}
+
+static const videoKernels avx2Kernels = {
+  "avx2", sse41UyvyToPlanar, sse41SplitUV16, sse41Shift16, sse41Narrow16,
+  sse41Widen8, sse41Average8, sse41Interleave8, avx2YuvToRgba
+};
+
+#endif /* GRANDIOSE_SIMD_X86 */
+
+#ifdef GRANDIOSE_SIMD_NEON
+
+/* NEON kernels, using the structured loads and stores to split and merge
+   interleaved samples. */
+
+static void neonUyvyToPlanar(const uint8_t *src, int32_t width, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+  int32_t x = 0;
+  for (; x + 32 <= width; x += 32)
+  {
+    uint8x16x4_t uyvy = vld4q_u8(src + 2 * x);
+    uint8x16x2_t luma = { { uyvy.val[1], uyvy.val[3] } };
+    vst2q_u8(y + x, luma);
+    vst1q_u8(u + x / 2, uyvy.val[0]);
+    vst1q_u8(v + x / 2, uyvy.val[2]);
+  }
+  scalarUyvyToPlanar(src + 2 * x, width - x, y + x, u + x / 2, v + x / 2);
+}
+
+static void neonSplitUV16(const uint16_t *uv, int32_t pairs, int32_t shift, uint16_t *u, uint16_t *v)
+{
+  int16x8_t bits = vdupq_n_s16((int16_t)-shift);
+  int32_t x = 0;
+  for (; x + 8 <= pairs; x += 8)
+  {
+    uint16x8x2_t split = vld2q_u16(uv + 2 * x);
+    vst1q_u16(u + x, vshlq_u16(split.val[0], bits));
+    vst1q_u16(v + x, vshlq_u16(split.val[1], bits));
+  }
+  scalarSplitUV16(uv + 2 * x, pairs - x, shift, u + x, v + x);
+}
+
+static void neonShift16(const uint16_t *src, int32_t count, int32_t shift, uint16_t *dst)
+{
+  int16x8_t bits = vdupq_n_s16((int16_t)-shift);
+  int32_t x = 0;
+  for (; x + 8 <= count; x += 8)
+    vst1q_u16(dst + x, vshlq_u16(vld1q_u16(src + x), bits));
+  scalarShift16(src + x, count - x, shift, dst + x);
+}
+
+static void neonNarrow16(const uint16_t *src, int32_t count, uint8_t *dst)
+{
+  uint16x8_t half = vdupq_n_u16(0x80);
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    uint8x8_t a = vshrn_n_u16(vqaddq_u16(vld1q_u16(src + x), half), 8);
+    uint8x8_t b = vshrn_n_u16(vqaddq_u16(vld1q_u16(src + x + 8), half), 8);
+    vst1q_u8(dst + x, vcombine_u8(a, b));
+  }
+  scalarNarrow16(src + x, count - x, dst + x);
+}
+
+static void neonWiden8(const uint8_t *src, int32_t count, uint16_t *dst)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    uint8x16_t in = vld1q_u8(src + x);
+    vst1q_u16(dst + x, vshll_n_u8(vget_low_u8(in), 2));
+    vst1q_u16(dst + x + 8, vshll_n_u8(vget_high_u8(in), 2));
+  }
+  scalarWiden8(src + x, count - x, dst + x);
+}
+
+static void neonAverage8(const uint8_t *a, const uint8_t *b, int32_t count, uint8_t *dst)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+    vst1q_u8(dst + x, vrhaddq_u8(vld1q_u8(a + x), vld1q_u8(b + x)));
+  scalarAverage8(a + x, b + x, count - x, dst + x);
+}
+
+static void neonInterleave8(const uint8_t *u, const uint8_t *v, int32_t count, uint8_t *uv)
+{
+  int32_t x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    uint8x16x2_t pair = { { vld1q_u8(u + x), vld1q_u8(v + x) } };
+    vst2q_u8(uv + 2 * x, pair);
+  }
+  scalarInterleave8(u + x, v + x, count - x, uv + 2 * x);
+}
+
+static inline int16x8_t neonWiden(uint8x8_t value)
+{
+  return vreinterpretq_s16_u16(vmovl_u8(value));
+}
+
+static void neonYuvToRgba(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *alpha,
+                          int32_t width, const colourMatrix *m, bool bgra, uint8_t *dst)
+{
+  int16x8_t offset = vdupq_n_s16(16);
+  int16x8_t centre = vdupq_n_s16(128);
+  int16x8_t round = vdupq_n_s16(32);
+  int32_t x = 0;
+  for (; x + 16 <= width; x += 16)
+  {
+    uint8x16_t luma = vld1q_u8(y + x);
+    int16x8_t ylo = vsubq_s16(neonWiden(vget_low_u8(luma)), offset);
+    int16x8_t yhi = vsubq_s16(neonWiden(vget_high_u8(luma)), offset);
+    ylo = vaddq_s16(vaddq_s16(vmulq_n_s16(ylo, LUMA_SCALE), vshrq_n_s16(ylo, 1)), round);
+    yhi = vaddq_s16(vaddq_s16(vmulq_n_s16(yhi, LUMA_SCALE), vshrq_n_s16(yhi, 1)), round);
+    int16x8_t cb = vsubq_s16(neonWiden(vld1_u8(u + x / 2)), centre);
+    int16x8_t cr = vsubq_s16(neonWiden(vld1_u8(v + x / 2)), centre);
+
+    // Each chroma sample covers two pixels
+    int16x8x2_t rv = vzipq_s16(vmulq_n_s16(cr, m->crv), vmulq_n_s16(cr, m->crv));
+    int16x8_t gcn = vaddq_s16(vmulq_n_s16(cb, m->cgu), vmulq_n_s16(cr, m->cgv));
+    int16x8x2_t gc = vzipq_s16(gcn, gcn);
+    int16x8x2_t bu = vzipq_s16(vmulq_n_s16(cb, m->cbu), vmulq_n_s16(cb, m->cbu));
+    uint8x16_t red = vcombine_u8(vqshrun_n_s16(vaddq_s16(ylo, rv.val[0]), 6),
+                                 vqshrun_n_s16(vaddq_s16(yhi, rv.val[1]), 6));
+    uint8x16_t green = vcombine_u8(vqshrun_n_s16(vsubq_s16(ylo, gc.val[0]), 6),
+                                   vqshrun_n_s16(vsubq_s16(yhi, gc.val[1]), 6));
+    // Blue can exceed the 16-bit range before clamping
+    uint8x16_t blue = vcombine_u8(vqshrun_n_s16(vqaddq_s16(ylo, bu.val[0]), 6),
+                                  vqshrun_n_s16(vqaddq_s16(yhi, bu.val[1]), 6));
+    uint8x16_t a = alpha != nullptr ? vld1q_u8(alpha + x) : vdupq_n_u8(0xff);
+    uint8x16x4_t pixels = { { bgra ? blue : red, green, bgra ? red : blue, a } };
+    vst4q_u8(dst + 4 * x, pixels);
+  }
+  scalarYuvToRgba(y + x, u + x / 2, v + x / 2, alpha != nullptr ? alpha + x : nullptr,
+                  width - x, m, bgra, dst + 4 * x);
+}
+
+static const videoKernels neonKernels = {
+  "neon", neonUyvyToPlanar, neonSplitUV16, neonShift16, neonNarrow16,
+  neonWiden8, neonAverage8, neonInterleave8, neonYuvToRgba
+};
+
+#endif /* GRANDIOSE_SIMD_NEON */
+
+const videoKernels *findVideoKernels(const char *name)
+{
+  if (strcmp(name, scalarKernels.name) == 0)
+    return &scalarKernels;
+#ifdef GRANDIOSE_SIMD_X86
+  bool sse41, avx2;
+  detectX86(&sse41, &avx2);
+  if (avx2 && strcmp(name, avx2Kernels.name) == 0)
+    return &avx2Kernels;
+  if (sse41 && strcmp(name, sse41Kernels.name) == 0)
+    return &sse41Kernels;
+#endif
+#ifdef GRANDIOSE_SIMD_NEON
+  if (strcmp(name, neonKernels.name) == 0)
+    return &neonKernels;
+#endif
+  return nullptr;
+}
+
+static const videoKernels *selectVideoKernels()
+{
+  // Fastest first
+  static const char *preferred[] = { "avx2", "sse4.1", "neon" };
+  for (const char *name : preferred)
+  {
+    const videoKernels *kernels = findVideoKernels(name);
+    if (kernels != nullptr)
+      return kernels;
+  }
+  return &scalarKernels;
+}
+
+const videoKernels *getVideoKernels()
+{
+  static const videoKernels *kernels = selectVideoKernels();
+  return kernels;
+}
+
+static bool sixteenBit(const NDIlib_video_frame_v2_t *frame)
+{
+  return frame->FourCC == NDIlib_FourCC_video_type_P216 || frame->FourCC == NDIlib_FourCC_video_type_PA16;
+}
+
+size_t videoOutputSize(const NDIlib_video_frame_v2_t *frame, Grandiose_video_format_e format,
+                       int32_t *lineStride)
+{
+  switch (frame->FourCC)
+  {
+  case NDIlib_FourCC_video_type_UYVY:
+  case NDIlib_FourCC_video_type_UYVA:
+  case NDIlib_FourCC_video_type_P216:
+  case NDIlib_FourCC_video_type_PA16:
+    break;
+  default:
+    return 0;
+  }
+  if (frame->xres <= 0 || frame->yres <= 0 || frame->xres % 2 != 0 || frame->p_data == nullptr)
+    return 0;
+
+  size_t xres = (size_t)frame->xres;
+  size_t yres = (size_t)frame->yres;
+  size_t chromaRows = (yres + 1) / 2;
+  switch (format)
+  {
+  case Grandiose_video_format_rgba:
+  case Grandiose_video_format_bgra:
+    *lineStride = frame->xres * 4;
+    return xres * yres * 4;
+  case Grandiose_video_format_nv12:
+  case Grandiose_video_format_i420:
+    *lineStride = frame->xres;
+    return xres * yres + xres * chromaRows;
+  case Grandiose_video_format_yuv422p10:
+    *lineStride = frame->xres * 2;
+    return xres * yres * 4;
+  default:
+    return 0;
+  }
+}
+
+// Scratch rows, and access to the rows of a source frame as 8-bit samples
+struct rowReader {
+  const NDIlib_video_frame_v2_t *frame;
+  const videoKernels *kernels;
+  int32_t chromaWidth;
+  std::vector<uint16_t> wide;
+  std::vector<uint8_t> alpha;
+
+  rowReader(const NDIlib_video_frame_v2_t *f, const videoKernels *k)
+      : frame(f), kernels(k), chromaWidth(f->xres / 2), wide(f->xres), alpha(f->xres) {}
+
+  const uint8_t *row(int32_t r) const
+  {
+    return (const uint8_t *)frame->p_data + (size_t)r * frame->line_stride_in_bytes;
+  }
+
+  // 16-bit formats hold a luminance plane then a plane of Cb, Cr pairs
+  const uint16_t *row16(int32_t plane, int32_t r) const
+  {
+    return (const uint16_t *)row(plane * frame->yres + r);
+  }
+
+  void read8(int32_t r, uint8_t *y, uint8_t *u, uint8_t *v)
+  {
+    if (!sixteenBit(frame))
+    {
+      kernels->uyvyToPlanar(row(r), frame->xres, y, u, v);
+      return;
+    }
+    kernels->narrow16(row16(0, r), frame->xres, y);
+    kernels->splitUV16(row16(1, r), chromaWidth, 0, wide.data(), wide.data() + chromaWidth);
+    kernels->narrow16(wide.data(), chromaWidth, u);
+    kernels->narrow16(wide.data() + chromaWidth, chromaWidth, v);
+  }
+
+  const uint8_t *readAlpha(int32_t r)
+  {
+    if (frame->FourCC == NDIlib_FourCC_video_type_UYVA)
+      return row(frame->yres) + (size_t)r * frame->xres;
+    if (frame->FourCC == NDIlib_FourCC_video_type_PA16)
+    {
+      kernels->narrow16(row16(2, r), frame->xres, alpha.data());
+      return alpha.data();
+    }
+    return nullptr;
+  }
+};
+
+void convertVideoFrame(const NDIlib_video_frame_v2_t *frame, Grandiose_video_format_e format, uint8_t *dst)
+{
+  const videoKernels *k = getVideoKernels();
+  rowReader reader(frame, k);
+  int32_t xres = frame->xres;
+  int32_t yres = frame->yres;
+  int32_t cw = xres / 2;
+  // Two rows of chroma, plus their average
+  std::vector<uint8_t> scratch(xres * 4);
+  uint8_t *y = scratch.data();
+  uint8_t *u0 = y + xres;
+  uint8_t *v0 = u0 + cw;
+  uint8_t *u1 = v0 + cw;
+  uint8_t *v1 = u1 + cw;
+  uint8_t *ua = v1 + cw;
+  uint8_t *va = ua + cw;
+
+  switch (format)
+  {
+  case Grandiose_video_format_rgba:
+  case Grandiose_video_format_bgra:
+  {
+    const colourMatrix *matrix = yres < 720 ? &bt601 : &bt709;
+    bool bgra = format == Grandiose_video_format_bgra;
+    for (int32_t r = 0; r < yres; r++)
+    {
+      reader.read8(r, y, u0, v0);
+      k->yuvToRgba(y, u0, v0, reader.readAlpha(r), xres, matrix, bgra, dst + (size_t)r * xres * 4);
+    }
+    break;
+  }
+  case Grandiose_video_format_nv12:
+  case Grandiose_video_format_i420:
+  {
+    // Chroma of each pair of rows is averaged, repeating the last odd row
+    uint8_t *luma = dst;
+    uint8_t *chroma = dst + (size_t)xres * yres;
+    size_t chromaPlane = (size_t)cw * ((yres + 1) / 2);
+    for (int32_t r = 0; r < yres; r += 2)
+    {
+      reader.read8(r, luma + (size_t)r * xres, u0, v0);
+      if (r + 1 < yres)
+        reader.read8(r + 1, luma + (size_t)(r + 1) * xres, u1, v1);
+      else
+      {
+        memcpy(u1, u0, cw);
+        memcpy(v1, v0, cw);
+      }
+      if (format == Grandiose_video_format_i420)
+      {
+        k->average8(u0, u1, cw, chroma + (size_t)(r / 2) * cw);
+        k->average8(v0, v1, cw, chroma + chromaPlane + (size_t)(r / 2) * cw);
+      }
+      else
+      {
+        k->average8(u0, u1, cw, ua);
+        k->average8(v0, v1, cw, va);
+        k->interleave8(ua, va, cw, chroma + (size_t)(r / 2) * xres);
+      }
+    }
+    break;
+  }
+  case Grandiose_video_format_yuv422p10:
+  {
+    uint16_t *luma = (uint16_t *)dst;
+    uint16_t *cb = luma + (size_t)xres * yres;
+    uint16_t *cr = cb + (size_t)cw * yres;
+    for (int32_t r = 0; r < yres; r++)
+    {
+      if (sixteenBit(frame))
+      {
+        k->shift16(reader.row16(0, r), xres, 6, luma + (size_t)r * xres);
+        k->splitUV16(reader.row16(1, r), cw, 6, cb + (size_t)r * cw, cr + (size_t)r * cw);
+      }
+      else
+      {
+        k->uyvyToPlanar(reader.row(r), xres, y, u0, v0);
+        k->widen8(y, xres, luma + (size_t)r * xres);
+        k->widen8(u0, cw, cb + (size_t)r * cw);
+        k->widen8(v0, cw, cr + (size_t)r * cw);
+      }
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
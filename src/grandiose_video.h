@@ -0,0 +1,68 @@
+/* Copyright 2018 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef GRANDIOSE_VIDEO_H
+#define GRANDIOSE_VIDEO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <Processing.NDI.Lib.h>
+#include "grandiose_util.h"
+
+// Colour conversion of received UYVY, UYVA, P216 and PA16 video to the
+// output formats a receiver can ask for. Frames are converted a row at a time
+// by kernels picked once for the CPU in use, as for audio. YCbCr is taken to
+// be video range, using BT.601 below 720 lines and BT.709 otherwise.
+
+// Fixed point YCbCr to RGB coefficients, with 6 fractional bits
+struct colourMatrix {
+  int16_t crv;
+  int16_t cgu;
+  int16_t cgv;
+  int16_t cbu;
+};
+
+// Row kernels. Widths are in pixels unless they count chroma samples.
+struct videoKernels {
+  const char *name;
+  // Split a row of UYVY into its Y, Cb and Cr samples
+  void (*uyvyToPlanar)(const uint8_t *src, int32_t width, uint8_t *y, uint8_t *u, uint8_t *v);
+  // Split a row of 16-bit Cb, Cr pairs, shifting each sample right
+  void (*splitUV16)(const uint16_t *uv, int32_t pairs, int32_t shift, uint16_t *u, uint16_t *v);
+  void (*shift16)(const uint16_t *src, int32_t count, int32_t shift, uint16_t *dst);
+  // Round 16-bit samples to 8 bits
+  void (*narrow16)(const uint16_t *src, int32_t count, uint8_t *dst);
+  // Scale 8-bit samples to 10 bits
+  void (*widen8)(const uint8_t *src, int32_t count, uint16_t *dst);
+  void (*average8)(const uint8_t *a, const uint8_t *b, int32_t count, uint8_t *dst);
+  void (*interleave8)(const uint8_t *u, const uint8_t *v, int32_t count, uint8_t *uv);
+  // Convert 4:2:2 rows to RGBA, or BGRA when bgra is set. alpha may be nullptr.
+  void (*yuvToRgba)(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *alpha,
+                    int32_t width, const colourMatrix *matrix, bool bgra, uint8_t *dst);
+};
+
+const videoKernels *getVideoKernels();
+// Kernels by name, or nullptr if they cannot run on this CPU. Names are
+// "scalar", "sse4.1", "avx2" and "neon".
+const videoKernels *findVideoKernels(const char *name);
+
+// Bytes needed to hold a frame converted to format, with the stride of its
+// first plane in lineStride. Zero if the frame cannot be converted.
+size_t videoOutputSize(const NDIlib_video_frame_v2_t *frame, Grandiose_video_format_e format,
+                       int32_t *lineStride);
+void convertVideoFrame(const NDIlib_video_frame_v2_t *frame, Grandiose_video_format_e format,
+                       uint8_t *dst);
+
+#endif /* GRANDIOSE_VIDEO_H */